@@ -0,0 +1,31 @@
+#include "impala/arena.h"
+
+#include <algorithm>
+
+namespace impala {
+
+static thread_local Arena* current_arena = nullptr;
+
+Arena* Arena::current() { return current_arena; }
+
+Arena::Scope::Scope(Arena& arena)
+    : Scope(&arena)
+{}
+
+Arena::Scope::Scope(Arena* arena)
+    : old_(current_arena)
+{
+    current_arena = arena;
+}
+
+Arena::Scope::~Scope() { current_arena = old_; }
+
+void Arena::grow(size_t size) {
+    // oversized requests get a block of their own
+    size_t block_size = std::max(size, size_t(Block_Size));
+    blocks_.emplace_back(new char[block_size]);
+    cur_ = blocks_.back().get();
+    end_ = cur_ + block_size;
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef IMPALA_ARENA_H
+#define IMPALA_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace impala {
+
+/**
+ * Bump allocator which hands out memory from large blocks and releases all of it at once when destroyed.
+ * @p ASTNode%s are allocated in the @p Arena that is @p current for the allocating thread (see @p Scope).
+ */
+class Arena {
+public:
+    static constexpr size_t Align = alignof(std::max_align_t);
+    static constexpr size_t Block_Size = 1024 * 1024;
+
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// Returns @p size bytes aligned to @p Align.
+    void* allocate(size_t size) {
+        size = (size + Align - 1) & ~(Align - 1);
+        if (size_t(end_ - cur_) < size)
+            grow(size);
+        auto result = cur_;
+        cur_ += size;
+        num_bytes_ += size;
+        return result;
+    }
+
+    size_t num_bytes() const { return num_bytes_; }   ///< Bytes handed out so far.
+    size_t num_blocks() const { return blocks_.size(); }
+    static Arena* current();                           ///< The @p Arena installed for this thread or @c nullptr.
+
+    /// Installs @p arena as the @p current one of this thread for the lifetime of this object.
+    class Scope {
+    public:
+        Scope(Arena& arena);
+        explicit Scope(Arena* arena); ///< A @c nullptr @p arena allocates on the heap.
+        ~Scope();
+
+    private:
+        Arena* old_;
+    };
+
+private:
+    void grow(size_t size);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    size_t num_bytes_ = 0;
+};
+
+}
+
+#endif
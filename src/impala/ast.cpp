@@ -1,18 +1,41 @@
 #include "impala/ast.h"
 
+#include <algorithm>
+#include <type_traits>
+
 using namespace thorin;
 
 namespace impala {
 
-size_t ASTNode::gid_counter_ = 1;
-
 //------------------------------------------------------------------------------
 
 ASTNode::ASTNode(Loc loc)
-    : gid_(gid_counter_++)
+    : gid_(Context::current().next_ast_gid())
     , loc_(loc)
 {}
 
+/*
+ * Each node is preceded by a header which records the Arena it has been allocated in.
+ * Deleting a node allocated in an Arena only runs its destructor.
+ */
+
+static constexpr size_t node_header_size = Arena::Align;
+
+void* ASTNode::operator new(size_t size) {
+    auto arena = Arena::current();
+    size += node_header_size;
+    auto mem = arena != nullptr ? arena->allocate(size) : ::operator new(size);
+    *static_cast<Arena**>(mem) = arena;
+    return static_cast<char*>(mem) + node_header_size;
+}
+
+void ASTNode::operator delete(void* ptr) {
+    if (ptr == nullptr) return;
+    auto mem = static_cast<char*>(ptr) - node_header_size;
+    if (*reinterpret_cast<Arena**>(mem) == nullptr)
+        ::operator delete(mem);
+}
+
 const char* Visibility::str() {
     if (visibility_ == Pub)  return "pub ";
     if (visibility_ == Priv) return "priv ";
@@ -145,10 +168,221 @@ bool TuplePtrn::is_refutable() const {
         [] (const std::unique_ptr<const Ptrn>& p) { return p->is_refutable(); });
 }
 
+bool OrPtrn::is_refutable() const {
+    return std::all_of(alts_.begin(), alts_.end(),
+        [] (const std::unique_ptr<const Ptrn>& p) { return p->is_refutable(); });
+}
+
 bool IdPtrn::is_refutable()      const { return false; }
 bool EnumPtrn::is_refutable()    const { return true;  }
 bool LiteralPtrn::is_refutable() const { return true;  }
 bool CharPtrn::is_refutable()    const { return true;  }
+bool RangePtrn::is_refutable()   const { return true;  }
+
+/*
+ * ordinal
+ */
+
+template<class T>
+static uint64_t ordinal(T value, bool minus) {
+    if (minus)
+        value = T(-value);
+    if (std::is_signed<T>::value)
+        return uint64_t(int64_t(value)) ^ (uint64_t(1) << 63);
+    return uint64_t(value);
+}
+
+uint64_t ordinal(const Ptrn* ptrn) {
+    if (auto char_ptrn = ptrn->isa<CharPtrn>())
+        return ordinal<u8>(char_ptrn->chr()->value(), false);
+
+    auto literal_ptrn = ptrn->as<LiteralPtrn>();
+    auto literal = literal_ptrn->literal();
+    auto minus = literal_ptrn->has_minus();
+    switch (literal->tag()) {
+        case LiteralExpr::LIT_i8:  return ordinal(literal->get<s8 >(), minus);
+        case LiteralExpr::LIT_i16: return ordinal(literal->get<s16>(), minus);
+        case LiteralExpr::LIT_i32: return ordinal(literal->get<s32>(), minus);
+        case LiteralExpr::LIT_i64: return ordinal(literal->get<s64>(), minus);
+        case LiteralExpr::LIT_u8:  return ordinal(literal->get<u8 >(), minus);
+        case LiteralExpr::LIT_u16: return ordinal(literal->get<u16>(), minus);
+        case LiteralExpr::LIT_u32: return ordinal(literal->get<u32>(), minus);
+        case LiteralExpr::LIT_u64: return ordinal(literal->get<u64>(), minus);
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * traits and impls
+ */
+
+void ASTTypeParamList::type_args_by_depth(Types args, std::vector<const Type*>& by_depth) const {
+    for (size_t i = 0, e = std::min(args.size(), num_ast_type_params()); i != e; ++i) {
+        auto depth = size_t(ast_type_param(i)->lambda_depth());
+        if (by_depth.size() < depth)
+            by_depth.resize(depth);
+        by_depth[depth-1] = args[i];
+    }
+}
+
+void TraitDecl::trait_args_by_depth(Types args, std::vector<const Type*>& by_depth) const {
+    if (args.empty())
+        return;
+    auto depth = size_t(self_param()->lambda_depth());
+    if (by_depth.size() < depth)
+        by_depth.resize(depth);
+    by_depth[depth-1] = args.front();
+    type_args_by_depth(args.skip_front(), by_depth);
+}
+
+static const ImplItem* find_impl(const TraitDecl*, const TraitDecl*, Types, std::vector<const Type*>&, Symbol,
+                                 GIDSet<const TraitDecl*>&, int);
+
+/// Deeper searches are considered to fail - they would not terminate for impls like @c impl[A:T[(A,A)]] T[A] for A.
+static const int max_bound_depth = 16;
+
+/// Do the monomorphic types in @p by_depth satisfy the bounds of the type parameters of @p params?
+static bool satisfies_bounds(const ASTTypeParamList* params, Types by_depth, int depth) {
+    for (auto&& ast_type_param : params->ast_type_params()) {
+        auto i = size_t(ast_type_param->lambda_depth()) - 1;
+        if (i >= by_depth.size() || by_depth[i] == nullptr)
+            continue;
+
+        for (auto&& bound : ast_type_param->bounds()) {
+            auto type_app = bound->isa<ASTTypeApp>();
+            auto trait_decl = type_app && type_app->decl() ? type_app->decl()->isa<TraitDecl>() : nullptr;
+            if (trait_decl == nullptr)
+                continue;
+
+            std::vector<const Type*> trait_args(1, by_depth[i]);
+            for (auto type_arg : type_app->type_args())
+                trait_args.push_back(substitute(type_arg, by_depth));
+            if (std::any_of(trait_args.begin(), trait_args.end(), [] (const Type* t) { return t->is_polymorphic(); }))
+                continue; // decided once the type parameters are instantiated
+
+            GIDSet<const TraitDecl*> done;
+            std::vector<const Type*> impl_args;
+            if (depth == max_bound_depth || !find_impl(trait_decl, trait_decl, trait_args, impl_args, Symbol(), done, depth+1))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static const ImplItem* find_impl(const TraitDecl* trait_decl, const TraitDecl* sub_trait, Types args,
+                                 std::vector<const Type*>& impl_args, Symbol method, GIDSet<const TraitDecl*>& done,
+                                 int depth) {
+    if (!done.emplace(sub_trait).second)
+        return nullptr; // also stops at cyclic super traits
+
+    for (auto impl : sub_trait->impls()) {
+        if ((method.empty() || impl->find_method(method))
+                && impl->implements(trait_decl, args, impl_args)
+                && satisfies_bounds(impl, impl_args, depth))
+            return impl;
+    }
+
+    for (auto sub_sub_trait : sub_trait->sub_traits()) {
+        if (auto impl = find_impl(trait_decl, sub_sub_trait, args, impl_args, method, done, depth))
+            return impl;
+    }
+
+    impl_args.clear();
+    return nullptr;
+}
+
+const ImplItem* TraitDecl::find_impl(Types args, std::vector<const Type*>& impl_args, Symbol method) const {
+    GIDSet<const TraitDecl*> done;
+    return impala::find_impl(this, this, args, impl_args, method, done, 0);
+}
+
+const FnDecl* TraitDecl::resolve_method(Symbol symbol, Types args, std::vector<const Type*>& type_args) const {
+    if (auto impl = find_impl(args, type_args, symbol))
+        return impl->find_method(symbol);
+
+    auto method = find_method(symbol);
+    if (method == nullptr || method->body() == nullptr)
+        return nullptr;
+
+    type_args.clear();
+    trait_args_by_depth(args, type_args);
+    return method;
+}
+
+/// Does @p trait_decl - or one of its super traits - match @p target, once instantiated with the trait arguments @p pattern?
+static bool match_trait(const TraitDecl* trait_decl, Types pattern, const TraitDecl* target, Types args,
+                        std::vector<const Type*>& impl_args, GIDSet<const TraitDecl*>& done) {
+    if (!done.emplace(trait_decl).second)
+        return false;
+
+    if (trait_decl == target && pattern.size() == args.size()) {
+        bool matches = true;
+        impl_args.clear();
+        for (size_t i = 0, e = args.size(); matches && i != e; ++i)
+            matches = match(pattern[i], args[i], impl_args);
+        if (matches)
+            return true;
+    }
+
+    // the type arguments of a super trait refer to the type parameters of trait_decl
+    std::vector<const Type*> by_depth;
+    trait_decl->trait_args_by_depth(pattern, by_depth);
+    for (auto&& super_trait : trait_decl->super_traits()) {
+        if (auto super_decl = super_trait->decl() ? super_trait->decl()->isa<TraitDecl>() : nullptr) {
+            std::vector<const Type*> super_pattern(1, pattern.front());
+            for (auto type_arg : super_trait->type_args())
+                super_pattern.push_back(substitute(type_arg, by_depth));
+            if (match_trait(super_decl, super_pattern, target, args, impl_args, done))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool ImplItem::implements(const TraitDecl* trait_decl, Types args, std::vector<const Type*>& impl_args) const {
+    if (this->trait_decl() == nullptr || ast_type()->type() == nullptr)
+        return false;
+
+    GIDSet<const TraitDecl*> done;
+    if (match_trait(this->trait_decl(), trait_args(), trait_decl, args, impl_args, done))
+        return true;
+
+    impl_args.clear();
+    return false;
+}
+
+const TraitDecl* ImplItem::trait_decl() const {
+    if (auto ast_type_app = trait() ? trait()->isa<ASTTypeApp>() : nullptr)
+        return ast_type_app->decl() ? ast_type_app->decl()->isa<TraitDecl>() : nullptr;
+    return nullptr;
+}
+
+std::vector<const Type*> ImplItem::trait_args() const {
+    std::vector<const Type*> result;
+    result.push_back(ast_type()->type());
+    if (trait_decl()) {
+        auto type_args = trait()->as<ASTTypeApp>()->type_args();
+        result.insert(result.end(), type_args.begin(), type_args.end());
+    }
+    return result;
+}
+
+const FnType* FieldExpr::method_type() const {
+    auto fn_type = method() && method()->type() ? method()->type()->isa<FnType>() : nullptr;
+    if (fn_type == nullptr)
+        return nullptr;
+
+    std::vector<const Type*> by_depth;
+    if (auto trait_decl = method()->owner()->isa<TraitDecl>())
+        trait_decl->trait_args_by_depth(method_type_args(), by_depth);
+    else
+        method()->owner()->as<ImplItem>()->type_args_by_depth(method_type_args(), by_depth);
+    return substitute(fn_type, by_depth)->as<FnType>();
+}
 
 //------------------------------------------------------------------------------
 
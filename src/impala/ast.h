@@ -7,8 +7,10 @@
 #include "thorin/util/cast.h"
 #include "thorin/util/types.h"
 
+#include "impala/arena.h"
 #include "impala/impala.h"
 #include "impala/token.h"
+#include "impala/sema/consteval.h"
 #include "impala/sema/type.h"
 
 namespace thorin {
@@ -29,12 +31,14 @@ class FieldDecl;
 class OptionDecl;
 class Fn;
 class FnDecl;
+class ImplItem;
 class LocalDecl;
 class Param;
 class Ptrn;
 class Stmt;
 class PrefixExpr;
 class RValueExpr;
+class TraitDecl;
 
 class NameSema;
 class InferSema;
@@ -117,6 +121,8 @@ public:
     size_t num_ast_type_params() const { return ast_type_params_.size(); }
     const ASTTypeParam* ast_type_param(size_t i) const { return ast_type_params_[i].get(); }
     const ASTTypeParams& ast_type_params() const { return ast_type_params_; }
+    /// Puts @c args[i] at the depth of the @c i-th type parameter into @p by_depth - as expected by @p substitute.
+    void type_args_by_depth(Types args, std::vector<const Type*>& by_depth) const;
     Stream& stream_ast_type_params(Stream&) const;
 
 protected:
@@ -141,9 +147,15 @@ public:
     Loc loc() const { return loc_; }
     virtual Stream& stream(Stream&) const = 0;
 
-private:
-    static size_t gid_counter_;
+    /// The gid the next node of the current @p Context will get.
+    static size_t gid_counter() { return Context::current().ast_gid_counter(); }
+
+    /// Allocates in the @p Arena::current one or on the heap if there is none.
+    static void* operator new(size_t size);
+    /// Only releases heap-allocated nodes; nodes within an @p Arena are released together with it.
+    static void operator delete(void* ptr);
 
+private:
     size_t gid_;
     Loc loc_;
 };
@@ -358,14 +370,30 @@ private:
     void check(TypeSema&) const override;
 };
 
+/// <tt>[T..]</tt> - an array which carries its length; only valid behind a borrowed pointer.
+class SliceASTType : public ArrayASTType {
+public:
+    SliceASTType(Loc loc, const ASTType* elem_ast_type)
+        : ArrayASTType(loc, elem_ast_type)
+    {}
+
+    void bind(NameSema&) const override;
+    Stream& stream(Stream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+};
+
 class DefiniteArrayASTType : public ArrayASTType {
 public:
-    DefiniteArrayASTType(Loc loc, const ASTType* elem_ast_type, uint64_t dim)
+    DefiniteArrayASTType(Loc loc, const ASTType* elem_ast_type, const Expr* dim)
         : ArrayASTType(loc, elem_ast_type)
-        , dim_(dim)
+        , dim_(dock(dim_, dim))
     {}
 
-    uint64_t dim() const { return dim_; }
+    /// A compile-time constant - see @p const_dim.
+    const Expr* dim() const { return dim_.get(); }
 
     void bind(NameSema&) const override;
     Stream& stream(Stream&) const override;
@@ -374,7 +402,7 @@ private:
     const Type* infer(InferSema&) const override;
     void check(TypeSema&) const override;
 
-    uint64_t dim_;
+    std::unique_ptr<const Expr> dim_;
 };
 
 class CompoundASTType : public ASTType {
@@ -387,6 +415,7 @@ public:
     size_t num_ast_type_args() const { return ast_type_args_.size(); }
     ASTTypeArgs ast_type_args() const { return ast_type_args_; }
     const ASTType* ast_type_arg(size_t i) const { return ast_type_args_[i].get(); }
+    Types type_args() const { return type_args_; }
 
 protected:
     ASTTypes ast_type_args_;
@@ -582,6 +611,13 @@ public:
 
     const Fn* fn() const { return fn_; }
     void take_address() const { is_address_taken_ = true; }
+    /**
+     * Does the memory of this owned pointer die with the local?
+     * @p borrow_check proves that it is never moved, reassigned or borrowed beyond its scope - the local is released
+     * when its scope is left.
+     * The memory may stem from another owned local which has been moved into this one.
+     */
+    bool is_released() const { return released_; }
     void emit(CodeGen&, const thorin::Def*) const;
     void bind(NameSema&) const;
 
@@ -594,7 +630,9 @@ private:
 protected:
     mutable const Fn* fn_;
     mutable bool is_address_taken_ = false;
+    mutable bool released_ = false;
 
+    friend class BorrowSema;
     friend class CodeGen;
     friend class InferSema;
     friend class TypeSema;
@@ -615,6 +653,8 @@ public:
 
     size_t num_bounds() const { return bounds().size(); }
     const ASTTypes& bounds() const { return bounds_; }
+    /// The @p TraitDecl this is the implicit @c Self parameter of; @c nullptr for all other parameters.
+    const TraitDecl* trait_decl() const { return trait_decl_; }
     int lambda_depth() const { return lambda_depth_; }
     const Var* var() const { return type()->as<Var>(); }
 
@@ -626,11 +666,13 @@ private:
     const Var* infer(InferSema&) const;
 
     ASTTypes bounds_;
+    const TraitDecl* trait_decl_ = nullptr;
     mutable int lambda_depth_ = -1;
 
     friend class ASTTypeApp;
     friend class ASTTypeParamList;
     friend class InferSema;
+    friend class TraitDecl;
 };
 
 class Param : public LocalDecl {
@@ -678,6 +720,8 @@ public:
     virtual Symbol fn_symbol() const = 0;
 
 protected:
+    void set_body(const Expr* body) const { body_.reset(dock(body_, body)); }
+
     std::unique_ptr<const Expr> filter_;
     Params params_;
     mutable thorin::Continuation* continuation_ = nullptr;
@@ -685,7 +729,15 @@ protected:
     mutable const thorin::Def* frame_ = nullptr;
 
 private:
-    std::unique_ptr<const Expr> body_;
+    mutable std::unique_ptr<const Expr> body_;
+};
+
+/// The @p Token%s of a function body the parser has skipped as @p lazy_bodies is set.
+struct LazyBody {
+    std::shared_ptr<const void> source; ///< Keeps the text of the @p tokens alive.
+    std::vector<Token> tokens;          ///< From the opening to the closing brace.
+    Arena* arena = nullptr;             ///< Receives the nodes of the body; @c nullptr for the heap.
+    bool referenced = false;            ///< Has name analysis already queued the body?
 };
 
 //------------------------------------------------------------------------------
@@ -715,6 +767,15 @@ public:
     {}
 
     Visibility visibility() const { return visibility_; }
+    /// Is this a function whose body has been skipped and which nothing refers to? Such items are ignored after parsing.
+    virtual bool is_lazy() const { return false; }
+    /**
+     * The @p Item%s this one refers to by name - directly or from within items nested in it.
+     * The impls and traits of the methods it calls are added by type analysis.
+     */
+    const std::vector<const Item*>& uses() const { return uses_; }
+    /// Is this @p Item reachable from the roots of the program? Only reachable items are emitted.
+    bool is_reachable() const { return reachable_; }
     virtual void bind(NameSema&) const = 0;
     virtual void emit_head(CodeGen&) const {};
     virtual void emit(CodeGen&) const = 0;
@@ -725,10 +786,14 @@ private:
     virtual void check(TypeSema&) const = 0;
 
     Visibility visibility_;
+    mutable std::vector<const Item*> uses_;
+    mutable bool reachable_ = false;
 
     friend class CodeGen;
     friend class InferSema;
+    friend class NameSema;
     friend class TypeSema;
+    friend void reachability_analysis(const Module*);
 };
 
 class TypeDeclItem : public Item, public ASTTypeParamList {
@@ -753,14 +818,17 @@ public:
         , items_(std::move(items))
     {}
 
-    Module(const char* first_file_name, Items&& items = Items())
+    Module(const char* first_file_name, Items&& items = Items(), std::unique_ptr<Arena>&& arena = nullptr)
         : Module(items.empty() ? Loc(first_file_name, {1, 1}, {1, 1}) 
                                : Loc(items.front()->loc().file, items.front()->loc().begin, items.back()->loc().finis),
                  Visibility::Pub, nullptr, ASTTypeParams(), std::move(items))
-    {}
+    {
+        arena_ = std::move(arena);
+    }
 
     const Items& items() const { return items_; }
     const Symbol2Item& symbol2item() const { return symbol2item_; }
+    const Arena* arena() const { return arena_.get(); } ///< @c nullptr if the nodes live on the heap.
 
     void bind(NameSema&) const override;
     void infer(InferSema&) const override;
@@ -770,6 +838,7 @@ public:
     Stream& stream(Stream&) const override;
 
 private:
+    std::unique_ptr<Arena> arena_; ///< Holds the nodes of @p items_; declared first so it is released after them.
     Items items_;
     mutable Symbol2Item symbol2item_;
 };
@@ -971,6 +1040,8 @@ public:
     {}
 
     const Expr* init() const { return init_.get(); }
+    /// The value of @p init evaluated during type checking; @c nullptr if there is none yet.
+    const ConstValue* value() const { return value_ ? &*value_ : nullptr; }
 
     void bind(NameSema&) const override;
     void emit_head(CodeGen&) const override;
@@ -983,6 +1054,7 @@ private:
     void check(TypeSema&) const override;
 
     std::unique_ptr<const Expr> init_;
+    mutable std::optional<ConstValue> value_;
 };
 
 class FnDecl : public ValueItem, public Fn {
@@ -998,6 +1070,11 @@ public:
 
     bool is_extern() const { return is_extern_; }
     Symbol abi() const { return abi_; }
+    Symbol export_name() const { return export_name_; }
+    bool is_lazy() const override { return lazy_body_ != nullptr; }
+    LazyBody* lazy_body() const { return lazy_body_.get(); }
+    void set_lazy_body(std::unique_ptr<LazyBody>&& lazy_body) { lazy_body_ = std::move(lazy_body); }
+    void parse_lazy_body() const; ///< Parses the skipped body which becomes the @p body of this function.
 
     const FnType* fn_type() const override {
         auto t = type();
@@ -1006,10 +1083,14 @@ public:
         return t->as<FnType>();
     }
     Symbol fn_symbol() const override { return export_name_ != "" ? export_name_ : identifier()->symbol(); }
+    /// The @p TraitDecl or @p ImplItem this method belongs to; @c nullptr for all other functions.
+    const Item* owner() const { return owner_; }
 
     void bind(NameSema&) const override;
     void emit_head(CodeGen&) const override;
     void emit(CodeGen&) const override;
+    /// Emits the body of this function into @p continuation - an instance for particular type arguments.
+    void emit_instance(CodeGen&, thorin::Continuation* continuation) const;
     Stream& stream(Stream&) const override;
 
 private:
@@ -1020,6 +1101,11 @@ private:
     Symbol abi_;
     Symbol export_name_;
     bool is_extern_ = false;
+    mutable std::unique_ptr<LazyBody> lazy_body_;
+    mutable const Item* owner_ = nullptr;
+
+    friend class ImplItem;
+    friend class TraitDecl;
 };
 
 class TraitDecl : public Item, public ASTTypeParamList {
@@ -1030,11 +1116,39 @@ public:
         , ASTTypeParamList(std::move(ast_type_params))
         , super_traits_(std::move(super_traits))
         , methods_(std::move(methods))
-    {}
+    {
+        auto self_param = new ASTTypeParam(loc, new Identifier(loc, "Self"), ASTTypes());
+        self_param->trait_decl_ = this;
+        self_param_.reset(self_param);
+    }
 
+    /// The implicit type parameter @c Self which stands for the type implementing this trait.
+    const ASTTypeParam* self_param() const { return self_param_.get(); }
     const ASTTypeApps& super_traits() const { return super_traits_; }
     const FnDecls& methods() const { return methods_; }
     const MethodTable& method_table() const { return method_table_; }
+    const FnDecl* find_method(Symbol symbol) const { return method_table_.lookup(symbol).value_or(nullptr); }
+    /// All @p ImplItem%s of this trait in the program.
+    const std::vector<const ImplItem*>& impls() const { return impls_; }
+    /// All traits which name this one as super trait.
+    const std::vector<const TraitDecl*>& sub_traits() const { return sub_traits_; }
+    /**
+     * The trait arguments @p args consist of the implementing type followed by the type arguments of this trait.
+     * Puts them at the depths of @p self_param and the type parameters into @p by_depth - as expected by @p substitute.
+     */
+    void trait_args_by_depth(Types args, std::vector<const Type*>& by_depth) const;
+    /**
+     * Finds an @p ImplItem of this trait - or of one of its sub traits - for the trait arguments @p args.
+     * If @p method is given, only an impl which defines this method qualifies.
+     * @p impl_args receives the types of its type parameters by depth; returns @c nullptr if there is no such impl.
+     */
+    const ImplItem* find_impl(Types args, std::vector<const Type*>& impl_args, Symbol method = Symbol()) const;
+    /**
+     * Resolves the method @p symbol of this trait for the monomorphic trait arguments @p args.
+     * This is the method of the matching impl or - if no impl defines it - the default method of this trait.
+     * @p type_args receives the types of the type parameters of its owner by depth.
+     */
+    const FnDecl* resolve_method(Symbol symbol, Types args, std::vector<const Type*>& type_args) const;
 
     void bind(NameSema&) const override;
     void emit(CodeGen&) const override;
@@ -1045,9 +1159,14 @@ private:
     const Type* infer_head(InferSema&) const override;
     void check(TypeSema&) const override;
 
+    std::unique_ptr<const ASTTypeParam> self_param_;
     ASTTypeApps super_traits_;
     FnDecls methods_;
     mutable MethodTable method_table_;
+    mutable std::vector<const ImplItem*> impls_;
+    mutable std::vector<const TraitDecl*> sub_traits_;
+
+    friend class ImplItem;
 };
 
 class ImplItem : public Item, public ASTTypeParamList {
@@ -1063,10 +1182,21 @@ public:
 
     /// May be nullptr as trait is optional.
     const ASTType* trait() const { return trait_.get(); }
+    /// The @p TraitDecl named by @p trait; @c nullptr for inherent impls.
+    const TraitDecl* trait_decl() const;
+    /// The type implementing @p trait_decl followed by the type arguments of the trait.
+    std::vector<const Type*> trait_args() const;
+    /**
+     * Does this impl implement @p trait_decl with the trait arguments @p args - directly or via a super trait?
+     * @p impl_args receives the types of the type parameters of this impl by depth.
+     */
+    bool implements(const TraitDecl* trait_decl, Types args, std::vector<const Type*>& impl_args) const;
     const ASTType* ast_type() const { return ast_type_.get(); }
     const FnDecls& methods() const { return methods_; }
     const FnDecl* method(size_t i) const { return methods_[i].get(); }
     size_t num_methods() const { return methods_.size(); }
+    const MethodTable& method_table() const { return method_table_; }
+    const FnDecl* find_method(Symbol symbol) const { return method_table_.lookup(symbol).value_or(nullptr); }
     const thorin::Def* def() const { return def_; }
 
     void bind(NameSema&) const override;
@@ -1081,6 +1211,7 @@ private:
     std::unique_ptr<const ASTType> trait_;
     std::unique_ptr<const ASTType> ast_type_;
     FnDecls methods_;
+    mutable MethodTable method_table_;
     mutable const thorin::Def* def_;
 };
 
@@ -1341,6 +1472,11 @@ public:
 
     const Expr* rhs() const { return rhs_.get(); }
     Tag tag() const { return tag_; }
+    /**
+     * Does this @c ~ allocation of static size live in the stack frame instead of the heap?
+     * @p borrow_check proves that it dies with the local it initializes - even in a loop it never touches the allocator.
+     */
+    bool is_in_frame() const { return in_frame_; }
 
     void write() const override;
     bool has_side_effect() const override;
@@ -1355,6 +1491,9 @@ private:
 
     Tag tag_;
     std::unique_ptr<const Expr> rhs_;
+    mutable bool in_frame_ = false;
+
+    friend class BorrowSema;
 };
 
 class InfixExpr : public Expr {
@@ -1437,6 +1576,15 @@ public:
     Symbol symbol() const { return identifier()->symbol(); }
     const FieldDecl* field_decl() const { return field_decl_; }
     uint32_t index() const { return field_decl()->index(); }
+    /**
+     * The method this expression names instead of a field - its receiver @p lhs is passed as first argument.
+     * A method of a @p TraitDecl is resolved to the impl of the actual receiver type during emission.
+     */
+    const FnDecl* method() const { return method_; }
+    /// The types of the type parameters of the @p FnDecl::owner of @p method; @c Self comes first for a trait.
+    Types method_type_args() const { return method_type_args_; }
+    /// The type of @p method including its @c self parameter after substituting @p method_type_args.
+    const FnType* method_type() const;
 
     void write() const override;
     void take_address() const override;
@@ -1452,6 +1600,10 @@ private:
     std::unique_ptr<const Expr> lhs_;
     std::unique_ptr<const Identifier> identifier_;
     mutable const FieldDecl* field_decl_ = nullptr;
+    mutable const FnDecl* method_ = nullptr;
+    mutable std::vector<const Type*> method_type_args_;
+
+    friend class InferSema;
 };
 
 class CastExpr : public Expr {
@@ -1721,6 +1873,8 @@ public:
     {}
 
     const Expr* lhs() const { return lhs_.get(); }
+    /// Is the index of this subscript of a slice known to be in bounds such that no bounds check is emitted for it?
+    bool is_in_bounds() const { return in_bounds_; }
 
     void write() const override;
     bool has_side_effect() const override;
@@ -1735,8 +1889,40 @@ private:
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const Expr> lhs_;
+    mutable bool in_bounds_ = false;
 
     friend class CodeGen;
+    friend class TypeSema;
+};
+
+/**
+ * <tt>lhs(lo..hi)</tt> borrows the elements @p lo up to - but excluding - @p hi of an array or slice as slice.
+ * An omitted bound is an @p EmptyExpr; it defaults to @c 0 and the length of @p lhs, respectively.
+ */
+class SliceExpr : public Expr {
+public:
+    SliceExpr(Loc loc, const Expr* lhs, const Expr* lo, const Expr* hi)
+        : Expr(loc)
+        , lhs_(dock(lhs_, lhs))
+        , lo_(dock(lo_, lo))
+        , hi_(dock(hi_, hi))
+    {}
+
+    const Expr* lhs() const { return lhs_.get(); }
+    const Expr* lo() const { return lo_.get(); }
+    const Expr* hi() const { return hi_.get(); }
+
+    void bind(NameSema&) const override;
+    Stream& stream(Stream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+    const thorin::Def* remit(CodeGen&) const override;
+
+    std::unique_ptr<const Expr> lhs_;
+    std::unique_ptr<const Expr> lo_;
+    std::unique_ptr<const Expr> hi_;
 };
 
 class BlockExpr : public Expr {
@@ -1918,7 +2104,6 @@ public:
     virtual void bind(NameSema&) const = 0;
     virtual void emit(CodeGen&, const thorin::Def*) const = 0;
     virtual const thorin::Def* emit(CodeGen&) const { return nullptr; }
-    virtual const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const = 0;
     virtual bool is_refutable() const = 0;
 
 private:
@@ -1942,7 +2127,6 @@ public:
 
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
-    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
     bool is_refutable() const override;
     Stream& stream(Stream&) const override;
 
@@ -1964,7 +2148,6 @@ public:
 
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
-    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
     bool is_refutable() const override;
     Stream& stream(Stream&) const override;
 
@@ -1990,7 +2173,6 @@ public:
 
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
-    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
     bool is_refutable() const override;
     Stream& stream(Stream&) const override;
 
@@ -2016,7 +2198,6 @@ public:
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
     const thorin::Def* emit(CodeGen&) const override;
-    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
     bool is_refutable() const override;
     Stream& stream(Stream&) const override;
 
@@ -2040,7 +2221,6 @@ public:
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
     const thorin::Def* emit(CodeGen&) const override;
-    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
     bool is_refutable() const override;
     Stream& stream(Stream&) const override;
 
@@ -2051,6 +2231,61 @@ private:
     std::unique_ptr<const Expr> chr_;
 };
 
+/// Matches all values from @p lo up to and including @p hi; both bounds are @p LiteralPtrn%s or @p CharPtrn%s.
+class RangePtrn : public Ptrn {
+public:
+    RangePtrn(Loc loc, const Ptrn* lo, const Ptrn* hi)
+        : Ptrn(loc)
+        , lo_(lo)
+        , hi_(hi)
+    {}
+
+    const Ptrn* lo() const { return lo_.get(); }
+    const Ptrn* hi() const { return hi_.get(); }
+
+    void bind(NameSema&) const override;
+    void emit(CodeGen&, const thorin::Def*) const override;
+    bool is_refutable() const override;
+    Stream& stream(Stream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    std::unique_ptr<const Ptrn> lo_;
+    std::unique_ptr<const Ptrn> hi_;
+};
+
+/// Matches if any of its alternatives matches; alternatives must not bind variables.
+class OrPtrn : public Ptrn {
+public:
+    OrPtrn(Loc loc, Ptrns&& alts)
+        : Ptrn(loc)
+        , alts_(std::move(alts))
+    {}
+
+    const Ptrns& alts() const { return alts_; }
+    const Ptrn* alt(size_t i) const { return alts_[i].get(); }
+    size_t num_alts() const { return alts_.size(); }
+
+    void bind(NameSema&) const override;
+    void emit(CodeGen&, const thorin::Def*) const override;
+    bool is_refutable() const override;
+    Stream& stream(Stream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    Ptrns alts_;
+};
+
+/**
+ * The value of the integer @p LiteralPtrn or @p CharPtrn @p ptrn as unsigned number.
+ * Signed values are offset by their smallest value, so the order of values of any integer type is kept.
+ */
+uint64_t ordinal(const Ptrn* ptrn);
+
 //------------------------------------------------------------------------------
 
 /*
@@ -14,6 +14,7 @@ Prec prec = Prec::Bottom;
 Stream& ErrorASTType::stream(Stream& s) const { return s << "<error>"; }
 Stream& DefiniteArrayASTType::stream(Stream& s) const { return s.fmt("[{} * {}]", elem_ast_type(), dim()); }
 Stream& IndefiniteArrayASTType::stream(Stream& s) const { return s.fmt("[{}]", elem_ast_type()); }
+Stream& SliceASTType::stream(Stream& s) const { return s.fmt("[{}..]", elem_ast_type()); }
 Stream& TupleASTType::stream(Stream& s) const { return s.fmt("({, })", ast_type_args()); }
 Stream& SimdASTType::stream(Stream& s) const { return s.fmt("simd[{} * {}]", elem_ast_type(), size()); }
 
@@ -389,6 +390,23 @@ Stream& MapExpr::stream(Stream& s) const {
     return s;
 }
 
+Stream& SliceExpr::stream(Stream& s) const {
+    Prec l = Prec::Unary;
+    Prec old = prec;
+    bool paren = !fancy() || prec > l;
+    if (paren) s << "(";
+
+    prec = l;
+    s << lhs() << '(';
+    if (!lo()->isa<EmptyExpr>()) s << lo();
+    s << "..";
+    if (!hi()->isa<EmptyExpr>()) s << hi();
+    s << ')';
+    prec = old;
+    if (paren) s << ")";
+    return s;
+}
+
 Stream& FnExpr::stream(Stream& s) const {
     bool has_return_type = !params().empty() && params().back()->symbol() == "return";
     s << '|';
@@ -446,6 +464,8 @@ Stream& EnumPtrn::stream(Stream& s) const {
 
 Stream& LiteralPtrn::stream(Stream& s) const { return s << literal(); }
 Stream& CharPtrn::stream(Stream& s) const { return s << chr(); }
+Stream& RangePtrn::stream(Stream& s) const { return s.fmt("{}..={}", lo(), hi()); }
+Stream& OrPtrn::stream(Stream& s) const { return s.fmt("{ | }", alts()); }
 
 /*
  * statements
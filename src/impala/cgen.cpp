@@ -122,7 +122,10 @@ private:
             // &[T] -> T*
             // &[T * N] -> T*
             // &T -> T*
+            // &[T..] is a (pointer, length) pair and has no C counterpart
 
+            if (ptr_type->pointee()->isa<SliceType>())
+                return false;
             if (auto array_type = ptr_type->pointee()->isa<ArrayType>()) {
                 if (!ctype_from_impala(array_type->elem_type(), ctype_prefix, ctype_suffix))
                     return false;
@@ -0,0 +1,246 @@
+#include "impala/compile_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "impala/ast.h"
+#include "impala/impala.h"
+#include "impala/preparsed.h"
+#include "impala/time_report.h"
+#include "impala/sema/type.h"
+
+namespace impala {
+
+CompileCache::~CompileCache() {}
+
+#ifndef IMPALA_VERSION
+#define IMPALA_VERSION "unknown"
+#endif
+
+uint64_t CompileCache::hash(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data, uint64_t seed) {
+    // FNV-1a over all strings, each one preceded by its length
+    uint64_t hash = UINT64_C(14695981039346656037) ^ seed;
+    auto combine = [&] (const std::string& str) {
+        auto size = uint64_t(str.size());
+        for (size_t i = 0; i != sizeof(size); ++i)
+            hash = (hash ^ uint8_t(size >> (8 * i))) * UINT64_C(1099511628211);
+        for (auto c : str)
+            hash = (hash ^ uint8_t(c)) * UINT64_C(1099511628211);
+    };
+
+    for (const auto& name : file_names) combine(name);
+    for (const auto& data : file_data)  combine(data);
+    return hash;
+}
+
+std::string CompileCache::disk_path(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data) const {
+    // the options of the Context are part of the key as they change what the front end makes of the sources
+    std::vector<std::string> key = file_names;
+    key.emplace_back(IMPALA_VERSION);
+    key.emplace_back(std::to_string(lazy_bodies()) + std::to_string(bounds_checks()));
+
+    // two independent 64-bit hashes make accidental collisions of files that are never compared negligible
+    std::ostringstream path;
+    path << directory_ << '/' << std::hex;
+    path << hash(key, file_data, 0) << '-' << hash(key, file_data, UINT64_C(0x9E3779B97F4A7C15)) << preparsed_ext;
+    return path.str();
+}
+
+bool CompileCache::load_from_disk(Items& items, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // a corrupt or outdated module is just a miss
+    Items loaded;
+    try {
+        load(loaded, data.data(), data.data() + data.size(), path.c_str());
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    for (auto& item : loaded)
+        items.emplace_back(std::move(item));
+    ++num_disk_hits_;
+
+    // the modification time of a module is its last use
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void CompileCache::store_to_disk(const Items& items, const std::string& path) {
+    // write to a unique temporary first so that concurrent compilers never see half a module
+    auto tmp = path + '.' + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out)
+            return; // the cache is an optimization; an unwritable directory is no error
+        store(out, items);
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        std::remove(tmp.c_str());
+    else
+        evict_from_disk();
+}
+
+void CompileCache::evict_from_disk() {
+    namespace fs = std::filesystem;
+    struct Stored {
+        fs::path path;
+        fs::file_time_type last_use;
+        uintmax_t num_bytes;
+    };
+
+    // other processes may add or delete modules meanwhile; whatever vanishes is simply skipped
+    std::vector<Stored> stored;
+    uintmax_t num_bytes = 0;
+    std::error_code ec;
+    for (fs::directory_iterator i(directory_, ec), e; !ec && i != e; i.increment(ec)) {
+        if (!is_preparsed(i->path().filename().string()))
+            continue; // the directory may hold other files, too
+        std::error_code size_ec, time_ec;
+        auto size = i->file_size(size_ec);
+        auto time = i->last_write_time(time_ec);
+        if (size_ec || time_ec)
+            continue;
+        stored.push_back({i->path(), time, size});
+        num_bytes += size;
+    }
+
+    if (num_bytes <= max_disk_bytes_)
+        return;
+
+    std::sort(stored.begin(), stored.end(), [] (const Stored& s1, const Stored& s2) { return s1.last_use < s2.last_use; });
+    for (const auto& module : stored) {
+        if (num_bytes <= max_disk_bytes_)
+            break;
+        if (fs::remove(module.path, ec))
+            ++num_disk_evictions_;
+        num_bytes -= module.num_bytes;
+    }
+}
+
+const CompileCache::Entry* CompileCache::lookup(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data) {
+    if (!enabled())
+        return nullptr;
+
+    auto hash = CompileCache::hash(file_names, file_data);
+    for (auto& entry : entries_) {
+        if (entry->hash_ == hash && entry->file_names == file_names && entry->file_data == file_data) {
+            ++num_hits_;
+            entry->last_use_ = ++clock_;
+            return entry.get();
+        }
+    }
+
+    ++num_misses_;
+    return nullptr;
+}
+
+void CompileCache::insert(std::unique_ptr<Entry>&& entry) {
+    entry->hash_ = hash(entry->file_names, entry->file_data);
+    entry->last_use_ = ++clock_;
+    num_bytes_ += entry->num_bytes;
+    entries_.emplace_back(std::move(entry));
+    evict();
+}
+
+const CompileCache::Entry& CompileCache::check(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data) {
+    if (auto entry = lookup(file_names, file_data)) {
+        emit_diagnostic(entry->diagnostics);
+        num_warnings() += entry->num_warnings;
+        num_errors()   += entry->num_errors;
+        return *entry;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->file_names = file_names;
+    entry->file_data  = file_data;
+    int old_warnings = num_warnings(), old_errors = num_errors();
+    {
+        DiagnosticCapture capture(entry->diagnostics);
+        auto arena = std::make_unique<Arena>();
+        Items items;
+        {
+            TimeReport::Phase phase("parse");
+            Arena::Scope scope(*arena);
+            // lazy bodies are not part of preparsed modules
+            auto path = directory_.empty() || lazy_bodies() ? std::string() : disk_path(file_names, file_data);
+            if (path.empty() || !load_from_disk(items, path)) {
+                if (!path.empty())
+                    ++num_disk_misses_;
+                for (size_t i = 0, e = file_names.size(); i != e; ++i) {
+                    const auto& name = entry->file_names[i];
+                    const auto& data = entry->file_data[i];
+                    if (is_preparsed(name))
+                        load(items, data.data(), data.data() + data.size(), name.c_str());
+                    else
+                        parse(items, data.data(), data.data() + data.size(), name.c_str());
+                }
+
+                // a disk hit replays no diagnostics; thus, only clean parses are persisted
+                if (!path.empty() && num_warnings() == old_warnings && num_errors() == old_errors)
+                    store_to_disk(items, path);
+            }
+        }
+
+        entry->module = std::make_unique<const Module>(entry->file_names.front().c_str(), std::move(items), std::move(arena));
+        impala::check(entry->typetable, entry->module.get());
+    }
+    emit_diagnostic(entry->diagnostics);
+    entry->num_warnings = num_warnings() - old_warnings;
+    entry->num_errors   = num_errors() - old_errors;
+    entry->num_bytes    = entry->module->arena()->num_bytes() + entry->typetable->num_bytes();
+    for (const auto& data : entry->file_data)
+        entry->num_bytes += data.size();
+
+    // an entry that fits is the most recently used one and, thus, survives its own insertion
+    if (enabled() && entry->num_bytes <= max_bytes_) {
+        uncached_.reset();
+        insert(std::move(entry));
+        return *entries_.back();
+    }
+
+    uncached_ = std::move(entry);
+    return *uncached_;
+}
+
+void CompileCache::evict() {
+    while (num_bytes_ > max_bytes_ && !entries_.empty()) {
+        auto lru = std::min_element(entries_.begin(), entries_.end(),
+                                    [] (const auto& e1, const auto& e2) { return e1->last_use_ < e2->last_use_; });
+        num_bytes_ -= (*lru)->num_bytes;
+        ++num_evictions_;
+        entries_.erase(lru);
+    }
+}
+
+CompileCache& compile_cache() {
+    static CompileCache cache([] {
+        auto size = std::getenv("IMPALA_COMPILE_CACHE_SIZE");
+        return size != nullptr ? size_t(std::strtoull(size, nullptr, 10)) * 1024 * 1024 : size_t(0);
+    }(), [] {
+        auto dir = std::getenv("IMPALA_COMPILE_CACHE_DIR");
+        return dir != nullptr ? std::string(dir) : std::string();
+    }(), [] {
+        auto size = std::getenv("IMPALA_COMPILE_CACHE_DISK");
+        return size != nullptr ? size_t(std::strtoull(size, nullptr, 10)) * 1024 * 1024 : CompileCache::default_max_disk_bytes;
+    }());
+    return cache;
+}
+
+}
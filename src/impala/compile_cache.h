@@ -0,0 +1,130 @@
+#ifndef IMPALA_COMPILE_CACHE_H
+#define IMPALA_COMPILE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "impala/impala.h"
+
+namespace impala {
+
+class Module;
+class TypeTable;
+
+/**
+ * Keeps the results of semantic analysis of recent compilations keyed by the names and contents of their files.
+ * When the same program is compiled again, parsing and semantic analysis are skipped and the cached @p Module is
+ * emitted right away.
+ * The least recently used entries are evicted as soon as all entries together exceed @p max_bytes.
+ *
+ * With a @p directory, the parsed program is also persisted there as preparsed module, which outlives the process.
+ * Its file name is a key made of the compiler version, the options of the current @p Context and the file names and
+ * contents.
+ * This part is a mere parse cache: a disk hit only skips lexing and parsing - semantic analysis still runs on the
+ * loaded @p Item%s as preparsed modules hold neither resolved declarations nor types.
+ * The least recently used modules are deleted as soon as all modules in @p directory exceed @p max_disk_bytes.
+ * The cache is not synchronized; @c compile uses it while holding its lock and the compile server from a single thread.
+ * Several processes may share a @p directory though.
+ */
+class CompileCache {
+public:
+    struct Entry {
+        std::vector<std::string> file_names;
+        std::vector<std::string> file_data;
+        std::unique_ptr<const Module> module;
+        std::unique_ptr<TypeTable> typetable;
+        std::string diagnostics; ///< Diagnostics of parsing and semantic analysis; replayed on each hit.
+        int num_warnings = 0;
+        int num_errors = 0;
+        size_t num_bytes = 0;    ///< Approximate memory held by this @p Entry.
+
+    private:
+        uint64_t hash_ = 0;
+        uint64_t last_use_ = 0;
+
+        friend class CompileCache;
+    };
+
+    static constexpr size_t default_max_disk_bytes = size_t(1024) * 1024 * 1024;
+
+    /// A @p max_bytes of 0 disables the cache in memory; an empty @p directory the one on disk.
+    explicit CompileCache(size_t max_bytes = 0, const std::string& directory = std::string(), size_t max_disk_bytes = default_max_disk_bytes)
+        : max_bytes_(max_bytes)
+        , directory_(directory)
+        , max_disk_bytes_(max_disk_bytes)
+    {}
+    CompileCache(const CompileCache&) = delete;
+    CompileCache& operator=(const CompileCache&) = delete;
+    ~CompileCache();
+
+    bool enabled() const { return max_bytes_ != 0; }
+    size_t max_bytes() const { return max_bytes_; }
+    void set_max_bytes(size_t max_bytes) { max_bytes_ = max_bytes; evict(); }
+    const std::string& directory() const { return directory_; }
+    /// An empty @p directory disables the persistent part of the cache.
+    void set_directory(const std::string& directory) { directory_ = directory; }
+    size_t max_disk_bytes() const { return max_disk_bytes_; }
+    void set_max_disk_bytes(size_t max_disk_bytes) { max_disk_bytes_ = max_disk_bytes; }
+
+    /// Returns the @p Entry for exactly these files or @c nullptr.
+    const Entry* lookup(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data);
+    /// Takes ownership of @p entry; evicts the least recently used entries - possibly @p entry itself if it is too large.
+    void insert(std::unique_ptr<Entry>&& entry);
+    /**
+     * Parses and checks the program consisting of @p file_names with the contents @p file_data unless it is cached.
+     * In both cases, the diagnostics are printed and added to the counters of the current @p Context.
+     * The returned @p Entry stays valid until the next call of @p check or @p insert.
+     */
+    const Entry& check(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data);
+
+    static uint64_t hash(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data, uint64_t seed = 0);
+    /// Path of the preparsed module persisted for these files in @p directory.
+    std::string disk_path(const std::vector<std::string>& file_names, const std::vector<std::string>& file_data) const;
+
+    /*
+     * statistics
+     */
+
+    size_t num_entries() const { return entries_.size(); }
+    size_t num_bytes() const { return num_bytes_; }
+    size_t num_hits() const { return num_hits_; }
+    size_t num_misses() const { return num_misses_; }
+    size_t num_evictions() const { return num_evictions_; }
+    size_t num_disk_hits() const { return num_disk_hits_; }     ///< How many misses have been loaded from @p directory instead of parsed.
+    size_t num_disk_misses() const { return num_disk_misses_; } ///< How many misses have been parsed although @p directory is set.
+    size_t num_disk_evictions() const { return num_disk_evictions_; }
+
+private:
+    void evict();
+    bool load_from_disk(Items& items, const std::string& path);
+    void store_to_disk(const Items& items, const std::string& path);
+    /// Deletes the least recently used modules in @p directory until they fit into @p max_disk_bytes.
+    void evict_from_disk();
+
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::unique_ptr<Entry> uncached_; ///< Last result of @p check that did not go into the cache.
+    size_t max_bytes_;
+    std::string directory_;
+    size_t max_disk_bytes_;
+    size_t num_bytes_ = 0;
+    uint64_t clock_ = 0;
+    size_t num_hits_ = 0;
+    size_t num_misses_ = 0;
+    size_t num_evictions_ = 0;
+    size_t num_disk_hits_ = 0;
+    size_t num_disk_misses_ = 0;
+    size_t num_disk_evictions_ = 0;
+};
+
+/**
+ * The @p CompileCache of @c compile; its size in MiB is taken from the environment variable @c IMPALA_COMPILE_CACHE_SIZE.
+ * Its @p directory is taken from @c IMPALA_COMPILE_CACHE_DIR and its @p max_disk_bytes in MiB from
+ * @c IMPALA_COMPILE_CACHE_DISK.
+ */
+CompileCache& compile_cache();
+
+}
+
+#endif
@@ -1,20 +1,102 @@
 #include "impala/ast.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "thorin/continuation.h"
 #include "thorin/primop.h"
 #include "thorin/type.h"
 #include "thorin/world.h"
+#include "thorin/transform/importer.h"
 #include "thorin/util/array.h"
 
 using namespace thorin;
 
 namespace impala {
 
+/// Guards the @p TypeTable, which instantiating polymorphic code extends, when several parts are emitted concurrently.
+static std::mutex typetable_mutex;
+
+/// @p symbol without its quotation marks; unlike @c Symbol::remove_quotation, this interns no new @c Symbol.
+static std::string unquote(Symbol symbol) {
+    std::string str = symbol.str();
+    if (str.size() >= 2 && str.front() == '"' && str.back() == '"')
+        return str.substr(1, str.size() - 2);
+    return str;
+}
+
+static bool is_polymorphic_primop_or_intrinsic(const std::string& name);
+
 class CodeGen {
 public:
-    CodeGen(World& world)
+    /**
+     * With @p is_part set, this emits a part of a program into a @p World of its own which is merged later on:
+     * the continuations to be made external are only collected in @p externals then.
+     */
+    CodeGen(World& world, bool is_part = false)
         : world(world)
+        , is_part_(is_part)
     {}
+    /// Clears the emission state stored in the AST so it can be emitted into another @p World later on.
+    ~CodeGen() {
+        for (auto& reset : resets_)
+            reset();
+    }
+
+    /// Sets the emission state @p field of an AST node to @p value; it is reset to @c nullptr by @p ~CodeGen.
+    template<class T, class U>
+    T* assign(T*& field, U* value) {
+        resets_.emplace_back([&field] { field = nullptr; });
+        return field = value;
+    }
+
+    void make_external(Continuation* continuation) {
+        externals_.push_back(continuation);
+        if (!is_part_)
+            world.make_external(continuation);
+    }
+
+    /// The continuations made external so far - in the order in which they were created.
+    const std::vector<Continuation*>& externals() const { return externals_; }
+
+    /**
+     * The @c Def of @p decl.
+     * The functions of extern blocks are kept here rather than in the AST: each part of a program declares them anew.
+     */
+    const Def* def(const Decl* decl) {
+        auto fn_decl = decl->isa<FnDecl>();
+        if (fn_decl == nullptr || !fn_decl->is_extern() || fn_decl->body() != nullptr)
+            return decl->def();
+
+        auto i = declarations_.find(fn_decl);
+        if (i != declarations_.end())
+            return i->second;
+        return declarations_[fn_decl] = declare(fn_decl);
+    }
+
+    /// The declaration of the function @p fn_decl of an extern block; there is none for polymorphic ones and primops.
+    Continuation* declare(const FnDecl* fn_decl) {
+        auto abi = fn_decl->abi();
+        auto name = unquote(fn_decl->fn_symbol());
+        if (fn_decl->num_ast_type_params() != 0 || (abi == "\"thorin\"" && is_polymorphic_primop_or_intrinsic(name)))
+            return nullptr;
+
+        auto continuation = world.continuation(convert(fn_decl->fn_type())->as<thorin::FnType>(), {name, fn_decl->loc()});
+        if (abi == "" || abi == "\"C\"") {
+            make_external(continuation);
+        } else if (abi == "\"device\"") {
+            make_external(continuation);
+            continuation->attributes().cc = thorin::CC::Device;
+        } else if (abi == "\"thorin\"") {
+            continuation->set_intrinsic();
+        }
+        return continuation;
+    }
 
     /// Continuation of type cn()
     Continuation* basicblock(Debug dbg) { return world.continuation(world.fn_type(), dbg); }
@@ -84,10 +166,99 @@ public:
     Continuation* create_continuation(const LocalDecl* decl) {
         auto result = world.continuation(convert(decl->type())->as<thorin::FnType>(), decl->debug());
         result->param(0)->set_name("mem");
-        decl->def_ = result;
+        assign(decl->def_, result);
+        owned_marks_[decl] = owned_.size();
         return result;
     }
 
+    /// Releases the memory of the @p owned_ locals from @p mark on - the innermost one first.
+    void release(size_t mark, Loc loc) {
+        for (size_t i = owned_.size(); i-- != mark;) {
+            auto local = owned_[i];
+            auto ptr = local->is_mut() ? load(local->def(), loc) : local->def();
+
+            if (release_ == nullptr) {
+                auto fn_type = world.fn_type({
+                    world.mem_type(), world.type_qs32(), world.ptr_type(world.type_pu8()),
+                    world.fn_type({ world.mem_type() }) });
+                release_ = world.continuation(fn_type, {"anydsl_release", loc});
+                make_external(release_);
+            }
+
+            auto arg = world.bitcast(release_->param(2)->type(), ptr, loc);
+            std::tie(cur_bb, std::ignore) = call(release_, {cur_mem, world.literal_qs32(0, loc), arg}, world.tuple_type({}), {"release", loc});
+            cur_mem = cur_bb->param(0);
+        }
+    }
+
+    /// The first entry of @p owned_ which is out of scope once the call of @p callee, which never returns, is done.
+    size_t exit_mark(const Expr* callee) const {
+        auto path = callee->skip_rvalue()->isa<PathExpr>();
+        auto local = path && path->value_decl() ? path->value_decl()->isa<LocalDecl>() : nullptr;
+        if (local != nullptr) {
+            auto i = owned_marks_.find(local);
+            if (i != owned_marks_.end())
+                return i->second;
+            // return or the continuation of a for body leave the function
+            if (local->isa<Param>()) {
+                for (auto j = owned_bases_.rbegin(), e = owned_bases_.rend(); j != e; ++j) {
+                    if (j->first == local->fn())
+                        return j->second;
+                }
+            }
+        }
+        return owned_.size();
+    }
+
+    /// Goes on only if @p cond holds - the program is aborted otherwise.
+    void check_bounds(const Def* cond, Loc loc) {
+        auto in_bounds     = basicblock({"in_bounds",     loc});
+        auto out_of_bounds = basicblock({"out_of_bounds", loc});
+        cur_bb->branch(cond, in_bounds, out_of_bounds, loc);
+
+        if (abort_ == nullptr) {
+            abort_ = world.continuation(world.fn_type({ world.mem_type(), world.fn_type({ world.mem_type() }) }), {"abort", loc});
+            make_external(abort_);
+        }
+
+        auto mem = cur_mem;
+        cur_bb = out_of_bounds;
+        std::tie(cur_bb, std::ignore) = call(abort_, {mem}, world.tuple_type({}), {"abort", loc});
+        cur_bb->jump(in_bounds, {}, loc); // never taken as abort does not return
+        enter(in_bounds, mem);
+    }
+
+    /**
+     * Checks @c 0 <= @p index < @p len if @c -fbounds-checks is given and returns the @p index to address with.
+     * The comparison happens in the wider of both types so that nothing is truncated:
+     * @p len is extended to the type of @p index - it is never negative - unless @p index has less than 32 bits.
+     */
+    const Def* check_index(const Def* index, const Type* index_type, const Def* len, Loc loc) {
+        if (bounds_checks()) {
+            if (is_i8(index_type) || is_i16(index_type) || is_u8(index_type) || is_u16(index_type))
+                index = world.cast(len->type(), index, loc);
+            else
+                len = world.cast(index->type(), len, loc);
+            auto zero = world.cast(index->type(), world.literal_qs32(0, loc), loc);
+            check_bounds(world.arithop_and(world.cmp_ge(index, zero, loc), world.cmp_lt(index, len, loc), loc), loc);
+        }
+        return index;
+    }
+
+    /// The address of @p expr - a temporary copy in the frame if @p expr is no lvalue.
+    const Def* address(const Expr* expr, Loc loc) {
+        if (expr->type()->isa<RefType>())
+            return expr->lemit(*this);
+
+        auto def = expr->remit(*this);
+        if (def->dep() == thorin::Dep::Bot)
+            return world.global(def, /*mutable*/ false, loc);
+
+        auto slot = world.slot(convert(expr->type()), frame(), loc);
+        store(slot, def, loc);
+        return slot;
+    }
+
     const Def* load(const Def* ptr, Loc loc) {
         auto l = world.load(cur_mem, ptr, loc);
         cur_mem = world.extract(l, 0_s, loc);
@@ -98,6 +269,67 @@ public:
         cur_mem = world.store(cur_mem, ptr, val, loc);
     }
 
+    /// The constant @p value of type @p type.
+    const Def* constant(const ConstValue& value, const Type* type, Loc loc) {
+        type = subst(type);
+        if (value.is_prim()) {
+            thorin::PrimTypeTag ttag;
+            switch (value.tag()) {
+#define IMPALA_TYPE(itype, ttype) \
+                case PrimType_##itype: ttag = thorin::PrimType_##ttype; break;
+#include "impala/tokenlist.h"
+                default: THORIN_UNREACHABLE;
+            }
+            auto literal = world.literal(ttag, value.box(), loc);
+            // an integer cast to a pointer
+            return type->isa<PtrType>() ? world.convert(convert(type), literal, loc) : literal;
+        }
+        if (auto fn_decl = value.fn_decl())
+            return def(fn_decl);
+
+        Array<const Def*> ops(value.num_elems());
+        if (auto array_type = type->isa<DefiniteArrayType>()) {
+            for (size_t i = 0, e = ops.size(); i != e; ++i)
+                ops[i] = constant(value.elem(i), array_type->elem_type(), loc);
+            return world.definite_array(convert(array_type->elem_type()), ops, loc);
+        }
+        if (auto simd_type = type->isa<SimdType>()) {
+            for (size_t i = 0, e = ops.size(); i != e; ++i)
+                ops[i] = constant(value.elem(i), simd_type->elem_type(), loc);
+            return world.vector(ops, loc);
+        }
+
+        for (size_t i = 0, e = ops.size(); i != e; ++i)
+            ops[i] = constant(value.elem(i), type->op(i), loc);
+        if (type->isa<StructType>())
+            return world.struct_agg(convert(type)->as<thorin::StructType>(), ops, loc);
+        return world.tuple(ops, loc);
+    }
+
+    /**
+     * The address of @p expr within the global of an immutable static if @p expr names an element of one.
+     * Returns @c nullptr otherwise.
+     */
+    const Def* static_address(const Expr* expr) {
+        expr = expr->skip_rvalue();
+        if (auto path = expr->isa<PathExpr>()) {
+            auto static_item = path->value_decl() ? path->value_decl()->isa<StaticItem>() : nullptr;
+            if (static_item != nullptr && !static_item->is_mut() && static_item->value() != nullptr)
+                return static_item->def();
+        } else if (auto map = expr->isa<MapExpr>()) {
+            if (unpack_ref_type(map->lhs()->type())->isa<DefiniteArrayType>()) {
+                if (auto agg = static_address(map->lhs()))
+                    return world.lea(agg, map->arg(0)->remit(*this), map->loc());
+            }
+        } else if (auto field = expr->isa<FieldExpr>()) {
+            if (field->method() == nullptr && unpack_ref_type(field->lhs()->type())->isa<StructType>()) {
+                if (auto agg = static_address(field->lhs()))
+                    return world.lea(agg, world.literal_qu32(field->index(), field->loc()), field->loc());
+            }
+        }
+        return nullptr;
+    }
+
     const Def* alloc(const thorin::Type* type, const Def* extra, Debug dbg) {
         if (!extra)
             extra = world.literal_qu64(0, dbg);
@@ -106,9 +338,20 @@ public:
         return world.extract(alloc, 1, dbg);
     }
 
+    /// Substitutes the type arguments of the instance being emitted into @p type.
+    const Type* subst(const Type* type) const {
+        if (type->is_monomorphic())
+            return type;
+        std::lock_guard<std::mutex> guard(typetable_mutex);
+        return substitute(type, type_args_);
+    }
+
     const thorin::Type* convert(const Type* type) {
+        type = subst(type);
         if (auto t = thorin_type(type))
             return t;
+        if (type->is_polymorphic()) // a nominal type whose fields depend on the instance being emitted
+            resets_.emplace_back([this, type] { impala2thorin_.erase(type); });
         auto t = convert_rec(type);
         return thorin_type(type) = t;
     }
@@ -116,13 +359,92 @@ public:
     const thorin::Type* convert_rec(const Type*);
     const thorin::Type*& thorin_type(const Type* type) { return impala2thorin_[type]; }
 
+    /**
+     * The continuation of @p fn_decl instantiated with the monomorphic types @p type_args by depth.
+     * Its body is emitted later on by @p emit_instances.
+     */
+    Continuation* instance(const FnDecl* fn_decl, std::vector<const Type*>&& type_args);
+    /// The continuation a call of the method named by @p field jumps to - the implementation for the receiver type.
+    Continuation* method(const FieldExpr* field);
+    /// Emits the bodies of all instances requested so far - including the ones requested meanwhile.
+    void emit_instances();
+
     World& world;
     const Fn* cur_fn = nullptr;
     TypeMap<const thorin::Type*> impala2thorin_;
     Continuation* cur_bb = nullptr;
     const Def* cur_mem = nullptr;
+    std::vector<const Type*> type_args_; ///< The type arguments of the instance being emitted by depth.
+    std::vector<const LocalDecl*> owned_; ///< The @p LocalDecl::is_released locals in scope.
+    std::vector<std::pair<const Fn*, size_t>> owned_bases_; ///< The size of @p owned_ when each function was entered.
+    thorin::GIDMap<const LocalDecl*, size_t> owned_marks_;  ///< The size of @p owned_ when a loop was entered.
+
+private:
+    struct Instance {
+        const FnDecl* fn_decl;
+        std::vector<const Type*> type_args;
+        Continuation* continuation;
+    };
+
+    bool is_part_;
+    std::vector<Continuation*> externals_;
+    thorin::GIDMap<const FnDecl*, Continuation*> declarations_;
+    std::vector<std::function<void()>> resets_;
+    Continuation* release_ = nullptr;
+    Continuation* abort_ = nullptr;
+    std::map<std::pair<const FnDecl*, std::vector<const Type*>>, Continuation*> instances_;
+    std::vector<Instance> todo_;
 };
 
+Continuation* CodeGen::instance(const FnDecl* fn_decl, std::vector<const Type*>&& type_args) {
+    auto& continuation = instances_[std::make_pair(fn_decl, type_args)];
+    if (continuation == nullptr) {
+        {
+            THORIN_PUSH(type_args_, type_args);
+            auto fn_type = convert(fn_decl->fn_type())->as<thorin::FnType>();
+            continuation = world.continuation(fn_type, {unquote(fn_decl->fn_symbol()), fn_decl->loc()});
+        }
+        todo_.push_back({fn_decl, std::move(type_args), continuation});
+    }
+    return continuation;
+}
+
+Continuation* CodeGen::method(const FieldExpr* field) {
+    std::vector<const Type*> type_args;
+    for (auto type_arg : field->method_type_args())
+        type_args.push_back(subst(type_arg));
+
+    auto fn_decl = field->method();
+    std::vector<const Type*> by_depth;
+    if (auto trait_decl = fn_decl->owner()->isa<TraitDecl>()) {
+        std::lock_guard<std::mutex> guard(typetable_mutex); // matching impls substitutes types
+        fn_decl = trait_decl->resolve_method(field->symbol(), type_args, by_depth);
+        assert(fn_decl != nullptr && "type analysis checks that the method is implemented");
+    } else {
+        fn_decl->owner()->as<ImplItem>()->type_args_by_depth(type_args, by_depth);
+    }
+
+    return instance(fn_decl, std::move(by_depth));
+}
+
+void CodeGen::emit_instances() {
+    for (size_t i = 0; i != todo_.size(); ++i) {
+        auto todo = todo_[i];
+        auto mark = resets_.size();
+        {
+            THORIN_PUSH(type_args_, todo.type_args);
+            todo.fn_decl->emit_instance(*this, todo.continuation);
+        }
+
+        // the next instance of this function starts with a clean emission state
+        while (resets_.size() != mark) {
+            resets_.back()();
+            resets_.pop_back();
+        }
+    }
+    todo_.clear();
+}
+
 /*
  * Type
  */
@@ -165,11 +487,19 @@ const thorin::Type* CodeGen::convert_rec(const Type* type) {
         }
         return e;
     } else if (auto ptr_type = type->isa<PtrType>()) {
-        return world.ptr_type(convert(ptr_type->pointee()), 1, -1, thorin::AddrSpace(ptr_type->addr_space()));
+        auto addr_space = thorin::AddrSpace(ptr_type->addr_space());
+        // a pointer to a slice is the pointer to its elements paired with its length
+        if (auto slice_type = ptr_type->pointee()->isa<SliceType>()) {
+            auto elems = world.ptr_type(world.indefinite_array_type(convert(slice_type->elem_type())), 1, -1, addr_space);
+            return world.tuple_type({ elems, world.type_qs32() });
+        }
+        return world.ptr_type(convert(ptr_type->pointee()), 1, -1, addr_space);
     } else if (auto definite_array_type = type->isa<DefiniteArrayType>()) {
         return world.definite_array_type(convert(definite_array_type->elem_type()), definite_array_type->dim());
     } else if (auto indefinite_array_type = type->isa<IndefiniteArrayType>()) {
         return world.indefinite_array_type(convert(indefinite_array_type->elem_type()));
+    } else if (auto slice_type = type->isa<SliceType>()) {
+        return world.indefinite_array_type(convert(slice_type->elem_type()));
     } else if (auto simd_type = type->isa<SimdType>()) {
         return world.prim_type(convert(simd_type->elem_type())->as<thorin::PrimType>()->primtype_tag(), simd_type->dim());
     } else if (type->isa<NoRetType>()) {
@@ -189,11 +519,14 @@ void LocalDecl::emit(CodeGen& cg, const Def* init) const {
     init = init ? init : cg.world.bottom(thorin_type);
 
     if (is_mut()) {
-        def_ = cg.world.slot(thorin_type, cg.frame(), debug());
+        cg.assign(def_, cg.world.slot(thorin_type, cg.frame(), debug()));
         cg.cur_mem = cg.world.store(cg.cur_mem, def_, init, debug());
     } else {
-        def_ = init;
+        cg.assign(def_, init);
     }
+
+    if (is_released())
+        cg.owned_.push_back(this);
 }
 
 const thorin::Type* OptionDecl::variant_type(CodeGen& cg) const {
@@ -206,7 +539,7 @@ const thorin::Type* OptionDecl::variant_type(CodeGen& cg) const {
 
 Continuation* Fn::fn_emit_head(CodeGen& cg, Loc loc) const {
     auto t = cg.convert(fn_type())->as<thorin::FnType>();
-    return continuation_ = cg.world.continuation(t, {fn_symbol().remove_quotation(), loc});
+    return cg.assign(continuation_, cg.world.continuation(t, {unquote(fn_symbol()), loc}));
 }
 
 void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
@@ -214,6 +547,7 @@ void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
     THORIN_PUSH(cg.cur_fn, this);
     THORIN_PUSH(cg.cur_bb, continuation());
     auto old_mem = cg.cur_mem;
+    cg.owned_bases_.emplace_back(this, cg.owned_.size());
 
     // setup memory + frame
     {
@@ -222,7 +556,7 @@ void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
         mem_param->set_name("mem");
         auto enter = cg.world.enter(mem_param, loc);
         cg.cur_mem = cg.world.extract(enter, 0_s, loc);
-        frame_ =     cg.world.extract(enter, 1_s, loc);
+        cg.assign(frame_, cg.world.extract(enter, 1_s, loc));
 
         // name params and setup store locs
         for (auto&& param : params()) {
@@ -235,14 +569,14 @@ void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
 
         if (continuation()->num_params() != 0
                 && continuation()->params().back()->type()->isa<thorin::FnType>())
-            ret_param_ = continuation()->params().back();
+            cg.assign(ret_param_, continuation()->params().back());
     }
 
     // descend into body
     auto def = body()->remit(cg);
     if (def) {
         // flatten returned values
-        if (auto tuple = body()->type()->isa<TupleType>()) {
+        if (auto tuple = cg.subst(body()->type())->isa<TupleType>()) {
             Array<const Def*> ret_values(tuple->num_ops() + 1);
             for (size_t i = 0, e = tuple->num_ops(); i != e; ++i)
                 ret_values[i + 1] = cg.world.extract(def, i);
@@ -251,6 +585,7 @@ void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
         } else
             cg.cur_bb->jump(ret_param(), {cg.cur_mem, def}, loc.anew_finis());
     }
+    cg.owned_bases_.pop_back();
 
     // now handle the filter
     {
@@ -283,8 +618,16 @@ void Fn::fn_emit_body(CodeGen& cg, Loc loc) const {
  */
 
 void Module::emit(CodeGen& cg) const {
-    for (auto&& item : items()) item->emit_head(cg);
-    for (auto&& item : items()) item->emit(cg);
+    // unreachable items would be removed by World::cleanup anyway
+    for (auto&& item : items()) {
+        if (item->is_reachable())
+            item->emit_head(cg);
+    }
+    for (auto&& item : items()) {
+        if (item->is_reachable())
+            item->emit(cg);
+    }
+    cg.emit_instances();
 }
 
 static bool is_polymorphic_primop_or_intrinsic(const std::string& name) {
@@ -307,51 +650,55 @@ static bool is_polymorphic_primop_or_intrinsic(const std::string& name) {
 
 void FnDecl::emit_head(CodeGen& cg) const {
     assert(def_ == nullptr);
-    // no code is emitted for primops
-    if (is_extern() && abi() == "\"thorin\"" &&
-        is_polymorphic_primop_or_intrinsic(fn_symbol().remove_quotation()))
+    // polymorphic functions are instantiated on demand
+    if (num_ast_type_params() != 0)
         return;
 
+    // functions of extern blocks are declared by the code generator - see CodeGen::def
+    if (is_extern() && body() == nullptr) {
+        cg.def(this);
+        return;
+    }
+
     // create thorin function
-    def_ = fn_emit_head(cg, loc());
+    cg.assign(def_, fn_emit_head(cg, loc()));
     if (is_extern() && abi() == "")
-        cg.world.make_external(continuation());
+        cg.make_external(continuation());
 
     // handle main function
     if (symbol() == "main")
-        cg.world.make_external(continuation());
+        cg.make_external(continuation());
 }
 
 void FnDecl::emit(CodeGen& cg) const {
-    if (body())
+    if (body() && continuation())
         fn_emit_body(cg, loc());
 }
 
+void FnDecl::emit_instance(CodeGen& cg, Continuation* continuation) const {
+    cg.assign(continuation_, continuation);
+    fn_emit_body(cg, loc());
+}
+
 void ExternBlock::emit_head(CodeGen& cg) const {
-    for (auto&& fn_decl : fn_decls()) {
+    for (auto&& fn_decl : fn_decls())
         fn_decl->emit_head(cg);
-        auto continuation = fn_decl->continuation();
-        if (abi() == "\"C\"")
-            cg.world.make_external(continuation);
-        else if (abi() == "\"device\"") {
-            cg.world.make_external(continuation);
-            continuation->attributes().cc = thorin::CC::Device;
-        } else if (abi() == "\"thorin\"" && continuation) // no continuation for primops
-            continuation->set_intrinsic();
-    }
 }
 
 void ModuleDecl::emit(CodeGen&) const {}
-void ImplItem::emit(CodeGen&) const {}
+void ImplItem::emit(CodeGen&) const {} // methods are instantiated on demand by the calls resolved to them
 
 void StaticItem::emit_head(CodeGen& cg) const {
-    def_ = cg.world.global(cg.world.bottom(cg.convert(type()), loc()));
+    cg.assign(def_, cg.world.global(cg.world.bottom(cg.convert(type()), loc())));
 }
 
 void StaticItem::emit(CodeGen& cg) const {
-    if (init()) {
+    // type checking has already evaluated the initializer - the functions it refers to have their heads by now
+    // initializers with enum variants or addresses, which a ConstValue cannot hold, are plain data and emitted directly
+    if (value() || init()) {
         auto old_def = def_;
-        def_ = cg.world.global(init()->remit(cg), is_mut(), debug());
+        auto init_def = value() ? cg.constant(*value(), type(), loc()) : init()->remit(cg);
+        cg.assign(def_, cg.world.global(init_def, is_mut(), debug()));
         old_def->replace_uses(def_);
     }
 }
@@ -365,7 +712,7 @@ void OptionDecl::emit(CodeGen& cg) const {
     auto variant_type = cg.convert(enum_type)->as<VariantType>();
     if (num_args() == 0) {
         auto bot = cg.world.bottom(variant_type->op(index()));
-        def_ = cg.world.variant(variant_type, bot, index());
+        cg.assign(def_, cg.world.variant(variant_type, bot, index()));
     } else {
         auto continuation = cg.world.continuation(cg.convert(type())->as<thorin::FnType>(), {symbol().str(), loc()});
         auto ret = continuation->param(continuation->num_params() - 1);
@@ -376,7 +723,7 @@ void OptionDecl::emit(CodeGen& cg) const {
         auto option_val = num_args() == 1 ? defs.back() : cg.world.tuple(defs);
         auto enum_val = cg.world.variant(variant_type, option_val, index());
         continuation->jump(ret, { mem, enum_val }, loc());
-        def_ = continuation;
+        cg.assign(def_, continuation);
     }
 }
 
@@ -440,26 +787,20 @@ const Def* RValueExpr::remit(CodeGen& cg) const {
     return src()->remit(cg);
 }
 
-const Def* PathExpr::lemit(CodeGen&) const {
+const Def* PathExpr::lemit(CodeGen& cg) const {
     assert(value_decl()->is_mut());
-    return value_decl()->def();
+    return cg.def(value_decl());
 }
 
 const Def* PathExpr::remit(CodeGen& cg) const {
-    auto def = value_decl()->def();
-    // This whole global thing is incorrect.
-    // Example:
-    // static a = 1;
-    // static b = a;
-    // Emitting this requires a load. Currently, it works because of the following hack.
-    // But the hack no longer works if the order is reversed:
-    // static b = a;
-    // static a = 1;
-    // In this case, during the emission of 'static b = a', the static item 'a' has not been replaced yet and is considered mutable.
-    auto global = def->isa<Global>();
-    if (global && !global->is_mutable())
-        return global->init();
-    return value_decl()->is_mut() || global ? cg.load(def, loc()) : def;
+    // the value of an immutable static is known, so folding it in needs no load
+    if (auto static_item = value_decl()->isa<StaticItem>()) {
+        if (!static_item->is_mut() && static_item->value() != nullptr)
+            return cg.constant(*static_item->value(), static_item->type(), loc());
+    }
+
+    auto def = cg.def(value_decl());
+    return value_decl()->is_mut() || def->isa<Global>() ? cg.load(def, loc()) : def;
 }
 
 const Def* PrefixExpr::remit(CodeGen& cg) const {
@@ -478,22 +819,23 @@ const Def* PrefixExpr::remit(CodeGen& cg) const {
         case NOT: return cg.world.arithop_not(rhs()->remit(cg), loc());
         case TILDE: {
             auto def = rhs()->remit(cg);
+            if (is_in_frame()) {
+                if (rhs()->isa<IndefiniteArrayExpr>()) {
+                    auto elem_type = def->type()->as<thorin::IndefiniteArrayType>()->elem_type();
+                    auto dim = rhs()->as<IndefiniteArrayExpr>()->dim()->as<LiteralExpr>()->get_u64();
+                    auto slot = cg.world.slot(cg.world.definite_array_type(elem_type, dim), cg.frame(), loc());
+                    return cg.world.bitcast(cg.convert(type()), slot, loc());
+                }
+                auto slot = cg.world.slot(def->type(), cg.frame(), loc());
+                cg.store(slot, def, loc());
+                return slot;
+            }
             auto ptr = cg.alloc(def->type(), rhs()->extra(), loc());
             cg.store(ptr, def, loc());
             return ptr;
         }
-        case AND: {
-            if (rhs()->type()->isa<RefType>())
-                return rhs()->lemit(cg);
-
-            auto def = rhs()->remit(cg);
-            if (def->dep() == thorin::Dep::Bot)
-                return cg.world.global(def, /*mutable*/ false, loc());
-
-            auto slot = cg.world.slot(cg.convert(rhs()->type()), cg.frame(), loc());
-            cg.store(slot, def, loc());
-            return slot;
-        }
+        case AND:
+            return cg.address(rhs(), loc());
         case MUT: {
             return rhs()->lemit(cg);
         }
@@ -620,7 +962,7 @@ const Def* TupleExpr::remit(CodeGen& cg) const {
 }
 
 const Def* IndefiniteArrayExpr::remit(CodeGen& cg) const {
-    extra_ = dim()->remit(cg);
+    cg.assign(extra_, dim()->remit(cg));
     return cg.world.indefinite_array(cg.convert(type())->as<thorin::IndefiniteArrayType>()->elem_type(), extra_, loc());
 }
 
@@ -639,11 +981,29 @@ const Def* StructExpr::remit(CodeGen& cg) const {
 }
 
 const Def* TypeAppExpr::lemit(CodeGen&) const { THORIN_UNREACHABLE; }
-const Def* TypeAppExpr::remit(CodeGen& /*cg*/) const { THORIN_UNREACHABLE; }
+
+const Def* TypeAppExpr::remit(CodeGen& cg) const {
+    auto fn_decl = lhs()->skip_rvalue()->as<PathExpr>()->value_decl()->as<FnDecl>();
+
+    // the type parameters of enclosing functions keep their types
+    std::vector<const Type*> type_args, by_depth = cg.type_args_;
+    for (auto type_arg : this->type_args())
+        type_args.push_back(cg.subst(type_arg));
+    fn_decl->type_args_by_depth(type_args, by_depth);
+    by_depth.resize(fn_decl->ast_type_params().back()->lambda_depth());
+
+    return cg.instance(fn_decl, std::move(by_depth));
+}
 
 const Def* MapExpr::lemit(CodeGen& cg) const {
     auto agg = lhs()->lemit(cg);
-    return cg.world.lea(agg, arg(0)->remit(cg), loc());
+    auto index = arg(0)->remit(cg);
+    if (unpack_ref_type(lhs()->type())->isa<SliceType>()) {
+        if (!is_in_bounds())
+            index = cg.check_index(index, cg.subst(arg(0)->type()), cg.world.extract(agg, 1_s, loc()), loc());
+        agg = cg.world.extract(agg, 0_s, loc());
+    }
+    return cg.world.lea(agg, index, loc());
 }
 
 const Def* MapExpr::remit(CodeGen& cg) const {
@@ -658,7 +1018,7 @@ const Def* MapExpr::remit(CodeGen& cg) const {
             if (auto path = callee->isa<PathExpr>()) {
                 if (auto fn_decl = path->value_decl()->isa<FnDecl>()) {
                     if (fn_decl->is_extern() && fn_decl->abi() == "\"thorin\"") {
-                        auto name = fn_decl->fn_symbol().remove_quotation();
+                        auto name = unquote(fn_decl->fn_symbol());
                         auto string_type = cg.world.ptr_type(cg.world.indefinite_array_type(cg.world.type_pu8()));
                         if (name == "alignof") {
                             return cg.world.align_of(cg.convert(type_expr->type_arg(0)), loc());
@@ -741,23 +1101,42 @@ const Def* MapExpr::remit(CodeGen& cg) const {
             }
         }
 
+        // a method call passes its receiver as first argument and jumps to the implementation for the receiver type
+        const Def* receiver = nullptr;
+        if (auto field = lhs()->skip_rvalue()->isa<FieldExpr>()) {
+            if (field->method()) {
+                dst = cg.method(field);
+                receiver = field->lhs()->remit(cg);
+            }
+        }
+
         dst = dst ? dst : lhs()->remit(cg);
 
         std::vector<const Def*> defs;
         defs.push_back(nullptr);    // reserve for mem but set later - some other args may update mem
+        if (receiver)
+            defs.push_back(receiver);
         for (auto&& arg : args())
             defs.push_back(arg.get()->remit(cg));
-        defs.front() = cg.cur_mem; // now get the current memory value
-
         auto ret_type = num_args() == fn_type->num_params() ? nullptr : cg.convert(fn_type->return_type());
+        if (ret_type == nullptr) // leaves the scopes up to the destination
+            cg.release(cg.exit_mark(lhs()), loc());
+        defs.front() = cg.cur_mem; // now get the current memory value
         const Def* ret;
         std::tie(cg.cur_bb, ret) = cg.call(dst, defs, ret_type, {dst->name() + "_cont", loc()});
         if (ret_type)
             cg.cur_mem = cg.cur_bb->param(0);
 
         return ret;
+    } else if (ltype->isa<SliceType>()) {
+        return cg.load(lemit(cg), loc());
     } else if (ltype->isa<ArrayType>() || ltype->isa<TupleType>() || ltype->isa<SimdType>()) {
         auto index = arg(0)->remit(cg);
+        // look up a table in a static with a variable index in its read-only global instead of materializing the table
+        if (ltype->isa<DefiniteArrayType>() && !index->isa<PrimLit>()) {
+            if (auto agg = cg.static_address(lhs()))
+                return cg.load(cg.world.lea(agg, index, loc()), loc());
+        }
         return cg.world.extract(lhs()->remit(cg), index, loc());
     }
     THORIN_UNREACHABLE;
@@ -769,18 +1148,55 @@ const Def* FieldExpr::lemit(CodeGen& cg) const {
 }
 
 const Def* FieldExpr::remit(CodeGen& cg) const {
+    if (unpack_ref_type(lhs()->type())->isa<SliceType>()) // len
+        return cg.world.extract(lhs()->lemit(cg), 1_s, loc());
     return cg.world.extract(lhs()->remit(cg), index(), loc());
 }
 
+const Def* SliceExpr::remit(CodeGen& cg) const {
+    auto ltype = unpack_ref_type(lhs()->type());
+    auto agg = cg.address(lhs(), loc());
+    auto ptr = agg;
+    const Def* len = nullptr;
+    if (ltype->isa<SliceType>()) {
+        ptr = cg.world.extract(agg, 0_s, loc());
+        len = cg.world.extract(agg, 1_s, loc());
+    } else if (auto array_type = ltype->isa<DefiniteArrayType>()) {
+        len = cg.world.literal_qs32(array_type->dim(), loc());
+    }
+
+    auto bound = [&] (const Expr* expr, const Def* otherwise) {
+        return expr->isa<EmptyExpr>() ? otherwise : cg.world.cast(cg.world.type_qs32(), expr->remit(cg), expr->loc());
+    };
+    auto lo = bound(this->lo(), cg.world.literal_qs32(0, loc()));
+    auto hi = bound(this->hi(), len);
+
+    if (bounds_checks()) {
+        auto cond = cg.world.arithop_and(cg.world.cmp_ge(lo, cg.world.literal_qs32(0, loc()), loc()), cg.world.cmp_le(lo, hi, loc()), loc());
+        if (len != nullptr && len != hi)
+            cond = cg.world.arithop_and(cond, cg.world.cmp_le(hi, len, loc()), loc());
+        cg.check_bounds(cond, loc());
+    }
+
+    auto elems = cg.convert(type())->as<thorin::TupleType>()->op(0);
+    auto first = cg.world.bitcast(elems, cg.world.lea(ptr, lo, loc()), loc());
+    return cg.world.tuple({ first, cg.world.arithop_sub(hi, lo, loc()) }, loc());
+}
+
 const Def* BlockExpr::remit(CodeGen& cg) const {
     for (auto&& stmt : stmts()) {
         if (auto item_stmnt = stmt->isa<ItemStmt>())
             item_stmnt->item()->emit_head(cg);
     }
 
+    auto mark = cg.owned_.size();
     for (auto&& stmt : stmts()) stmt->emit(cg);
 
-    return expr()->remit(cg);
+    auto def = expr()->remit(cg);
+    if (def)
+        cg.release(mark, loc().anew_finis());
+    cg.owned_.resize(mark);
+    return def;
 }
 
 const Def* IfExpr::remit(CodeGen& cg) const {
@@ -806,83 +1222,387 @@ const Def* IfExpr::remit(CodeGen& cg) const {
     return nullptr; // TODO use bottom type
 }
 
-const Def* MatchExpr::remit(CodeGen& cg) const {
-    auto thorin_type = cg.convert(type());
+/**
+ * Compiles the arms of a @p MatchExpr into a decision tree.
+ * Each node of the tree tests a single component of the matched value - the variant of an enum with a @c match on its
+ * @c variant_index, an integer with a @c match on its value - and dispatches to the subtrees of the arms which are still
+ * alive afterwards; thus, no path through the tree tests a component twice.
+ * The tree ends in the basic blocks of the arms which are created on demand - arms that can never be taken get none.
+ */
+class MatchCompiler {
+public:
+    MatchCompiler(CodeGen& cg, const MatchExpr* match)
+        : cg_(cg)
+        , match_(match)
+        , arm_bbs_(match->num_arms(), nullptr)
+    {}
 
-    auto join = thorin_type ? cg.basicblock(thorin_type, {"match_join", loc().anew_finis()}) : nullptr; // TODO rewrite with bottom type
+    /// Basic block of arm @p i or @c nullptr if @c compile never dispatched to it.
+    Continuation* arm_bb(size_t i) const { return arm_bbs_[i]; }
 
-    auto matcher = expr()->remit(cg);
-    auto enum_type = expr()->type()->isa<EnumType>();
-    bool is_integer = is_int(expr()->type());
-    bool is_simple = enum_type && enum_type->enum_decl()->is_simple();
-
-    if (is_integer || is_simple) {
-        // integers: match continuation
-        Continuation* otherwise = nullptr;
-        size_t num_targets = num_arms();
-        Array<const Def*> defs(num_targets);
-        Array<Continuation*> targets(num_targets);
-
-        for (size_t i = 0, e = num_targets; i != e; ++i) {
+    void compile(const Def* matcher) {
+        Rows rows;
+        for (size_t i = 0, e = match_->num_arms(); i != e; ++i) {
             // last pattern will always be taken
-            if (!arm(i)->ptrn()->is_refutable() || i == e - 1) {
-                num_targets = i;
-                arm(i)->ptrn()->emit(cg, matcher);
-                otherwise = cg.basicblock({"otherwise", arm(i)->loc().anew_begin()});
-                break;
-            } else {
-                if (is_integer) {
-                    defs[i] = arm(i)->ptrn()->emit(cg);
-                } else {
-                    auto enum_ptrn = arm(i)->ptrn()->as<EnumPtrn>();
-                    auto option_decl = enum_ptrn->path()->decl()->as<OptionDecl>();
-                    defs[i] = cg.world.literal_qu64(option_decl->index(), arm(i)->ptrn()->loc());
-                }
-                targets[i] = cg.basicblock({"case", arm(i)->loc().anew_begin()});
+            auto ptrn = i == e - 1 ? nullptr : wildcard_or(match_->arm(i)->ptrn());
+            rows.push_back({ { ptrn }, i });
+            if (ptrn == nullptr) break;
+        }
+
+        // no memory operations happen in the tree, so all its basic blocks and those of the arms share the memory
+        auto mem = cg_.cur_mem;
+        nodes_.push_back({ cg_.cur_bb, { matcher }, std::move(rows) });
+        while (!nodes_.empty()) {
+            auto node = std::move(nodes_.front());
+            nodes_.pop_front();
+            cg_.enter(node.bb, mem);
+            compile(node.components, node.rows);
+        }
+    }
+
+private:
+    /// The patterns of arm @p arm for the components still to be tested; @c nullptr matches anything.
+    struct Row {
+        std::vector<const Ptrn*> ptrns;
+        size_t arm;
+    };
+    typedef std::vector<Row> Rows;
+    typedef std::vector<const Def*> Components;
+
+    /// A basic block of the tree which still has to be compiled.
+    struct Node {
+        Continuation* bb;
+        Components components;
+        Rows rows;
+    };
+
+    static const Ptrn* wildcard_or(const Ptrn* ptrn) { return ptrn->is_refutable() ? ptrn : nullptr; }
+
+    static size_t num_sub_ptrns(const Ptrn* ptrn) {
+        if (auto tuple_ptrn = ptrn->isa<TuplePtrn>()) return tuple_ptrn->num_elems();
+        if (auto enum_ptrn  = ptrn->isa<EnumPtrn >()) return enum_ptrn->num_args();
+        return 0;
+    }
+
+    static const Ptrn* sub_ptrn(const Ptrn* ptrn, size_t i) {
+        if (auto tuple_ptrn = ptrn->isa<TuplePtrn>()) return tuple_ptrn->elem(i);
+        return ptrn->as<EnumPtrn>()->arg(i);
+    }
+
+    /// Ordinals of the smallest and the largest value of an integer pattern - see @p ordinal.
+    typedef std::pair<uint64_t, uint64_t> Range;
+
+    /// Larger integer tests are split up into comparisons.
+    static constexpr size_t max_match_cases = 1024;
+
+    static Range bounds(const Ptrn* ptrn) {
+        if (auto range_ptrn = ptrn->isa<RangePtrn>())
+            return { ordinal(range_ptrn->lo()), ordinal(range_ptrn->hi()) };
+        return { ordinal(ptrn), ordinal(ptrn) };
+    }
+
+    static bool contains(Range range, uint64_t value) { return range.first <= value && value <= range.second; }
+
+    static const OptionDecl* option_decl(const Ptrn* ptrn) {
+        return ptrn->as<EnumPtrn>()->path()->decl()->as<OptionDecl>();
+    }
+
+    /// Does @p ptrn match the same values as @p head in the component tested by @p head?
+    bool same_head(const Ptrn* ptrn, const Ptrn* head) {
+        if (head->isa<TuplePtrn>()) return true;
+        if (head->isa<EnumPtrn>())  return option_decl(ptrn) == option_decl(head);
+        return ptrn->emit(cg_) == head->emit(cg_);
+    }
+
+    /// Rows which may match if component @p col matches @p head; the component is replaced by its sub-components.
+    Rows specialize(const Rows& rows, size_t col, const Ptrn* head) {
+        Rows result;
+        auto num = num_sub_ptrns(head);
+        for (auto& row : rows) {
+            auto ptrn = row.ptrns[col];
+            if (ptrn != nullptr && !same_head(ptrn, head)) continue;
+
+            Row sub_row{ {}, row.arm };
+            sub_row.ptrns.insert(sub_row.ptrns.end(), row.ptrns.begin(), row.ptrns.begin() + col);
+            for (size_t i = 0; i != num; ++i)
+                sub_row.ptrns.push_back(ptrn ? wildcard_or(sub_ptrn(ptrn, i)) : nullptr);
+            sub_row.ptrns.insert(sub_row.ptrns.end(), row.ptrns.begin() + col + 1, row.ptrns.end());
+            result.push_back(std::move(sub_row));
+        }
+        return result;
+    }
+
+    /// Rows which may match if component @p col matches none of the tested heads; the component is removed.
+    static Rows drop(const Rows& rows, size_t col) {
+        Rows result;
+        for (auto& row : rows) {
+            if (row.ptrns[col] != nullptr) continue;
+            result.push_back(row);
+            result.back().ptrns.erase(result.back().ptrns.begin() + col);
+        }
+        return result;
+    }
+
+    /// Rows for which @p alive is set; the component @p col is removed.
+    static Rows select(const Rows& rows, size_t col, const std::vector<bool>& alive) {
+        Rows result;
+        for (size_t i = 0, e = rows.size(); i != e; ++i) {
+            if (!alive[i]) continue;
+            result.push_back(rows[i]);
+            result.back().ptrns.erase(result.back().ptrns.begin() + col);
+        }
+        return result;
+    }
+
+    /// Rows which may match if component @p col lies @p inside of @p range or not; the component stays.
+    static Rows split(const Rows& rows, size_t col, Range range, bool inside) {
+        Rows result;
+        for (auto& row : rows) {
+            auto ptrn = row.ptrns[col];
+            if (ptrn != nullptr) {
+                auto ptrn_range = bounds(ptrn);
+                bool covers = ptrn_range.first <= range.first && range.second <= ptrn_range.second;
+                bool within = range.first <= ptrn_range.first && ptrn_range.second <= range.second;
+                bool disjoint = ptrn_range.second < range.first || range.second < ptrn_range.first;
+                if (inside ? disjoint : within) continue;
+                if (inside && covers) ptrn = nullptr;
+            }
+            result.push_back(row);
+            result.back().ptrns[col] = ptrn;
+        }
+        return result;
+    }
+
+    /// Replaces each row with an @p OrPtrn in component @p col by one row for each of its alternatives.
+    static Rows expand_or(const Rows& rows, size_t col) {
+        Rows result;
+        for (auto& row : rows) {
+            auto or_ptrn = row.ptrns[col] ? row.ptrns[col]->isa<OrPtrn>() : nullptr;
+            if (or_ptrn == nullptr) {
+                result.push_back(row);
+                continue;
             }
+            for (auto&& alt : or_ptrn->alts()) {
+                result.push_back(row);
+                result.back().ptrns[col] = wildcard_or(alt.get());
+            }
+        }
+        return result;
+    }
+
+    /// Rows which may match if component @p col does not match @p head.
+    Rows drop_head(const Rows& rows, size_t col, const Ptrn* head) {
+        Rows result;
+        for (auto& row : rows) {
+            if (row.ptrns[col] == nullptr || !same_head(row.ptrns[col], head))
+                result.push_back(row);
         }
+        return result;
+    }
+
+    static Components replace(const Components& components, size_t col, Defs sub_components) {
+        Components result(components.begin(), components.begin() + col);
+        result.insert(result.end(), sub_components.begin(), sub_components.end());
+        result.insert(result.end(), components.begin() + col + 1, components.end());
+        return result;
+    }
 
-        targets.shrink(num_targets);
-        defs.shrink(num_targets);
+    static bool is_irrefutable(const Row& row) {
+        return std::all_of(row.ptrns.begin(), row.ptrns.end(), [] (const Ptrn* ptrn) { return ptrn == nullptr; });
+    }
 
-        auto matcher_int = is_integer ? matcher : cg.world.variant_index(matcher, matcher->debug());
-        cg.cur_bb->match(matcher_int, otherwise, defs, targets, {"match", loc().anew_begin()});
-        auto mem = cg.cur_mem;
+    Continuation* arm_target(size_t i) {
+        auto& bb = arm_bbs_[i];
+        if (bb == nullptr)
+            bb = cg_.basicblock({"case", match_->arm(i)->loc().anew_begin()});
+        return bb;
+    }
 
-        for (size_t i = 0; i != num_targets; ++i) {
-            cg.enter(targets[i], mem);
-            if (auto def = arm(i)->expr()->remit(cg))
-                cg.cur_bb->jump(join, {cg.cur_mem, def}, loc().anew_finis());
+    /// Basic block continuing with @p rows - the one of the first row's arm if nothing is left to test.
+    Continuation* target(Components components, Rows rows, Debug dbg) {
+        assert(!rows.empty() && "the last arm is always taken");
+        if (is_irrefutable(rows.front()))
+            return arm_target(rows.front().arm);
+        auto bb = cg_.basicblock(dbg);
+        nodes_.push_back({ bb, std::move(components), std::move(rows) });
+        return bb;
+    }
+
+    /// Emits the test of the first component the first of the @p rows is refutable in into the current basic block.
+    void compile(const Components& components, const Rows& rows) {
+        if (is_irrefutable(rows.front())) {
+            cg_.cur_bb->jump(arm_target(rows.front().arm), {}, match_->loc().anew_begin());
+            return;
         }
 
-        bool no_otherwise = num_arms() == num_targets;
-        if (!no_otherwise) {
-            cg.enter(otherwise, mem);
-            if (auto def = arm(num_targets)->expr()->remit(cg))
-                cg.cur_bb->jump(join, {cg.cur_mem, def}, loc().anew_finis());
+        auto& first = rows.front().ptrns;
+        size_t col = std::find_if(first.begin(), first.end(), [] (const Ptrn* ptrn) { return ptrn != nullptr; }) - first.begin();
+        if (std::any_of(rows.begin(), rows.end(), [&] (const Row& row) { return row.ptrns[col] && row.ptrns[col]->isa<OrPtrn>(); })) {
+            compile(components, expand_or(rows, col));
+            return;
+        }
+
+        auto head = first[col];
+        auto component = components[col];
+        auto loc = head->loc();
+
+        // tuples always match - just test their elements
+        if (auto tuple_ptrn = head->isa<TuplePtrn>()) {
+            Array<const Def*> elems(tuple_ptrn->num_elems());
+            for (size_t i = 0, e = elems.size(); i != e; ++i)
+                elems[i] = cg_.world.extract(component, i, loc);
+            compile(replace(components, col, elems), specialize(rows, col, head));
+            return;
         }
-    } else {
-        // general case: if/else
-        for (size_t i = 0, e = num_arms(); i != e; ++i) {
-            auto case_true  = cg.basicblock({"case_true",  arm(i)->loc().anew_begin()});
-            auto case_false = cg.basicblock({"case_false", arm(i)->loc().anew_begin()});
 
-            arm(i)->ptrn()->emit(cg, matcher);
+        if (head->isa<EnumPtrn>())
+            compile_enum(components, rows, col);
+        else if (is_int(head->type()))
+            compile_int(components, rows, col);
+        else {
+            // everything else: compare with the first head and test the others if it does not match
+            auto case_true  = target(replace(components, col, {}), specialize(rows, col, head), {"case_true",  loc});
+            auto case_false = target(components, drop_head(rows, col, head), {"case_false", loc});
+            cg_.cur_bb->branch(cg_.world.cmp_eq(component, head->emit(cg_), loc), case_true, case_false, loc);
+        }
+    }
 
-            // last pattern will always be taken
-            auto cond = i == e - 1
-                ? cg.world.literal_bool(true, arm(i)->ptrn()->loc())
-                : arm(i)->ptrn()->emit_cond(cg, matcher);
+    /// Enums: one match continuation on the variant index.
+    void compile_enum(const Components& components, const Rows& rows, size_t col) {
+        auto component = components[col];
+        auto loc = rows.front().ptrns[col]->loc();
+
+        // all variants tested in this component in the order of the arms
+        std::vector<const Ptrn*> heads;
+        for (auto& row : rows) {
+            auto ptrn = row.ptrns[col];
+            if (ptrn != nullptr && std::none_of(heads.begin(), heads.end(), [&] (const Ptrn* head) { return same_head(ptrn, head); }))
+                heads.push_back(ptrn);
+        }
+
+        auto sub_components = [&] (const Ptrn* head) {
+            Array<const Def*> result(num_sub_ptrns(head));
+            if (result.size() != 0) {
+                auto val = cg_.world.variant_extract(component, option_decl(head)->index(), loc);
+                for (size_t i = 0, e = result.size(); i != e; ++i)
+                    result[i] = e == 1 ? val : cg_.world.extract(val, i, loc);
+            }
+            return result;
+        };
+
+        bool complete = heads.size() == option_decl(heads.front())->enum_decl()->num_option_decls();
+        auto otherwise = complete ? nullptr : target(replace(components, col, {}), drop(rows, col), {"otherwise", loc});
+        Array<const Def*> defs(heads.size());
+        Array<Continuation*> targets(heads.size());
+        for (size_t i = 0, e = heads.size(); i != e; ++i) {
+            defs[i] = cg_.world.literal_qu64(option_decl(heads[i])->index(), heads[i]->loc());
+            targets[i] = target(replace(components, col, sub_components(heads[i])), specialize(rows, col, heads[i]), {"case", heads[i]->loc()});
+        }
+
+        // the last variant is the only one left if all are covered
+        if (complete) {
+            otherwise = targets.back();
+            defs.shrink(defs.size() - 1);
+            targets.shrink(targets.size() - 1);
+            if (targets.empty()) {
+                cg_.cur_bb->jump(otherwise, {}, loc);
+                return;
+            }
+        }
+        auto index = cg_.world.variant_index(component, loc);
+        cg_.cur_bb->match(index, otherwise, defs, targets, {"match", loc});
+    }
 
-            cg.cur_bb->branch(cond, case_true, case_false, arm(i)->ptrn()->loc().anew_finis());
+    /**
+     * Integers: one match continuation on the value with a case for each value that any of the @p rows tests.
+     * The cases of values which leave the same rows - usually the values of a range - share their subtree.
+     * If there are too many values, the component is tested against the bounds of the first pattern instead.
+     */
+    void compile_int(const Components& components, const Rows& rows, size_t col) {
+        auto component = components[col];
+        auto head = rows.front().ptrns[col];
+        auto loc = head->loc();
+        auto tag = cg_.convert(head->type())->as<thorin::PrimType>()->primtype_tag();
+        bool is_signed = is_i8(head->type()) || is_i16(head->type()) || is_i32(head->type()) || is_i64(head->type());
+        auto literal = [&] (uint64_t ordinal) {
+            return cg_.world.literal(tag, int64_t(is_signed ? ordinal ^ (uint64_t(1) << 63) : ordinal), loc);
+        };
+
+        std::vector<uint64_t> values;
+        for (auto& row : rows) {
+            if (auto ptrn = row.ptrns[col]) {
+                auto range = bounds(ptrn);
+                if (range.second - range.first >= max_match_cases - values.size()) {
+                    values.clear();
+                    break;
+                }
+                for (auto value = range.first; value != range.second; ++value)
+                    values.push_back(value);
+                values.push_back(range.second);
+            }
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        if (values.empty()) {
+            auto range = bounds(head);
+            auto cond = range.first == range.second
+                ? cg_.world.cmp_eq(component, literal(range.first), loc)
+                : cg_.world.arithop_and(cg_.world.cmp_ge(component, literal(range.first), loc),
+                                        cg_.world.cmp_le(component, literal(range.second), loc), loc);
+            auto case_true  = target(components, split(rows, col, range, true),  {"case_true",  loc});
+            auto case_false = target(components, split(rows, col, range, false), {"case_false", loc});
+            cg_.cur_bb->branch(cond, case_true, case_false, loc);
+            return;
+        }
 
-            auto mem = cg.cur_mem;
-            cg.enter(case_true, mem);
-            if (auto def = arm(i)->expr()->remit(cg))
-                cg.cur_bb->jump(join, {cg.cur_mem, def}, arm(i)->loc().anew_finis());
+        std::vector<bool> wildcards(rows.size());
+        for (size_t i = 0, e = rows.size(); i != e; ++i)
+            wildcards[i] = rows[i].ptrns[col] == nullptr;
+        auto otherwise = target(replace(components, col, {}), select(rows, col, wildcards), {"otherwise", loc});
 
-            cg.enter(case_false, mem);
+        std::map<std::vector<bool>, Continuation*> subtrees;
+        std::vector<const Def*> defs;
+        std::vector<Continuation*> targets;
+        for (auto value : values) {
+            std::vector<bool> alive(rows.size());
+            for (size_t i = 0, e = rows.size(); i != e; ++i)
+                alive[i] = rows[i].ptrns[col] == nullptr || contains(bounds(rows[i].ptrns[col]), value);
+            if (alive == wildcards) continue;
+
+            auto& bb = subtrees[alive];
+            if (bb == nullptr)
+                bb = target(replace(components, col, {}), select(rows, col, alive), {"case", loc});
+            defs.push_back(literal(value));
+            targets.push_back(bb);
         }
+        cg_.cur_bb->match(component, otherwise, defs, targets, {"match", loc});
+    }
+
+    CodeGen& cg_;
+    const MatchExpr* match_;
+    std::vector<Continuation*> arm_bbs_;
+    std::deque<Node> nodes_;
+};
+
+const Def* MatchExpr::remit(CodeGen& cg) const {
+    auto thorin_type = cg.convert(type());
+
+    auto join = thorin_type ? cg.basicblock(thorin_type, {"match_join", loc().anew_finis()}) : nullptr; // TODO rewrite with bottom type
+
+    auto matcher = expr()->remit(cg);
+    auto mem = cg.cur_mem;
+    MatchCompiler compiler(cg, this);
+    compiler.compile(matcher);
+
+    for (size_t i = 0, e = num_arms(); i != e; ++i) {
+        auto bb = compiler.arm_bb(i);
+        if (bb == nullptr) continue;
+
+        cg.enter(bb, mem);
+        arm(i)->ptrn()->emit(cg, matcher);
+        if (auto def = arm(i)->expr()->remit(cg))
+            cg.cur_bb->jump(join, {cg.cur_mem, def}, arm(i)->loc().anew_finis());
     }
 
     if (thorin_type)
@@ -963,10 +1683,6 @@ void IdPtrn::emit(CodeGen& cg, const thorin::Def* init) const {
     local()->emit(cg, init);
 }
 
-const thorin::Def* IdPtrn::emit_cond(CodeGen& cg, const thorin::Def*) const {
-    return cg.world.literal(true);
-}
-
 void EnumPtrn::emit(CodeGen& cg, const thorin::Def* init) const {
     if (num_args() == 0) return;
     auto index = path()->decl()->as<OptionDecl>()->index();
@@ -975,36 +1691,11 @@ void EnumPtrn::emit(CodeGen& cg, const thorin::Def* init) const {
         arg(i)->emit(cg, num_args() == 1 ? val : cg.world.extract(val, i, loc()));
 }
 
-const thorin::Def* EnumPtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
-    auto index = path()->decl()->as<OptionDecl>()->index();
-    auto cond = cg.world.cmp_eq(cg.world.variant_index(init, loc()), cg.world.literal_qu64(index, loc()));
-    if (num_args() > 0) {
-        auto val = cg.world.variant_extract(init, index, loc());
-        for (size_t i = 0, e = num_args(); i != e; ++i) {
-            if (!arg(i)->is_refutable()) continue;
-            auto arg_cond = arg(i)->emit_cond(cg, num_args() == 1 ? val : cg.world.extract(val, i, loc()));
-            cond = cg.world.arithop_and(cond, arg_cond, loc());
-        }
-    }
-    return cond;
-}
-
 void TuplePtrn::emit(CodeGen& cg, const thorin::Def* init) const {
     for (size_t i = 0, e = num_elems(); i != e; ++i)
         elem(i)->emit(cg, cg.world.extract(init, i, loc()));
 }
 
-const thorin::Def* TuplePtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
-    const Def* cond = nullptr;
-    for (size_t i = 0, e = num_elems(); i != e; ++i) {
-        if (!elem(i)->is_refutable()) continue;
-
-        auto next = elem(i)->emit_cond(cg, cg.world.extract(init, i, loc()));
-        cond = cond ? cg.world.arithop_and(cond, next) : next;
-    }
-    return cond ? cond : cg.world.literal(true);
-}
-
 const thorin::Def* LiteralPtrn::emit(CodeGen& cg) const {
     auto def = literal()->remit(cg);
     return has_minus() ? cg.world.arithop_minus(def, def->debug()) : def;
@@ -1012,19 +1703,13 @@ const thorin::Def* LiteralPtrn::emit(CodeGen& cg) const {
 
 void LiteralPtrn::emit(CodeGen&, const thorin::Def*) const {}
 
-const thorin::Def* LiteralPtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
-    return cg.world.cmp_eq(init, emit(cg));
-}
-
 const thorin::Def* CharPtrn::emit(CodeGen& cg) const {
     return chr()->remit(cg);
 }
 
 void CharPtrn::emit(CodeGen&, const thorin::Def*) const {}
-
-const thorin::Def* CharPtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
-    return cg.world.cmp_eq(init, emit(cg));
-}
+void RangePtrn::emit(CodeGen&, const thorin::Def*) const {}
+void OrPtrn::emit(CodeGen&, const thorin::Def*) const {}
 
 /*
  * statements
@@ -1067,9 +1752,194 @@ void AsmStmt::emit(CodeGen& cg) const {
 
 //------------------------------------------------------------------------------
 
-void emit(World& world, const Module* mod) {
-    CodeGen cg(world);
-    mod->emit(cg);
+/*
+ * parallel emission
+ */
+
+static bool has_nominal_type(const Type* type) {
+    return type->is_nominal() || std::any_of(type->ops().begin(), type->ops().end(), has_nominal_type);
+}
+
+/// Does @p item keep no emission state in the AST? Emitting an item which uses it does not touch it then.
+static bool is_stateless(const Item* item) {
+    // a function of an extern block is declared by each part which calls it - see CodeGen::def
+    // the declarations are merged by name, so their types must not contain nominal types, which differ between worlds
+    if (auto fn_decl = item->isa<FnDecl>())
+        return fn_decl->is_extern() && fn_decl->body() == nullptr && !has_nominal_type(fn_decl->fn_type());
+    return item->isa<StructDecl>() || item->isa<Typedef>() || item->isa<ModuleDecl>() || item->isa<ExternBlock>();
+}
+
+/// Maps @p item and the items nested in it to @p i; the uses of all of them are the uses of @p item.
+static void own(const Item* item, size_t i, thorin::GIDMap<const Item*, size_t>& owner, std::vector<const Item*>& nested) {
+    owner[item] = i;
+    nested.push_back(item);
+    if (auto module = item->isa<Module>()) {
+        for (auto&& nested_item : module->items())
+            own(nested_item.get(), i, owner, nested);
+    } else if (auto extern_block = item->isa<ExternBlock>()) {
+        for (auto&& fn_decl : extern_block->fn_decls())
+            own(fn_decl.get(), i, owner, nested);
+    } else if (auto impl = item->isa<ImplItem>()) {
+        for (auto&& method : impl->methods())
+            own(method.get(), i, owner, nested);
+    } else if (auto trait_decl = item->isa<TraitDecl>()) {
+        for (auto&& method : trait_decl->methods())
+            own(method.get(), i, owner, nested);
+    }
+}
+
+/**
+ * Splits the reachable items of @p mod into parts which can be emitted into worlds of their own.
+ * An item is in the part of each item it uses that keeps emission state in the AST - a function, a static or an enum.
+ * All impls and traits are in one part as a call of a trait method may end up in any impl of the trait.
+ * The parts are ordered by their first items; the items of a part keep their order in @p mod.
+ */
+static std::vector<std::vector<const Item*>> partition(const Module* mod) {
+    const auto& items = mod->items();
+    auto none = items.size();
+
+    // union-find whose representatives are the first items of their sets
+    std::vector<size_t> parent(items.size());
+    for (size_t i = 0, e = items.size(); i != e; ++i)
+        parent[i] = i;
+    auto find = [&] (size_t i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    auto unite = [&] (size_t i, size_t j) {
+        i = find(i);
+        j = find(j);
+        parent[std::max(i, j)] = std::min(i, j);
+    };
+
+    thorin::GIDMap<const Item*, size_t> owner;
+    std::vector<std::vector<const Item*>> nested(items.size());
+    for (size_t i = 0, e = items.size(); i != e; ++i)
+        own(items[i].get(), i, owner, nested[i]);
+
+    // items without state are cheap to emit: they are kept together rather than giving each a world of its own
+    size_t impls = none, stateless = none;
+    auto join = [&] (size_t& first, size_t i) {
+        if (first == none)
+            first = i;
+        else
+            unite(first, i);
+    };
+
+    for (size_t i = 0, e = items.size(); i != e; ++i) {
+        auto item = items[i].get();
+        if (!item->is_reachable())
+            continue;
+        if (is_stateless(item)) {
+            join(stateless, i);
+            continue;
+        }
+        if (item->isa<ImplItem>() || item->isa<TraitDecl>())
+            join(impls, i);
+
+        for (auto nested_item : nested[i]) {
+            for (auto use : nested_item->uses()) {
+                auto j = owner.find(use);
+                if (j != owner.end() && !is_stateless(use))
+                    unite(i, j->second);
+            }
+        }
+    }
+
+    std::vector<std::vector<const Item*>> parts;
+    std::vector<size_t> part_of(items.size(), none);
+    for (size_t i = 0, e = items.size(); i != e; ++i) {
+        if (!items[i]->is_reachable())
+            continue;
+        auto& part = part_of[find(i)];
+        if (part == none) {
+            part = parts.size();
+            parts.emplace_back();
+        }
+        parts[part].push_back(items[i].get());
+    }
+    return parts;
+}
+
+void emit(World& world, const Module* mod, unsigned num_threads) {
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<std::vector<const Item*>> parts;
+    if (num_threads != 1)
+        parts = partition(mod);
+    if (parts.size() < 2) {
+        CodeGen cg(world);
+        mod->emit(cg);
+        return;
+    }
+
+    // comparing a Symbol with a string literal interns the literal - this is not synchronized, so it happens up front
+    for (auto str : { "", "main", "\"C\"", "\"device\"", "\"thorin\"" })
+        (void) Symbol(str);
+
+    struct Result {
+        std::unique_ptr<World> world;
+        std::unique_ptr<CodeGen> cg;
+        std::exception_ptr error;
+    };
+
+    // each part is emitted like a module of its own - see Module::emit
+    std::vector<Result> results(parts.size());
+    auto emit_part = [&] (size_t i) {
+        auto& result = results[i];
+        try {
+            result.world = std::make_unique<World>(world.name());
+            result.cg = std::make_unique<CodeGen>(*result.world, /*is_part*/ true);
+            for (auto item : parts[i])
+                item->emit_head(*result.cg);
+            for (auto item : parts[i])
+                item->emit(*result.cg);
+            result.cg->emit_instances();
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+    };
+
+    auto& context = Context::current();
+    std::atomic<size_t> next_part(0);
+    auto emit_parts = [&] {
+        Context::Scope scope(context);
+        for (size_t i; (i = next_part++) < parts.size();)
+            emit_part(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1, e = std::min(size_t(num_threads), parts.size()); i < e; ++i)
+        threads.emplace_back(emit_parts);
+    emit_parts(); // this thread lends a hand as well
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto& result : results) {
+        if (result.error)
+            std::rethrow_exception(result.error);
+    }
+
+    // the parts are merged in their order and so are the externals of each part - the result does not depend on timing
+    // every part declares the extern functions it calls: the first declaration of a name replaces all others
+    Importer importer(world);
+    std::map<std::string, Continuation*> declarations;
+    for (auto& result : results) {
+        for (auto external : result.cg->externals()) {
+            auto continuation = importer.import(external)->as_continuation();
+            if (continuation->empty()) {
+                auto [i, is_first] = declarations.emplace(continuation->name(), continuation);
+                if (!is_first) {
+                    continuation->replace_uses(i->second);
+                    continue;
+                }
+            }
+            importer.world().make_external(continuation);
+        }
+    }
+    swap(importer.world(), world);
 }
 
 //------------------------------------------------------------------------------
@@ -1,32 +1,70 @@
 #include <fstream>
+#include <mutex>
 
 #include "impala/impala.h"
 
 #include "thorin/util/symbol.h"
 
 #include "impala/ast.h"
+#include "impala/compile_cache.h"
+#include "impala/time_report.h"
 #include "impala/token.h"
 
 namespace impala {
 
-int global_num_warnings = 0;
-int global_num_errors = 0;
-bool fancy_output = false;
+static Context default_context;
+static thread_local Context* current_context = nullptr;
 
-bool& fancy() { return fancy_output; }
-int& num_warnings() { return global_num_warnings; }
-int& num_errors() { return global_num_errors; }
+Context& Context::current() { return current_context != nullptr ? *current_context : default_context; }
+
+Context::Scope::Scope(Context& context)
+    : old_(current_context)
+{
+    current_context = &context;
+}
+
+Context::Scope::~Scope() { current_context = old_; }
+
+static std::mutex diagnostic_mutex;
+static thread_local std::string* diagnostic_buffer = nullptr;
+
+void emit_diagnostic(const std::string& diagnostic) {
+    if (diagnostic_buffer != nullptr) {
+        *diagnostic_buffer += diagnostic;
+    } else {
+        std::lock_guard<std::mutex> guard(diagnostic_mutex);
+        std::cerr << diagnostic << std::flush;
+    }
+}
+
+DiagnosticCapture::DiagnosticCapture(std::string& buffer)
+    : old_(diagnostic_buffer)
+{
+    diagnostic_buffer = &buffer;
+}
+
+DiagnosticCapture::~DiagnosticCapture() { diagnostic_buffer = old_; }
 
 void init() {
-    PrecTable::init();
-    Token::init();
+    static std::once_flag once;
+    std::call_once(once, [] {
+        PrecTable::init();
+        Token::init();
+    });
 }
 
 void check(std::unique_ptr<TypeTable>& typetable, const Module* mod) {
-    name_analysis(mod);
-    type_inference(typetable, mod);
-    type_analysis(mod);
-    //borrow_check(mod);
+    { TimeReport::Phase phase("name analysis");  name_analysis(mod); }
+    { TimeReport::Phase phase("type inference"); type_inference(typetable, mod); }
+    { TimeReport::Phase phase("type analysis");  type_analysis(mod); }
+    { TimeReport::Phase phase("reachability");   reachability_analysis(mod); }
+    if (num_errors() == 0) {
+        TimeReport::Phase phase("borrow check");
+        borrow_check(mod);
+    }
+
+    if (auto report = TimeReport::active())
+        report->count("types", typetable->num_types());
 }
 
 Prec PrecTable::infix[Token::Num];
@@ -39,36 +77,35 @@ void PrecTable::init() {
 
 }
 
-/// Entry-point for the JIT in the runtime system.
+/**
+ * Entry-point for the JIT in the runtime system.
+ * It may be invoked from several threads with different @p world%s, but these calls are @em serialized:
+ * only one compilation at a time runs the front end and emits into its @p world - concurrent JIT compilations wait.
+ * Each call is isolated, though: diagnostics, options and statistics of one never leak into another.
+ */
 bool compile(
     const std::vector<std::string>& file_names,
     const std::vector<std::string>& file_data,
     thorin::World& world,
     std::ostream&)
 {
-    static bool initialized = false;
-    if (!initialized) {
-        impala::init();
-        initialized = true;
-    }
-    impala::num_warnings() = 0;
-    impala::num_errors()   = 0;
-
-    impala::Items items;
-    for (size_t n = file_names.size(), i = 0; i < n; ++i) {
-        auto file_name = file_names[i];
-        auto file_src  = file_data[i];
-        std::istringstream program_is(file_src);
-        impala::parse(items, program_is, file_name.c_str());
-    }
-
-    auto module = std::make_unique<const impala::Module>(file_names.back().c_str(), std::move(items));
-
-    std::unique_ptr<impala::TypeTable> typetable;
-    impala::check(typetable, module.get());
-    bool result = impala::num_errors() == 0;
+    impala::init();
+    impala::Context context;
+    impala::Context::Scope context_scope(context);
+
+    // Each compilation is isolated in its own Context: diagnostics, options and AST gids; types are numbered per table.
+    // This does not make the front ends run in parallel, though:
+    // Symbols are interned throughout parsing, analysis and emission, e.g. whenever an ABI or intrinsic name is compared,
+    // and thorin's symbol table is not synchronized; the compile cache is shared as well.
+    // Hence, the lock spans the whole front end including the emission into world; the worlds are independent afterwards.
+    static std::mutex symbol_mutex;
+    std::lock_guard<std::mutex> guard(symbol_mutex);
+
+    // parsing and semantic analysis are skipped if the very same program has been compiled before
+    auto& entry = impala::compile_cache().check(file_names, file_data);
+    bool result = entry.num_errors == 0;
     if (result)
-        impala::emit(world, module.get());
+        impala::emit(world, entry.module.get());
 
     return result;
 }
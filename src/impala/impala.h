@@ -1,8 +1,10 @@
 #ifndef IMPALA_IMPALA_H
 #define IMPALA_IMPALA_H
 
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -21,12 +23,16 @@ typedef std::vector<std::unique_ptr<const Item>> Items;
 
 void init();
 void parse(Items&, std::istream&, const char*);
+void parse(Items&, const char* begin, const char* end, const char* filename);
+void parse(Items&, const char* filename);
+void parse(Items&, const std::vector<std::string>& filenames, unsigned num_threads = 0); ///< Preparsed modules among @p filenames are loaded instead.
 void name_analysis(const Module*);
 void type_inference(std::unique_ptr<TypeTable>& typetable, const Module*);
 void type_analysis(const Module*);
-//void borrow_check(const ModContents*);
+void reachability_analysis(const Module*);
+void borrow_check(const Module*);
 void check(std::unique_ptr<TypeTable>& typetable, const Module*);
-void emit(thorin::World&, const Module*);
+void emit(thorin::World&, const Module*, unsigned num_threads = 1); ///< Independent parts of the program are emitted concurrently.
 
 enum class Prec {
     Bottom,
@@ -51,22 +57,99 @@ private:
     friend void impala::init();
 };
 
-int& num_warnings();
-int& num_errors();
-bool& fancy();
+/// Statistics of the last run of @p type_inference.
+struct InferStats {
+    int num_rounds = 0;           ///< How often the worklist of top-level @p Item%s has been processed.
+    size_t num_item_visits = 0;   ///< How many top-level @p Item%s have been inferred in total.
+    size_t num_node_visits = 0;   ///< How many AST nodes have been inferred in total.
+    size_t num_instantiations = 0;     ///< How often a polymorphic @p Type has been instantiated.
+    size_t num_instantiation_hits = 0; ///< How many of these instantiations have been cached.
+};
+
+/**
+ * State of a single compilation: diagnostic counters, options and statistics.
+ * Each thread works on the @p Context installed via a @p Scope; threads without one share a process-wide default.
+ * The token and precedence tables are immutable after @p init and, thus, shared by all @p Context%s.
+ */
+class Context {
+public:
+    Context() {}
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    std::atomic<int>& num_warnings() { return num_warnings_; }
+    std::atomic<int>& num_errors() { return num_errors_; }
+    bool& fancy() { return fancy_; }
+    /// Shall the parser skip the bodies of module-level functions until name analysis finds a reference to them?
+    /// Functions nobody refers to are neither checked nor emitted then - errors within them go unreported.
+    /// @c main and @c pub functions are entry points and, thus, never skipped.
+    bool& lazy_bodies() { return lazy_bodies_; }
+    /// Shall subscripts and sub-slices of slices be checked against their length at run time?
+    /// Subscripts by the induction variable of a loop over a syntactically recognized counting @c range are not checked.
+    bool& bounds_checks() { return bounds_checks_; }
+    InferStats& infer_stats() { return infer_stats_; }
+    /// Hands out the gid of a new @p ASTNode; these are only unique within this @p Context.
+    size_t next_ast_gid() { return ast_gid_counter_++; }
+    size_t ast_gid_counter() const { return ast_gid_counter_; }
+
+    static Context& current(); ///< The @p Context installed for this thread or the default one.
+
+    /// Installs @p context as the @p current one of this thread for the lifetime of this object.
+    class Scope {
+    public:
+        Scope(Context& context);
+        ~Scope();
+
+    private:
+        Context* old_;
+    };
+
+private:
+    std::atomic<int> num_warnings_{0};
+    std::atomic<int> num_errors_{0};
+    bool fancy_ = false;
+    bool lazy_bodies_ = false;
+    bool bounds_checks_ = false;
+    InferStats infer_stats_;
+    std::atomic<size_t> ast_gid_counter_{1};
+};
+
+inline InferStats& infer_stats() { return Context::current().infer_stats(); }
+inline std::atomic<int>& num_warnings() { return Context::current().num_warnings(); }
+inline std::atomic<int>& num_errors() { return Context::current().num_errors(); }
+inline bool& fancy() { return Context::current().fancy(); }
+inline bool& lazy_bodies() { return Context::current().lazy_bodies(); }
+inline bool& bounds_checks() { return Context::current().bounds_checks(); }
+
+/// Prints @p diagnostic to @c std::cerr or appends it to the buffer of the active @p DiagnosticCapture of this thread.
+void emit_diagnostic(const std::string& diagnostic);
+
+/// Collects all diagnostics issued by the current thread into a buffer instead of printing them while alive.
+class DiagnosticCapture {
+public:
+    DiagnosticCapture(std::string& buffer);
+    ~DiagnosticCapture();
+
+private:
+    std::string* old_;
+};
 
 template<class... Args>
 void warning(const Loc& loc, const char* fmt, Args... args) {
     ++num_warnings();
-    Stream s(std::cerr);
+    std::ostringstream os;
+    Stream s(os);
     s.fmt("{}: warning: ", loc).fmt(fmt, std::forward<Args>(args)...).endl();
+    emit_diagnostic(os.str());
 }
 
 template<class... Args>
 void error(const Loc& loc, const char* fmt, Args... args) {
     ++num_errors();
-    Stream s(std::cerr);
+    std::ostringstream os;
+    Stream s(os);
     s.fmt("{}: error: ", loc).fmt(fmt, std::forward<Args>(args)...).endl();
+    emit_diagnostic(os.str());
 }
 
 template<class T>
@@ -1,38 +1,219 @@
 #include "impala/lexer.h"
 
-#include <cctype>
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <stdexcept>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define IMPALA_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMPALA_HAS_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 #include "impala/impala.h"
 
 using namespace thorin;
 
 namespace impala {
 
-static inline bool sym(int c) { return std::isalpha(c) || c == '_'; }
+// all predicates are plain ASCII classifications so they agree with the vectorized scanners below
+static inline bool sym(int c) { return ('a' <= (c | 0x20) && (c | 0x20) <= 'z') || c == '_'; }
 static inline bool dec_nonzero(int c) { return c >= '1' && c <= '9'; }
-static inline bool space(int c) { return std::isspace(c) != 0; }
+static inline bool space(int c) { return c == ' ' || ('\t' <= c && c <= '\r'); }
 static inline bool bin(int c) { return '0' <= c && c <= '1'; }
 static inline bool oct(int c) { return '0' <= c && c <= '7'; }
-static inline bool dec(int c) { return std::isdigit(c) != 0; }
-static inline bool hex(int c) { return std::isxdigit(c) != 0; }
+static inline bool dec(int c) { return '0' <= c && c <= '9'; }
+static inline bool hex(int c) { return dec(c) || ('a' <= (c | 0x20) && (c | 0x20) <= 'f'); }
 static inline bool eE(int c) { return c == 'e' || c == 'E'; }
 static inline bool sgn(int c){ return c == '+' || c == '-'; }
 
+//------------------------------------------------------------------------------
+
+/*
+ * bulk scanners
+ *
+ * Each scanner returns the first position in [p, end) that does not belong to the run it skips.
+ * With SSE2 they classify 16 bytes per step and only handle the tail byte-wise.
+ */
+
+#ifdef IMPALA_HAS_SSE2
+static inline __m128i splat(char c) { return _mm_set1_epi8(c); }
+
+/// Unsigned @p lo <= x <= @p hi for each byte of @p x.
+static inline __m128i in_range(__m128i x, char lo, char hi) {
+    auto t = _mm_sub_epi8(x, splat(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, splat(hi - lo)), t);
+}
+
+/// Index of the lowest set bit of @p mask which must not be zero.
+static inline unsigned first_set_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return unsigned(index);
+#else
+    return unsigned(__builtin_ctz(mask));
+#endif
+}
+
+/// Skips 16-byte blocks as long as @p pred holds for all bytes and returns the position of the first block where it fails.
+template<class VPred>
+static inline const char* skip_blocks(const char* p, const char* end, VPred pred) {
+    for (; end - p >= 16; p += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = ~unsigned(_mm_movemask_epi8(pred(x))) & 0xFFFFu;
+        if (mask != 0)
+            return p + first_set_bit(mask);
+    }
+    return p;
+}
+#endif
+
+static const char* skip_space(const char* p, const char* end) {
+#ifdef IMPALA_HAS_SSE2
+    p = skip_blocks(p, end, [] (__m128i x) { return _mm_or_si128(_mm_cmpeq_epi8(x, splat(' ')), in_range(x, '\t', '\r')); });
+#endif
+    while (p != end && space((unsigned char) *p)) ++p;
+    return p;
+}
+
+static const char* skip_sym_or_dec(const char* p, const char* end) {
+#ifdef IMPALA_HAS_SSE2
+    p = skip_blocks(p, end, [] (__m128i x) {
+        auto alpha = in_range(_mm_or_si128(x, splat(0x20)), 'a', 'z');
+        return _mm_or_si128(_mm_or_si128(alpha, in_range(x, '0', '9')), _mm_cmpeq_epi8(x, splat('_')));
+    });
+#endif
+    while (p != end && (sym((unsigned char) *p) || dec((unsigned char) *p))) ++p;
+    return p;
+}
+
+/// Skips characters inside a string literal up to the next @p quote or backslash.
+static const char* skip_str_plain(const char* p, const char* end, char quote) {
+#ifdef IMPALA_HAS_SSE2
+    p = skip_blocks(p, end, [&] (__m128i x) {
+        return _mm_xor_si128(_mm_or_si128(_mm_cmpeq_epi8(x, splat(quote)), _mm_cmpeq_epi8(x, splat('\\'))), splat(char(0xFF)));
+    });
+#endif
+    while (p != end && *p != quote && *p != '\\') ++p;
+    return p;
+}
+
+/// Returns the position right after the newline terminating a line comment or @c nullptr.
+static const char* find_line_comment_end(const char* p, const char* end) {
+    auto nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return nl ? nl + 1 : nullptr;
+}
+
+/// Returns the position right after the '*' '/' terminating a block comment or @c nullptr.
+/// Just like the byte-wise lexer, the character following a '*' that does not close the comment is skipped.
+static const char* find_block_comment_end(const char* p, const char* end) {
+    while (true) {
+        auto star = static_cast<const char*>(std::memchr(p, '*', end - p));
+        if (star == nullptr || star + 1 == end)
+            return nullptr;
+        if (star[1] == '/')
+            return star + 2;
+        p = star + 2;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+SourceBuffer::SourceBuffer(std::istream& stream) {
+    if (!stream)
+        throw std::runtime_error("stream is bad");
+
+    data_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (stream.bad())
+        throw std::runtime_error("error while reading stream");
+
+    begin_ = data_.data();
+    end_   = begin_ + data_.size();
+}
+
+SourceBuffer::SourceBuffer(const char* filename) {
+#ifdef IMPALA_HAS_MMAP
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("cannot open file '") + filename + "'");
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            ::madvise(map, st.st_size, MADV_SEQUENTIAL);
+            map_      = map;
+            map_size_ = st.st_size;
+            begin_    = static_cast<const char*>(map);
+            end_      = begin_ + map_size_;
+            ::close(fd);
+            return;
+        }
+    }
+    ::close(fd);
+#endif
+    // fall back to reading the whole file, e.g. for pipes, empty files or platforms without mmap
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error(std::string("cannot open file '") + filename + "'");
+
+    data_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    begin_ = data_.data();
+    end_   = begin_ + data_.size();
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef IMPALA_HAS_MMAP
+    if (map_ != nullptr)
+        ::munmap(map_, map_size_);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+Lexer::Lexer(const char* begin, const char* end, const char* filename)
+    : buffer_(begin, end)
+    , cur_(buffer_.begin())
+    , end_(buffer_.end())
+    , loc_(filename, {1, 1})
+    , peek_({1, 1})
+    , file_(SrcLoc::intern(filename))
+{}
+
 Lexer::Lexer(std::istream& stream, const char* filename)
-    : stream_(stream)
+    : buffer_(stream)
+    , cur_(buffer_.begin())
+    , end_(buffer_.end())
     , loc_(filename, {1, 1})
     , peek_({1, 1})
-{
-    if (!stream_)
-        throw std::runtime_error("stream is bad");
+    , file_(SrcLoc::intern(filename))
+{}
 
-    stream_.exceptions(std::istream::badbit);
-}
+Lexer::Lexer(const char* filename)
+    : buffer_(filename)
+    , cur_(buffer_.begin())
+    , end_(buffer_.end())
+    , loc_(filename, {1, 1})
+    , peek_({1, 1})
+    , file_(SrcLoc::intern(filename))
+{}
 
 int Lexer::next() {
-    int c = stream_.get();
+    int c = cur_ != end_ ? (unsigned char) *cur_++ : eof;
 
     loc_.finis.row = peek_.row;
     loc_.finis.col = peek_.col;
@@ -40,57 +221,96 @@ int Lexer::next() {
     if (c == '\n') {
         ++peek_.row;
         peek_.col = 1;
-    } else if (c != std::istream::traits_type::eof())
+    } else if (c != eof)
         ++peek_.col;
 
     return c;
 }
 
+void Lexer::eat(const char* to) {
+    assert(cur_ < to && to <= end_);
+    auto last = to - 1;
+
+    // loc_.finis becomes the position of the last eaten char, peek_ the position of the char after it
+    auto rows = std::count(cur_, last, '\n');
+    loc_.finis.row = peek_.row + rows;
+    if (rows == 0) {
+        loc_.finis.col = peek_.col + (last - cur_);
+    } else {
+        auto nl = last;
+        while (*--nl != '\n') {}
+        loc_.finis.col = last - nl;
+    }
+
+    if (*last == '\n') {
+        peek_.row = loc_.finis.row + 1;
+        peek_.col = 1;
+    } else {
+        peek_.row = loc_.finis.row;
+        peek_.col = loc_.finis.col + 1;
+    }
+
+    cur_ = to;
+}
+
+bool Lexer::eat_comment(const char* to) {
+    if (to == nullptr) {
+        if (cur_ != end_)
+            eat(end_);
+        next();
+        error(loc_.anew_begin(), "unterminated comment");
+        return false;
+    }
+    eat(to);
+    return true;
+}
+
 Token Lexer::lex() {
     while (true) {
-        std::string str; // the token string is concatenated here
+        std::string str;            // the text of char and string literals is concatenated here
+        const char* begin = cur_;   // all other tokens refer to the source buffer directly
 
         loc_.begin.row = peek_.row;
         loc_.begin.col = peek_.col;
         assert(loc_.begin.row != static_cast<uint32_t>(-1));
 
         // end of file
-        if (accept(std::istream::traits_type::eof()))
-            return {loc_, Token::Eof};
+        if (accept(eof))
+            return {src_loc(), Token::Eof};
 
         // skip whitespace
-        if (accept(space)) {
-            while (accept(space)) {}
+        if (space(peek())) {
+            eat(skip_space(cur_, end_));
             continue;
         }
 
         // +, ++, +=
         if (accept('+')) {
-            if (accept('+')) return {loc_, Token::INC};
-            if (accept('=')) return {loc_, Token::ADD_ASGN};
-            return {loc_, Token::ADD};
+            if (accept('+')) return {src_loc(), Token::INC};
+            if (accept('=')) return {src_loc(), Token::ADD_ASGN};
+            return {src_loc(), Token::ADD};
         }
 
         // -, --, -=, ->
         if (accept('-')) {
-            if (accept('-')) return {loc_, Token::DEC};
-            if (accept('=')) return {loc_, Token::SUB_ASGN};
-            if (accept('>')) return {loc_, Token::ARROW};
-            return {loc_, Token::SUB};
+            if (accept('-')) return {src_loc(), Token::DEC};
+            if (accept('=')) return {src_loc(), Token::SUB_ASGN};
+            if (accept('>')) return {src_loc(), Token::ARROW};
+            return {src_loc(), Token::SUB};
         }
 
         // =, ==, =>
         if (accept('=')) {
-            if (accept('=')) return {loc_, Token::EQ};
-            if (accept('>')) return {loc_, Token::FAT_ARRROW};
-            return {loc_, Token::ASGN};
+            if (accept('=')) return {src_loc(), Token::EQ};
+            if (accept('>')) return {src_loc(), Token::FAT_ARRROW};
+            return {src_loc(), Token::ASGN};
         }
 
         // *, *=, %, %=, ^, ^=, !, !=, :, :=
 #define IMPALA_LEX_OP(op, tok1, tok2) \
         if (accept( op )) { \
-            if (accept('=')) return {loc_, Token:: tok2}; \
-            return {loc_, Token:: tok1}; \
+            if (accept('=')) return {src_loc(), Token:: tok2}; \
+            return {src_loc(), Token:: tok1}; \
         }
         IMPALA_LEX_OP('*', MUL, MUL_ASGN)
         IMPALA_LEX_OP('%', REM, REM_ASGN)
@@ -100,133 +320,132 @@ Token Lexer::lex() {
         // <, <=, <<, <<=, >, >=, >>, >>=
 #define IMPALA_LEX_REL_SHIFT(op, tok_rel, tok_rel_eq, tok_shift, tok_shift_asgn) \
         if (accept( op )) { \
-            if (accept('=')) return {loc_, Token:: tok_rel_eq}; \
+            if (accept('=')) return {src_loc(), Token:: tok_rel_eq}; \
             if (accept(op)) {  \
-                if (accept('=')) return {loc_, Token:: tok_shift_asgn}; \
-                return {loc_, Token:: tok_shift}; \
+                if (accept('=')) return {src_loc(), Token:: tok_shift_asgn}; \
+                return {src_loc(), Token:: tok_shift}; \
             } \
-            return {loc_, Token:: tok_rel}; \
+            return {src_loc(), Token:: tok_rel}; \
         }
         IMPALA_LEX_REL_SHIFT('<', LT, LE, SHL, SHL_ASGN)
         IMPALA_LEX_REL_SHIFT('>', GT, GE, SHR, SHR_ASGN)
 
         // /, /=, comments
-#define IMPALA_WITHIN_COMMENT(delim) \
-        while (true) { \
-            if (accept(std::istream::traits_type::eof())) { \
-                error(loc_.anew_begin(), "unterminated comment"); \
-                return {loc_, Token::Eof}; \
-            } \
-            if (delim) break; \
-            next(); /* eat up char in comment */\
-        }
         if (accept('/')) {
             if (accept('='))
-                return {loc_, Token::DIV_ASGN};
+                return {src_loc(), Token::DIV_ASGN};
             if (accept('*')) { // arbitrary comment
-                IMPALA_WITHIN_COMMENT(accept('*') && accept('/'));
+                if (!eat_comment(find_block_comment_end(cur_, end_)))
+                    return {src_loc(), Token::Eof};
                 continue;
             }
             if (accept('/')) { // end of line comment
-                IMPALA_WITHIN_COMMENT(accept('\n'));
+                if (!eat_comment(find_line_comment_end(cur_, end_)))
+                    return {src_loc(), Token::Eof};
                 continue;
             }
-            return {loc_, Token::DIV};
+            return {src_loc(), Token::DIV};
         }
 
         // &, &=, &&, |, |=, ||
 #define IMPALA_LEX_AND_OR(op, tok_bit, tok_logic, tok_asgn) \
         if (accept( op )) { \
             if (accept('=')) \
-                return {loc_, Token:: tok_asgn}; \
+                return {src_loc(), Token:: tok_asgn}; \
             if (accept(op)) \
-                return {loc_, Token:: tok_logic}; \
-            return {loc_, Token:: tok_bit}; \
+                return {src_loc(), Token:: tok_logic}; \
+            return {src_loc(), Token:: tok_bit}; \
         }
         IMPALA_LEX_AND_OR('&', AND, ANDAND, AND_ASGN)
         IMPALA_LEX_AND_OR('|',  OR,   OROR,  OR_ASGN)
 
         if (accept(':')) {
             if (accept(':'))
-                return {loc_, Token::DOUBLE_COLON};
-            return {loc_, Token::COLON};
+                return {src_loc(), Token::DOUBLE_COLON};
+            return {src_loc(), Token::COLON};
         }
 
         if (accept('@')) {
             if (accept('@'))
-                return {loc_, Token::RUNRUN};
+                return {src_loc(), Token::RUNRUN};
             if (accept('?'))
-                return {loc_, Token::RUNKNOWN};
-            return {loc_, Token::RUN};
+                return {src_loc(), Token::RUNKNOWN};
+            return {src_loc(), Token::RUN};
         }
 
         // single character tokens
-        if (accept('(')) return {loc_, Token::L_PAREN};
-        if (accept(')')) return {loc_, Token::R_PAREN};
-        if (accept(',')) return {loc_, Token::COMMA};
-        if (accept(';')) return {loc_, Token::SEMICOLON};
-        if (accept('$')) return {loc_, Token::HLT};
-        if (accept('[')) return {loc_, Token::L_BRACKET};
-        if (accept(']')) return {loc_, Token::R_BRACKET};
-        if (accept('{')) return {loc_, Token::L_BRACE};
-        if (accept('}')) return {loc_, Token::R_BRACE};
-        if (accept('~')) return {loc_, Token::TILDE};
-        if (accept('?')) return {loc_, Token::KNOWN};
+        if (accept('(')) return {src_loc(), Token::L_PAREN};
+        if (accept(')')) return {src_loc(), Token::R_PAREN};
+        if (accept(',')) return {src_loc(), Token::COMMA};
+        if (accept(';')) return {src_loc(), Token::SEMICOLON};
+        if (accept('$')) return {src_loc(), Token::HLT};
+        if (accept('[')) return {src_loc(), Token::L_BRACKET};
+        if (accept(']')) return {src_loc(), Token::R_BRACKET};
+        if (accept('{')) return {src_loc(), Token::L_BRACE};
+        if (accept('}')) return {src_loc(), Token::R_BRACE};
+        if (accept('~')) return {src_loc(), Token::TILDE};
+        if (accept('?')) return {src_loc(), Token::KNOWN};
 
         // '.', floats
         if (accept('.')) {
-            str += '.';
-            if (accept(str, dec)) goto l_fractional_dot_rest;
-            if (accept('.'))      return {loc_, Token::DOTDOT};
-            return {loc_, Token::DOT};
+            if (accept(dec))      goto l_fractional_dot_rest;
+            if (accept('.'))      return {src_loc(), Token::DOTDOT};
+            return {src_loc(), Token::DOT};
         }
 
         // identifiers/keywords
-        if (lex_identifier(str))
-            return {loc_, str};
+        if (auto id = lex_identifier(); !id.empty())
+            return {src_loc(), id};
 
         // char literal
         if (accept(str , '\'')) {
             while (!accept(str, '\'')) {
                 accept(str, '\\');
                 str += next();
-                if (peek() == std::istream::traits_type::eof()) {
+                if (peek() == eof) {
                     error(curr(), "missing terminating ' character");
                     str += '\''; // artificially append closing '
                     break;
                 }
             }
-            return {loc_, Token::LIT_char, str};
+            return {src_loc(), Token::LIT_char, literals_.emplace_back(std::move(str))};
         }
 
         // string literal
         if (accept(str , '"')) {
              while (!accept(str, '"')) {
+                // take over a run of plain chars at once unless it reaches the end of the buffer
+                auto plain = skip_str_plain(cur_, end_, '"');
+                if (plain != cur_ && plain != end_) {
+                    str.append(cur_, plain);
+                    eat(plain);
+                    continue;
+                }
                 accept(str, '\\');
                 str += next();
-                if (peek() == std::istream::traits_type::eof()) {
+                if (peek() == eof) {
                     error(curr(), "missing terminating \" character");
                     str += '\''; // artificially append closing "
                     break;
                 }
             }
-            return {loc_, Token::LIT_str, str};
+            return {src_loc(), Token::LIT_str, literals_.emplace_back(std::move(str))};
         }
 
         /*
          * literals
          */
 
-        if (accept(str, dec_nonzero)) goto l_dec;
-        if (accept(str, '0')) {
+        if (accept(dec_nonzero)) goto l_dec;
+        if (accept('0')) {
 #define IMPALA_LEX_BASE_NUM(prefix, pred) \
-            if (accept(str, (prefix))) { \
-                while (accept(str, '_')) {} \
-                if (accept(str, (pred))) { \
-                    while (accept(str, (pred)) || accept(str, '_')) {} \
-                    return lex_suffix(str, false); \
+            if (accept((prefix))) { \
+                while (accept('_')) {} \
+                if (accept((pred))) { \
+                    while (accept((pred)) || accept('_')) {} \
+                    return lex_suffix(begin, false); \
                 } \
-                return literal_error(str, false); \
+                return literal_error(begin, false); \
             }
 
             IMPALA_LEX_BASE_NUM('b', bin)
@@ -240,67 +459,86 @@ Token Lexer::lex() {
         continue;
 
 l_dec:                                      // [0-9_]*
-        while (accept(str, dec) || accept(str, '_')) {}
-        if (accept(str, '.')) {             // [0-9]
-            if (accept(str, dec)) goto l_fractional_dot_rest;
-            if (accept(str,  eE)) goto l_exp;
-            return lex_suffix(str, true);
+        while (accept(dec) || accept('_')) {}
+        if (peek(1) != '.' && accept('.')) { // [0-9] - '1..' is an integer followed by '..'
+            if (accept(dec)) goto l_fractional_dot_rest;
+            if (accept(eE)) goto l_exp;
+            return lex_suffix(begin, true);
         }
-        if (accept(str,  eE)) goto l_exp;
-        return lex_suffix(str, false);
+        if (accept(eE)) goto l_exp;
+        return lex_suffix(begin, false);
 
 l_fractional_dot_rest:                      // [0-9_]*
-        while (accept(str, dec) || accept(str, '_')) {}
-        if (accept(str,  eE)) goto l_exp;
-        return lex_suffix(str, true);
+        while (accept(dec) || accept('_')) {}
+        if (accept(eE)) goto l_exp;
+        return lex_suffix(begin, true);
 
 l_exp:                                      // [eE][+-]?[0-9_]+
-        accept(str, sgn);
-        if (accept(str, dec) || accept(str, '_')) {
-            while (accept(str, dec) || accept(str, '_')) {}
-            return lex_suffix(str, true);
+        accept(sgn);
+        if (accept(dec) || accept('_')) {
+            while (accept(dec) || accept('_')) {}
+            return lex_suffix(begin, true);
         }
-        return literal_error(str, true);
+        return literal_error(begin, true);
     }
 }
 
-bool Lexer::lex_identifier(std::string& str) {
-    if (accept(str, sym)) {
-        while (accept(str, sym) || accept(str, dec)) {}
-        return true;
+std::string_view Lexer::lex_identifier() {
+    if (sym(peek())) {
+        auto begin = cur_;
+        eat(skip_sym_or_dec(cur_ + 1, end_));
+        return {begin, size_t(cur_ - begin)};
     }
-    return false;
+    return {};
 }
 
-Token Lexer::lex_suffix(std::string& str, bool floating) {
+Token Lexer::lex_suffix(const char* begin, bool floating) {
     TokenTag tok = floating ? Token::LIT_f64 : Token::LIT_i32;
-    std::string suffix_str;
-    if (lex_identifier(suffix_str)) {
-        Symbol suffix(suffix_str);
-        if (floating) {
-            auto lit = Token::sym2flit(suffix);
-            if (lit == Token::Error) {
-                error(loc_, "invalid suffix on floating constant '{}'", suffix);
-                return {loc_, tok, str};
-            }
-            tok = lit;
-        } else {
-            auto lit = Token::sym2lit(suffix);
-            if (lit == Token::Error) {
-                error(loc_, "invalid suffix on constant '{}'", suffix);
-                return {loc_, tok, str};
-            }
-            tok = lit;
+    std::string_view str(begin, cur_ - begin);
+    auto suffix = lex_identifier();
+    if (!suffix.empty()) {
+        auto lit = Token::lit_suffix(suffix, floating);
+        if (lit == Token::Error) {
+            if (floating)
+                error(loc_, "invalid suffix on floating constant '{}'", std::string(suffix));
+            else
+                error(loc_, "invalid suffix on constant '{}'", std::string(suffix));
+            return {src_loc(), tok, str};
         }
-        str += suffix.c_str();
+        tok = lit;
+        str = std::string_view(begin, cur_ - begin);
     }
 
-    return {loc_, tok, str};
+    return {src_loc(), tok, str};
 }
 
-Token Lexer::literal_error(std::string& str, bool floating) {
-    error(loc_, "invalid constant '{}'", str);
-    return lex_suffix(str, floating);
+Token Lexer::literal_error(const char* begin, bool floating) {
+    error(loc_, "invalid constant '{}'", std::string(begin, cur_));
+    return lex_suffix(begin, floating);
+}
+
+//------------------------------------------------------------------------------
+
+TokenStream::TokenStream(std::unique_ptr<Lexer>&& lexer)
+    : lexer_(std::move(lexer))
+{
+    std::string diagnostic;
+    DiagnosticCapture capture(diagnostic);
+    do {
+        tokens_.emplace_back(lexer_->lex());
+        if (!diagnostic.empty()) {
+            diagnostics_.emplace_back(tokens_.size() - 1, std::move(diagnostic));
+            diagnostic.clear();
+        }
+    } while (tokens_.back() != Token::Eof);
+}
+
+Token TokenStream::lex() {
+    for (; cur_diagnostic_ != diagnostics_.size() && diagnostics_[cur_diagnostic_].first == cur_token_; ++cur_diagnostic_)
+        emit_diagnostic(diagnostics_[cur_diagnostic_].second);
+
+    // stick to the final Eof just like the Lexer does
+    return cur_token_ + 1 < tokens_.size() ? tokens_[cur_token_++] : tokens_.back();
 }
 
 }
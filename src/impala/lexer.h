@@ -1,7 +1,11 @@
 #ifndef IMPALA_LEXER_H
 #define IMPALA_LEXER_H
 
+#include <deque>
 #include <istream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "thorin/debug.h"
 
@@ -9,19 +13,55 @@
 
 namespace impala {
 
+/// Contiguous, read-only view of a source file.
+/// The file is memory-mapped where the platform supports it and read into memory otherwise.
+class SourceBuffer {
+public:
+    /// Views the range [@p begin, @p end) which must outlive this object.
+    SourceBuffer(const char* begin, const char* end)
+        : begin_(begin)
+        , end_(end)
+    {}
+    /// Reads the whole @p stream into an owned buffer.
+    explicit SourceBuffer(std::istream& stream);
+    /// Maps the file @p filename into memory.
+    explicit SourceBuffer(const char* filename);
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    const char* begin() const { return begin_; }
+    const char* end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+
+private:
+    std::string data_;
+    const char* begin_ = nullptr;
+    const char* end_ = nullptr;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+};
+
 class Lexer {
 public:
-    Lexer(std::istream& stream, const char* filename);
+    Lexer(const char* begin, const char* end, const char* filename); ///< Lexes [@p begin, @p end) which must outlive the @p Lexer.
+    Lexer(std::istream& stream, const char* filename);               ///< Reads @p stream completely and lexes the result.
+    explicit Lexer(const char* filename);                            ///< Memory-maps @p filename and lexes it.
 
     Token lex(); ///< Get next \p Token in stream.
 
 private:
-    bool lex_identifier(std::string&);
-    Token lex_suffix(std::string&, bool floating);
-    Token literal_error(std::string&, bool floating);
+    static constexpr int eof = std::char_traits<char>::eof();
+
+    std::string_view lex_identifier(); ///< Returns the identifier as a slice of the source buffer or an empty view.
+    Token lex_suffix(const char* begin, bool floating);
+    Token literal_error(const char* begin, bool floating);
     int next();
-    int peek() const { return stream_.peek(); }
+    void eat(const char* to);         ///< Consumes all chars in [cur_, @p to) at once.
+    bool eat_comment(const char* to); ///< Consumes a comment ending at @p to; reports an unterminated comment if @p to is @c nullptr.
+    int peek(size_t ahead = 0) const { return size_t(end_ - cur_) > ahead ? (unsigned char) cur_[ahead] : eof; }
     Loc curr() const { return loc_.anew_finis(); }
+    SrcLoc src_loc() const { return {file_, loc_.begin, loc_.finis}; } ///< @p loc_ without copying the file name.
 
     template<class Pred>
     bool accept(std::string& str, Pred pred) {
@@ -46,9 +86,32 @@ private:
     bool accept(char c) { return accept((int) c); }
     bool accept(std::string& str, char c) { return accept(str, (int) c); }
 
-    std::istream& stream_;
+    SourceBuffer buffer_;
+    std::deque<std::string> literals_; ///< Text of char and string literals which may differ from the source.
+    const char* cur_;
+    const char* end_;
     Loc loc_;
     Pos peek_;
+    const std::string* file_; ///< Interned file name of @p loc_ for the @p Token%s.
+};
+
+/**
+ * All @p Token%s of a file lexed up front, e.g. on another thread.
+ * Diagnostics issued while lexing are held back and replayed when the @p Token following them is consumed.
+ * This way they appear in the same order as with on-demand lexing.
+ */
+class TokenStream {
+public:
+    explicit TokenStream(std::unique_ptr<Lexer>&& lexer);
+
+    Token lex(); ///< Get next \p Token in stream and print the diagnostics issued before it was lexed.
+
+private:
+    std::unique_ptr<Lexer> lexer_;
+    std::vector<Token> tokens_;
+    std::vector<std::pair<size_t, std::string>> diagnostics_; ///< Diagnostics along with the index of the following @p Token.
+    size_t cur_token_ = 0;
+    size_t cur_diagnostic_ = 0;
 };
 
 }
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <cctype>
 #include <stdexcept>
@@ -13,7 +18,11 @@
 #include "impala/args.h"
 
 #include "impala/cgen.h"
+#include "impala/compile_cache.h"
 #include "impala/impala.h"
+#include "impala/preparsed.h"
+#include "impala/server.h"
+#include "impala/time_report.h"
 
 //------------------------------------------------------------------------------
 
@@ -21,31 +30,103 @@ typedef std::vector<std::string> Names;
 
 //------------------------------------------------------------------------------
 
-std::ostream* open(std::ofstream& stream, const std::string& name) {
-    if (name == "-")
-        return &std::cout;
+static std::string read_file(const std::string& name) {
+    std::ifstream file(name, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot read file '" + name + "'");
+    std::ostringstream data;
+    data << file.rdbuf();
+    return data.str();
+}
 
-    stream.open(name);
-    return &stream;
+/**
+ * Runs the code generators of each of the @p groups one after another while the @p groups run concurrently on up to
+ * @p num_threads threads; all code generators of a group must share their @c World and no other group may use it.
+ * The files are written in the given order once all code generators have finished.
+ * If a code generator throws, the files before it are written and its exception is rethrown.
+ */
+static void emit_backends(const std::vector<std::vector<thorin::CodeGen*>>& groups, unsigned num_threads,
+                          const std::string& module_name, impala::OutputFiles& files, impala::TimeReport& report) {
+    struct Output {
+        std::string name;
+        std::string data;
+        std::exception_ptr error;
+    };
+    struct Result {
+        std::vector<Output> outputs;
+        std::vector<impala::TimeReport::Entry> phases;
+    };
+
+    std::vector<Result> results(groups.size());
+    auto emit_group = [&] (size_t i) {
+        impala::TimeReport group_report; // phases of other threads are merged below in a fixed order
+        for (auto cg : groups[i]) {
+            results[i].outputs.emplace_back();
+            auto& output = results[i].outputs.back();
+            output.name = module_name + cg->file_ext();
+            try {
+                impala::TimeReport::Phase phase("codegen " + output.name);
+                std::ostringstream stream;
+                cg->emit_stream(stream);
+                output.data = stream.str();
+            } catch (...) {
+                output.error = std::current_exception();
+                break;
+            }
+        }
+        results[i].phases = group_report.phases();
+    };
+
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::atomic<size_t> next_group(0);
+    auto emit_groups = [&] {
+        for (size_t i; (i = next_group++) < groups.size();)
+            emit_group(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1, e = std::min(size_t(num_threads), groups.size()); i < e; ++i)
+        threads.emplace_back(emit_groups);
+    emit_groups(); // this thread lends a hand as well
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto& result : results) {
+        report.append(result.phases);
+        for (auto& output : result.outputs) {
+            if (output.error)
+                std::rethrow_exception(output.error);
+            files.open(output.name) << output.data;
+        }
+    }
 }
 
-int main(int argc, char** argv) {
+/// Runs the compiler with the command line @p args; @p cache is only set for requests of the compile server.
+static int run(const Names& args, impala::OutputFiles& files, impala::CompileCache* cache) {
     try {
-        if (argc < 1)
+        if (args.empty())
             throw std::logic_error("bad number of arguments");
 
-        std::string prgname = argv[0];
+        std::vector<char*> argv;
+        for (const auto& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        std::string prgname = args.front();
         Names infiles;
 #ifndef NDEBUG
         Names breakpoints;
         Names use_breakpoints;
         bool track_history;
 #endif
-        std::string out_name, log_name, log_level, host_triple, host_cpu, host_attr, hls_flags;
+        std::string out_name, log_name, log_level, host_triple, host_cpu, host_attr, hls_flags, time_report_json,
+                    server_socket, server_cache_dir, connect_socket;
         bool help,
-             emit_c, emit_cint, emit_thorin, emit_ast, emit_annotated, emit_llvm,
+             emit_c, emit_cint, emit_thorin, emit_ast, emit_annotated, emit_llvm, emit_preparsed,
              opt_thorin, opt_s, opt_0, opt_1, opt_2, opt_3, debug,
-             nocleanup, fancy;
+             nocleanup, fancy, stats, time_report, lazy_bodies, bounds_checks;
+        int num_threads, server_cache_size, server_cache_disk;
 
 #ifndef NDEBUG
 #define LOG_LEVELS "{error|warn|info|verbose|debug}"
@@ -54,7 +135,7 @@ int main(int argc, char** argv) {
 #endif
 
         auto cmd_parser = impala::ArgParser()
-            .implicit_option             (                      "<infiles>", "input files", infiles)
+            .implicit_option             (                      "<infiles>", "input files: Impala sources or preparsed modules", infiles)
             .add_option<bool>            ("help",               "",          "produce this help message", help, false)
             .add_option<std::string>     ("log-level",          LOG_LEVELS,  "set log level", log_level, "error")
             .add_option<std::string>     ("log",                "<arg>", "specifies log file; use '-' for stdout (default)", log_name, "-")
@@ -76,19 +157,63 @@ int main(int argc, char** argv) {
             .add_option<bool>            ("emit-c-interface",   "", "emit C interface from Impala code (experimental)", emit_cint, false)
             .add_option<bool>            ("emit-llvm",          "", "emit llvm from Thorin representation (implies -Othorin)", emit_llvm, false)
             .add_option<bool>            ("emit-thorin",        "", "emit textual Thorin representation of Impala program", emit_thorin, false)
+            .add_option<bool>            ("emit-preparsed",     "", "emit the parsed program as preparsed module which may be passed instead of its sources; this only saves parsing", emit_preparsed, false)
             .add_option<std::string>     ("host-triple",        "", "emit llvm target code for the specified target triple", host_triple, "")
             .add_option<std::string>     ("host-cpu",           "", "emit llvm target code for the specified cpu type", host_cpu, "")
             .add_option<std::string>     ("host-attr",          "", "emit llvm target code with the specified attributes", host_attr, "")
             .add_option<std::string>     ("hls-flags",          "", "emit HLS code for the specified flags", hls_flags, "")
             .add_option<bool>            ("f",                  "", "use fancy output: Impala's AST dump uses only parentheses where necessary", fancy, false)
             .add_option<bool>            ("g",                  "", "emit debug information", debug, false)
-            .add_option<bool>            ("nocleanup",          "", "no clean-up phase", nocleanup, false);
+            .add_option<bool>            ("nocleanup",          "", "no clean-up phase", nocleanup, false)
+            .add_option<bool>            ("flazy-bodies",       "", "parse and check only the bodies of main, pub and referenced functions; errors in the others go unreported", lazy_bodies, false)
+            .add_option<bool>            ("fbounds-checks",     "", "check subscripts and sub-slices of slices against their length at run time; "
+                                                                 "s(i) within 'for i in range(0, s.len)' is only exempt if range is syntactically the counting loop "
+                                                                 "'fn range(a: int, b: int, body: fn(int) -> ()) -> () { if a < b { body(a); range(a + 1, b, body) } }'", bounds_checks, false)
+            .add_option<bool>            ("stats",              "", "print statistics about the compilation", stats, false)
+            .add_option<bool>            ("ftime-report",       "", "print wall time, CPU time and peak memory of each compilation phase", time_report, false)
+            .add_option<std::string>     ("ftime-report-json",  "<file>", "write the time report as JSON to <file>; use '-' for stdout", time_report_json, "")
+            .add_option<int>             ("j",                  "<threads>", "number of threads used to lex the input files, to emit independent parts of the program and to run the backends; 0 uses one per core (default)", num_threads, 0)
+            .add_option<std::string>     ("server",             "<socket>", "run as compile server listening on the UNIX socket <socket>", server_socket, "")
+            .add_option<int>             ("server-cache",       "<MiB>", "memory the compile server keeps for checked programs (default: 512)", server_cache_size, 512)
+            .add_option<std::string>     ("server-cache-dir",   "<dir>", "directory where the compile server persists parsed programs across restarts; "
+                                                                 "only parsing is skipped when a program is found there", server_cache_dir, "")
+            .add_option<int>             ("server-cache-disk",  "<MiB>", "disk space the compile server uses in <dir>; the least recently used programs are deleted beyond (default: 1024)", server_cache_disk, 1024)
+            .add_option<std::string>     ("connect",            "<socket>", "let the compile server listening on <socket> do the compilation", connect_socket, "");
 
         // do cmdline parsing
-        cmd_parser.parse(argc, argv);
+        cmd_parser.parse(int(args.size()), argv.data());
+
+        if (cache != nullptr && (!server_socket.empty() || !connect_socket.empty()))
+            throw std::invalid_argument("a compile server does not accept '-server' or '-connect'");
+
+        if (!connect_socket.empty()) {
+            Names request;
+            for (size_t i = 0, e = args.size(); i != e; ++i) {
+                if (args[i] == "-connect" || args[i] == "--connect")
+                    ++i;
+                else
+                    request.push_back(args[i]);
+            }
+            return impala::connect(connect_socket, request);
+        }
+
+        if (!server_socket.empty()) {
+            if (server_cache_size < 0 || server_cache_disk < 0)
+                throw std::invalid_argument("size of the server cache must not be negative");
+            impala::CompileCache server_cache(size_t(server_cache_size) * 1024 * 1024, server_cache_dir, size_t(server_cache_disk) * 1024 * 1024);
+            impala::serve(server_socket, [&] (const Names& request_args, impala::OutputFiles& request_files) {
+                impala::Context context;
+                impala::Context::Scope scope(context);
+                return run(request_args, request_files, &server_cache);
+            });
+        }
+
         opt_thorin |= emit_llvm | emit_c;
 
         impala::fancy() = fancy;
+        // dumps and preparsed modules show the whole program
+        impala::lazy_bodies() = lazy_bodies && !emit_ast && !emit_annotated && !emit_preparsed;
+        impala::bounds_checks() = bounds_checks;
 
         // check optimization levels
         if (opt_s + opt_0 + opt_1 + opt_2 + opt_3 > 1)
@@ -100,6 +225,9 @@ int main(int argc, char** argv) {
         else if (opt_2) opt = 2;
         else if (opt_3) opt = 3;
 
+        if (num_threads < 0)
+            throw std::invalid_argument("number of threads must not be negative");
+
         if (infiles.empty() && !help) {
             thorin::errf("no input files");
             return EXIT_FAILURE;
@@ -117,8 +245,8 @@ int main(int argc, char** argv) {
         } else {
             for (const auto& infile : infiles) {
                 auto i = infile.find_last_of('.');
-                if (infile.substr(i + 1) != "impala")
-                    throw std::invalid_argument("input file '" + infile + "' does not have '.impala' extension");
+                if (infile.substr(i + 1) != "impala" && !impala::is_preparsed(infile))
+                    throw std::invalid_argument("input file '" + infile + "' does not have '.impala' or '" + impala::preparsed_ext + "' extension");
                 auto rest = infile.substr(0, i);
                 auto f = rest.find_last_of('/');
                 if (f != std::string::npos) {
@@ -133,8 +261,7 @@ int main(int argc, char** argv) {
         thorin::World world(module_name);
         impala::init();
 
-        std::ofstream log_stream;
-        world.set(std::make_shared<thorin::Stream>(*open(log_stream, log_name)));
+        world.set(std::make_shared<thorin::Stream>(files.open(log_name)));
 
         if (false) {}
         else if (log_level == "error")   world.set(thorin::LogLevel::Error);
@@ -176,25 +303,66 @@ int main(int argc, char** argv) {
         world.enable_history(track_history);
 #endif
 
-        impala::Items items;
-        for (const auto& infile : infiles) {
-            auto filename = infile.c_str();
-            std::ifstream file(filename);
-            impala::parse(items, file, filename);
-        }
+        impala::TimeReport report;
+        auto first_node = impala::ASTNode::gid_counter();
+
+        const impala::Module* module;
+        const impala::TypeTable* typetable;
+        std::unique_ptr<const impala::Module> owned_module;
+        std::unique_ptr<impala::TypeTable> owned_typetable;
+        std::ostringstream preparsed;
+        if (cache != nullptr && !emit_ast && !emit_preparsed && !impala::lazy_bodies()) {
+            // the compile server keeps checked programs around: only the back end runs if the files are unchanged
+            Names sources;
+            for (const auto& infile : infiles)
+                sources.push_back(read_file(infile));
+            auto& entry = cache->check(infiles, sources);
+            module = entry.module.get();
+            typetable = entry.typetable.get();
+        } else {
+            auto arena = std::make_unique<impala::Arena>();
+            impala::Items items;
+            {
+                impala::TimeReport::Phase phase("parse");
+                impala::Arena::Scope scope(*arena);
+                impala::parse(items, infiles, num_threads);
+            }
 
-        auto module = std::make_unique<const impala::Module>(infiles.front().c_str(), std::move(items));
+            owned_module = std::make_unique<const impala::Module>(infiles.front().c_str(), std::move(items), std::move(arena));
+            module = owned_module.get();
 
-        if (emit_ast)
-            module->dump();
+            if (emit_ast)
+                module->dump();
+            if (emit_preparsed)
+                impala::store(preparsed, module->items()); // semantic analysis alters the AST
 
-        std::unique_ptr<impala::TypeTable> typetable;
-        impala::check(typetable, module.get());
+            impala::check(owned_typetable, module);
+            typetable = owned_typetable.get();
+        }
         bool result = impala::num_errors() == 0;
+        report.count("AST nodes", impala::ASTNode::gid_counter() - first_node);
+
+        if (stats) {
+            const auto& infer_stats = impala::infer_stats();
+            thorin::outf("type inference: {} rounds, {} item visits, {} node visits",
+                         infer_stats.num_rounds, infer_stats.num_item_visits, infer_stats.num_node_visits);
+            thorin::outf("instantiations: {} of {} cached", infer_stats.num_instantiation_hits, infer_stats.num_instantiations);
+            thorin::outf("type table: {} types, {} bytes, {} of {} lookups hit",
+                         typetable->num_types(), typetable->num_bytes(), typetable->num_hits(), typetable->num_lookups());
+            if (cache != nullptr) {
+                thorin::outf("compile cache: {} hits, {} misses, {} evictions",
+                             cache->num_hits(), cache->num_misses(), cache->num_evictions());
+                thorin::outf("compile cache on disk: {} hits, {} misses, {} evictions",
+                             cache->num_disk_hits(), cache->num_disk_misses(), cache->num_disk_evictions());
+            }
+        }
 
         if (emit_annotated)
             module->dump();
 
+        if (result && emit_preparsed)
+            files.open(module_name + impala::preparsed_ext) << preparsed.str();
+
         if (result && emit_cint) {
             impala::CGenOptions opts;
 
@@ -211,55 +379,56 @@ int main(int argc, char** argv) {
             });
             opts.guard[opts.guard.length() - 2] = '_';
 
-            std::ofstream out_file(module_name + ".h");
-            if (!out_file) {
-                thorin::errf("cannot open file '{}' for writing", opts.file_name);
-                return EXIT_FAILURE;
-            }
-            impala::generate_c_interface(module.get(), opts, out_file);
+            impala::generate_c_interface(module, opts, files.open(module_name + ".h"));
         }
 
-        if (result && (emit_c || emit_llvm || emit_thorin))
-            impala::emit(world, module.get());
+        if (result && (emit_c || emit_llvm || emit_thorin)) {
+            impala::TimeReport::Phase phase("emit");
+            impala::emit(world, module, unsigned(num_threads));
+        }
 
         if (result) {
             //thorin::verify_mem(world);
-            if (!nocleanup)
+            if (!nocleanup) {
+                impala::TimeReport::Phase phase("cleanup");
                 world.cleanup();
-            if (opt_thorin)
+            }
+            if (opt_thorin) {
+                impala::TimeReport::Phase phase("opt");
                 world.opt();
+            }
+            report.count("Thorin defs", world.defs().size());
             if (emit_thorin)
                 world.dump();
             if (emit_c || emit_llvm) {
                 thorin::DeviceBackends backends(world, opt, debug, hls_flags);
-                auto emit_to_file = [&] (thorin::CodeGen& cg) {
-                    auto name = module_name + cg.file_ext();
-                    std::ofstream file(name);
-                    if (!file)
-                        throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
-                    else
-                        cg.emit_stream(file);
-                };
-                if (emit_c) {
-                    thorin::Cont2Config kernel_configs;
-                    thorin::c::CodeGen cg(world, kernel_configs, thorin::c::Lang::C99, debug, hls_flags);
-                    emit_to_file(cg);
-                }
+                thorin::Cont2Config kernel_configs;
+                std::unique_ptr<thorin::CodeGen> c_cg, llvm_cg;
+                if (emit_c)
+                    c_cg = std::make_unique<thorin::c::CodeGen>(world, kernel_configs, thorin::c::Lang::C99, debug, hls_flags);
 #ifdef LLVM_SUPPORT
-                if (emit_llvm) {
-                    thorin::llvm::CPUCodeGen cg(world, opt, debug, host_triple, host_cpu, host_attr);
-                    emit_to_file(cg);
-                }
+                if (emit_llvm)
+                    llvm_cg = std::make_unique<thorin::llvm::CPUCodeGen>(world, opt, debug, host_triple, host_cpu, host_attr);
 #endif
+
+                // the host backends share the world; each device backend works on a world of its own
+                std::vector<std::vector<thorin::CodeGen*>> groups(1);
+                for (auto cg : { c_cg.get(), llvm_cg.get() }) {
+                    if (cg) groups.front().push_back(cg);
+                }
                 for (auto& cg : backends.cgs) {
-                    if (cg) emit_to_file(*cg);
+                    if (cg) groups.push_back({ cg.get() });
                 }
+                emit_backends(groups, unsigned(num_threads), module_name, files, report);
             }
-        } else {
-            return EXIT_FAILURE;
         }
 
-        return EXIT_SUCCESS;
+        if (time_report)
+            report.print(std::cout);
+        if (!time_report_json.empty())
+            report.print_json(files.open(time_report_json));
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (std::exception const& e) {
         thorin::errf("{}", e.what());
         return EXIT_FAILURE;
@@ -268,3 +437,8 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 }
+
+int main(int argc, char** argv) {
+    impala::DiskFiles files;
+    return run(Names(argv, argv + argc), files, nullptr);
+}
@@ -1,12 +1,17 @@
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <future>
 #include <sstream>
+#include <thread>
 
 #include "thorin/util/array.h"
 
 #include "impala/ast.h"
 #include "impala/impala.h"
 #include "impala/lexer.h"
+#include "impala/preparsed.h"
+#include "impala/time_report.h"
 
 #define VISIBILITY \
          Token::PRIV: \
@@ -108,16 +113,39 @@ class Parser;
 class Parser {
 public:
     Parser(std::istream& stream, const char* filename)
-        : lexer_(stream, filename)
+        : lexer_(std::make_shared<Lexer>(stream, filename))
     {
-        lookahead_[0] = lexer_.lex();
-        lookahead_[1] = lexer_.lex();
-        lookahead_[2] = lexer_.lex();
-        prev_loc_ = Loc(filename, {1, 1});
+        init(SrcLoc::intern(filename));
+    }
+
+    Parser(const char* begin, const char* end, const char* filename)
+        : lexer_(std::make_shared<Lexer>(begin, end, filename))
+    {
+        init(SrcLoc::intern(filename));
+    }
+
+    Parser(const char* filename)
+        : lexer_(std::make_shared<Lexer>(filename))
+    {
+        init(SrcLoc::intern(filename));
+    }
+
+    Parser(std::shared_ptr<TokenStream>&& tokens, const char* filename)
+        : tokens_(std::move(tokens))
+    {
+        init(SrcLoc::intern(filename));
+    }
+
+    /// Parses a skipped function body; @p lazy_body must not be empty.
+    Parser(const LazyBody& lazy_body)
+        : lazy_body_(&lazy_body)
+    {
+        init(lazy_body.tokens.front().src_loc().file);
     }
 
     const Token& lookahead(size_t i = 0) const { assert(i < 3); return lookahead_[i]; }
     Loc prev_loc() const { return prev_loc_; }
+    size_t num_tokens() const { return num_tokens_; } ///< Number of @p Token%s lexed so far.
 
 #ifdef NDEBUG
     Token eat(TokenTag) { return lex(); }
@@ -132,19 +160,20 @@ public:
 
     class Tracker {
     public:
-        Tracker(Parser& parser, const Loc& loc)
+        Tracker(Parser& parser, const SrcLoc& loc)
             : parser_(parser), loc_(loc)
         {}
 
-        operator Loc() const { return {loc_.file, loc_.begin, parser_.prev_loc().finis}; }
+        operator Loc() const { return SrcLoc(loc_.file, loc_.begin, parser_.prev_loc_.finis); }
 
     private:
         Parser& parser_;
-        Loc loc_;
+        SrcLoc loc_;
     };
 
-    Tracker track() { return Tracker(*this, lookahead().loc().anew_begin()); }
-    Tracker track(const Loc& loc) { return Tracker(*this, loc); }
+    Tracker track() { return Tracker(*this, lookahead().src_loc().anew_begin()); }
+    /// All locations a @p Parser sees are in the same file, so this does not need to intern @p loc.file.
+    Tracker track(const Loc& loc) { return Tracker(*this, SrcLoc(prev_loc_.file, loc.begin, loc.begin)); }
 
     template<class T, class... Args>
     const T* create(Args&&... args) { return new T(prev_loc(), std::forward<Args>(args)...); }
@@ -209,7 +238,7 @@ public:
     const SimdASTType*  parse_simd_type();
     const ASTTypeApp*   parse_ast_type_app();
 
-    enum class BodyMode { None, Optional, Mandatory };
+    enum class BodyMode { None, Optional, Mandatory, Lazy };
 
     // items + helpers
     const Item*        parse_item();
@@ -226,6 +255,7 @@ public:
     const FieldDecl*   parse_field_decl(const size_t i);
     const TraitDecl*   parse_trait_decl(Tracker, Visibility);
     const Typedef*     parse_typedef(Tracker, Visibility);
+    std::unique_ptr<LazyBody> skip_body();
 
     // expressions
     const Expr*         parse_expr(Prec prec);
@@ -233,7 +263,7 @@ public:
     const Expr*         parse_prefix_expr();
     const Expr*         parse_infix_expr(Tracker, const Expr* lhs);
     const Expr*         parse_postfix_expr(Tracker, const Expr* lhs);
-    const MapExpr*      parse_map_expr(Tracker, const Expr* lhs);
+    const Expr*         parse_map_expr(Tracker, const Expr* lhs);
     const TypeAppExpr*  parse_type_app_expr(Tracker, const Expr* lhs);
     const Expr*         parse_primary_expr();
     const LiteralExpr*  parse_literal_expr();
@@ -251,6 +281,8 @@ public:
 
     // patterns
     const Ptrn*        parse_ptrn();
+    const Ptrn*        parse_simple_ptrn();
+    const Ptrn*        parse_range_ptrn(const Ptrn* lo);
     const TuplePtrn*   parse_tuple_ptrn();
     const IdPtrn*      parse_id_ptrn(const Identifier*);
     const EnumPtrn*    parse_enum_ptrn(const Path*);
@@ -267,6 +299,13 @@ public:
     const AsmStmt::Elem* parse_asm_op();
 
 private:
+    void init(const std::string* file) {
+        lookahead_[0] = next_token();
+        lookahead_[1] = next_token();
+        lookahead_[2] = next_token();
+        prev_loc_ = SrcLoc(file, {1, 1}, {1, 1});
+    }
+
     /// Consume next Token in input stream, fill look-ahead buffer, return consumed Token.
     Token lex();
 
@@ -276,18 +315,112 @@ private:
         return create<LocalDecl>(identifier, ast_type);
     }
 
-    Lexer lexer_;        ///< invoked in order to get next token
+    Token next_token();
+
+    std::shared_ptr<Lexer> lexer_; ///< invoked in order to get next token unless reading from a @p TokenStream or a @p LazyBody
+    std::shared_ptr<TokenStream> tokens_;
+    const LazyBody* lazy_body_ = nullptr;
     Token lookahead_[3]; ///< SLL(3) look ahead
-    Loc prev_loc_;
+    SrcLoc prev_loc_;
+    size_t num_tokens_ = 0;
+    bool lazy_ = lazy_bodies(); ///< skip bodies of functions while parsing items of a module
 };
 
 //------------------------------------------------------------------------------
 
-void parse(Items& items, std::istream& is, const char* filename) {
-    Parser parser(is, filename);
+static void parse_module(Parser& parser, Items& items) {
     parser.parse_items(items);
     if (parser.lookahead() != Token::Eof)
         parser.error("module item", "module contents");
+    if (auto report = TimeReport::active())
+        report->count("tokens", parser.num_tokens());
+}
+
+void parse(Items& items, std::istream& is, const char* filename) {
+    Parser parser(is, filename);
+    parse_module(parser, items);
+}
+
+void parse(Items& items, const char* begin, const char* end, const char* filename) {
+    Parser parser(begin, end, filename);
+    parse_module(parser, items);
+}
+
+void parse(Items& items, const char* filename) {
+    Parser parser(filename);
+    parse_module(parser, items);
+}
+
+void FnDecl::parse_lazy_body() const {
+    auto lazy_body = std::move(lazy_body_);
+    Arena::Scope scope(lazy_body->arena);
+    Parser parser(*lazy_body);
+    set_body(parser.parse_block_expr());
+}
+
+void parse(Items& items, const std::vector<std::string>& filenames, unsigned num_threads) {
+    auto num_files = filenames.size();
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (num_threads == 1 || num_files <= 1) {
+        for (const auto& filename : filenames) {
+            if (is_preparsed(filename))
+                load(items, filename.c_str());
+            else
+                parse(items, filename.c_str());
+        }
+        return;
+    }
+
+    // Lex all files concurrently while this thread parses them one after another in the given order.
+    // Parsing itself stays sequential: it interns Symbols and thorin's symbol table is not synchronized.
+    // For the same reason, preparsed modules are loaded by this thread as well.
+    std::vector<std::promise<std::unique_ptr<TokenStream>>> promises(num_files);
+    std::vector<std::future<std::unique_ptr<TokenStream>>> futures;
+    for (auto& promise : promises)
+        futures.emplace_back(promise.get_future());
+
+    std::atomic<size_t> next_file(0);
+    auto& context = Context::current();
+    auto lex_files = [&] {
+        Context::Scope scope(context); // count diagnostics of the lexers
+        for (size_t i; (i = next_file++) < num_files;) {
+            try {
+                if (is_preparsed(filenames[i]))
+                    promises[i].set_value(nullptr);
+                else
+                    promises[i].set_value(std::make_unique<TokenStream>(std::make_unique<Lexer>(filenames[i].c_str())));
+            } catch (...) {
+                promises[i].set_exception(std::current_exception());
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0, e = std::min(size_t(num_threads), num_files); i != e; ++i)
+        threads.emplace_back(lex_files);
+
+    auto join = [&] {
+        next_file = num_files; // stop handing out new files
+        for (auto& thread : threads)
+            thread.join();
+    };
+
+    try {
+        for (size_t i = 0; i != num_files; ++i) {
+            auto tokens = futures[i].get();
+            if (tokens == nullptr) {
+                load(items, filenames[i].c_str());
+                continue;
+            }
+            Parser parser(std::move(tokens), filenames[i].c_str());
+            parse_module(parser, items);
+        }
+    } catch (...) {
+        join();
+        throw;
+    }
+    join();
 }
 
 //------------------------------------------------------------------------------
@@ -296,12 +429,23 @@ void parse(Items& items, std::istream& is, const char* filename) {
  * helpers
  */
 
+Token Parser::next_token() {
+    ++num_tokens_;
+    if (lazy_body_ != nullptr) {
+        const auto& tokens = lazy_body_->tokens;
+        if (num_tokens_ > tokens.size())
+            return Token(tokens.back().src_loc().anew_finis(), Token::Eof);
+        return tokens[num_tokens_ - 1];
+    }
+    return tokens_ ? tokens_->lex() : lexer_->lex();
+}
+
 Token Parser::lex() {
     Token result = lookahead_[0];  // remember result
     lookahead_[0] = lookahead_[1]; // copy over LA2 to LA1
     lookahead_[1] = lookahead_[2]; // copy over LA3 to LA2
-    lookahead_[2] = lexer_.lex();  // fill new LA3
-    prev_loc_ = result.loc(); // remember previous loc
+    lookahead_[2] = next_token();  // fill new LA3
+    prev_loc_ = result.src_loc(); // remember previous loc
     return result;
 }
 
@@ -335,7 +479,7 @@ const Identifier* Parser::try_identifier(const std::string& what) {
         name = lex();
     else {
         error("identifier", what);
-        name = Token(lookahead().loc(), "<error>");
+        name = Token(lookahead().src_loc(), "<error>");
     }
 
     return new Identifier(name);
@@ -501,7 +645,7 @@ const Item* Parser::parse_item() {
     switch (lookahead()) {
         case Token::ENUM:    return parse_enum_decl(tracker, vis);
         case Token::EXTERN:  return parse_extern_block_or_fn_decl(tracker, vis);
-        case Token::FN:      return parse_fn_decl(BodyMode::Mandatory, tracker, vis, /*extern*/ false, /*abi*/ "");
+        case Token::FN:      return parse_fn_decl(lazy_ && !vis.is_pub() ? BodyMode::Lazy : BodyMode::Mandatory, tracker, vis, /*extern*/ false, /*abi*/ "");
         case Token::IMPL:    return parse_impl(tracker, vis);
         case Token::MOD:     return parse_module_or_module_decl(tracker, vis);
         case Token::STATIC:  return parse_static_item(tracker, vis);
@@ -569,6 +713,7 @@ const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility v
         params.emplace_back(ret_param);
 
     const Expr* body = nullptr;
+    std::unique_ptr<LazyBody> lazy_body;
     switch (mode) {
         case BodyMode::None:      expect(Token::SEMICOLON, "function declaration"); break;
         case BodyMode::Mandatory: body = try_block_expr("body of function"); break;
@@ -576,10 +721,43 @@ const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility v
             if (!accept(Token::SEMICOLON))
                 body = try_block_expr("body of function");
             break;
+        case BodyMode::Lazy:
+            // main is always emitted, so there is no point in skipping its body - just as for pub functions
+            if (lookahead() == Token::L_BRACE && identifier->symbol() != "main")
+                lazy_body = skip_body();
+            else
+                body = try_block_expr("body of function");
+            break;
     }
 
-    return new FnDecl(tracker, vis, is_extern, abi, pe_expr, export_name, identifier,
-                      std::move(ast_type_params), std::move(params), body);
+    auto fn_decl = new FnDecl(tracker, vis, is_extern, abi, pe_expr, export_name, identifier,
+                              std::move(ast_type_params), std::move(params), body);
+    fn_decl->set_lazy_body(std::move(lazy_body));
+    return fn_decl;
+}
+
+std::unique_ptr<LazyBody> Parser::skip_body() {
+    auto lazy_body = std::make_unique<LazyBody>();
+    if (lexer_)
+        lazy_body->source = lexer_;
+    else
+        lazy_body->source = tokens_;
+    lazy_body->arena = Arena::current();
+
+    size_t depth = 0;
+    do {
+        switch (lookahead()) {
+            case Token::L_BRACE: ++depth; break;
+            case Token::R_BRACE: --depth; break;
+            case Token::Eof:
+                error("'}'", "body of function");
+                return nullptr;
+            default: break;
+        }
+        lazy_body->tokens.emplace_back(lex());
+    } while (depth != 0);
+
+    return lazy_body;
 }
 
 const ImplItem* Parser::parse_impl(Tracker tracker, Visibility vis) {
@@ -672,7 +850,7 @@ const TraitDecl* Parser::parse_trait_decl(Tracker tracker, Visibility vis) {
 
     ASTTypeApps super_traits;
     if (accept(Token::COLON)) {
-        parse_comma_list("trait declaration", Token::L_BRACE, [&] {
+        nibble_comma_list({Token::L_BRACE}, [&] {
             super_traits.emplace_back(parse_ast_type_app());
         });
     }
@@ -727,11 +905,16 @@ const ArrayASTType* Parser::parse_array_type() {
     eat(Token::L_BRACKET);
     auto elem_ast_type = parse_type();
     if (accept(Token::MUL)) {
-        auto dim = parse_integer("definite array type");
+        auto dim = parse_expr();
         expect(Token::R_BRACKET, "definite array type");
         return new DefiniteArrayASTType(tracker, elem_ast_type, dim);
     }
 
+    if (accept(Token::DOTDOT)) {
+        expect(Token::R_BRACKET, "slice type");
+        return new SliceASTType(tracker, elem_ast_type);
+    }
+
     expect(Token::R_BRACKET, "indefinite array type");
     return new IndefiniteArrayASTType(tracker, elem_ast_type);
 }
@@ -908,10 +1091,20 @@ const Expr* Parser::parse_infix_expr(Tracker tracker, const Expr* lhs) {
     return new InfixExpr(tracker, lhs, (InfixExpr::Tag) tag, rhs);
 }
 
-const MapExpr* Parser::parse_map_expr(Tracker tracker, const Expr* lhs) {
+const Expr* Parser::parse_map_expr(Tracker tracker, const Expr* lhs) {
     eat(Token::L_PAREN);
     Exprs args;
-    parse_comma_list("arguments of a map expression", Token::R_PAREN, [&] { args.emplace_back(parse_expr()); });
+    nibble_comma_list({Token::R_PAREN, Token::DOTDOT}, [&] { args.emplace_back(parse_expr()); });
+
+    // lhs(lo..hi) - both bounds may be omitted
+    if (args.size() <= 1 && accept(Token::DOTDOT)) {
+        auto lo = args.empty() ? create<EmptyExpr>() : args.front().release();
+        auto hi = lookahead() == Token::R_PAREN ? create<EmptyExpr>() : parse_expr();
+        expect(Token::R_PAREN, "slice expression");
+        return new SliceExpr(tracker, lhs, lo, hi);
+    }
+
+    expect(Token::R_PAREN, "arguments of a map expression");
     return new MapExpr(tracker, lhs, std::move(args));
 }
 
@@ -1220,6 +1413,7 @@ const WhileExpr* Parser::parse_while_expr() {
 }
 
 const BlockExpr* Parser::parse_block_expr() {
+    THORIN_PUSH(lazy_, false); // items within blocks are bound in the scope of the block - never skip their bodies
     auto tracker = track();
     eat(Token::L_BRACE);
     Stmts stmts;
@@ -1292,15 +1486,28 @@ const Expr* Parser::parse_pe_expr(const char* context) {
  */
 
 const Ptrn* Parser::parse_ptrn() {
+    auto tracker = track();
+    auto ptrn = parse_simple_ptrn();
+    if (lookahead() != Token::OR)
+        return ptrn;
+
+    Ptrns alts;
+    alts.emplace_back(ptrn);
+    while (accept(Token::OR))
+        alts.emplace_back(parse_simple_ptrn());
+    return new OrPtrn(tracker, std::move(alts));
+}
+
+const Ptrn* Parser::parse_simple_ptrn() {
     switch (lookahead()) {
         case Token::SUB:
         case Token::TRUE:
         case Token::FALSE:
 #define IMPALA_LIT(itype, atype) case Token::LIT_##itype:
 #include "impala/tokenlist.h"
-            return parse_literal_ptrn();
+            return parse_range_ptrn(parse_literal_ptrn());
 
-        case Token::LIT_char: return parse_char_ptrn();
+        case Token::LIT_char: return parse_range_ptrn(parse_char_ptrn());
         case Token::L_PAREN:  return parse_tuple_ptrn();
         case Token::MUT:      return parse_id_ptrn(nullptr);
         default: {
@@ -1355,6 +1562,18 @@ const CharPtrn* Parser::parse_char_ptrn() {
     return new CharPtrn(parse_char_expr());
 }
 
+/// Parses the rest of the range pattern @p lo starts if @c ..= follows and returns @p lo otherwise.
+const Ptrn* Parser::parse_range_ptrn(const Ptrn* lo) {
+    if (lookahead() != Token::DOTDOT)
+        return lo;
+
+    auto tracker = track(lo->loc());
+    eat(Token::DOTDOT);
+    expect(Token::ASGN, "inclusive range pattern");
+    const Ptrn* hi = lookahead() == Token::LIT_char ? (const Ptrn*) parse_char_ptrn() : parse_literal_ptrn();
+    return new RangePtrn(tracker, lo, hi);
+}
+
 /*
  * statements
  */
@@ -0,0 +1,1064 @@
+#include "impala/preparsed.h"
+
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "impala/ast.h"
+#include "impala/lexer.h"
+
+namespace impala {
+
+/*
+ * format: magic, version, string table, items
+ *
+ * All numbers are unsigned LEB128.
+ * All strings - symbols, file names and literal text - are stored once in the string table and referenced by index.
+ * Each node is stored in pre-order; nodes in a slot which admits several classes are preceded by their @p Node tag.
+ */
+
+static const char magic[4] = { 'I', 'M', 'P', 'P' };
+static const uint64_t version = 4;
+
+enum class Node : uint8_t {
+    Null,
+    // AST types
+    ErrorASTType, PrimASTType, PtrASTType, IndefiniteArrayASTType, DefiniteArrayASTType, SliceASTType, SimdASTType,
+    TupleASTType, ASTTypeApp, FnASTType, Typeof,
+    // items
+    Module, ModuleDecl, ExternBlock, Typedef, StructDecl, EnumDecl, StaticItem, FnDecl, TraitDecl, ImplItem,
+    // expressions
+    EmptyExpr, LiteralExpr, CharExpr, StrExpr, FnExpr, PathExpr, PrefixExpr, InfixExpr, PostfixExpr, FieldExpr,
+    ExplicitCastExpr, DefiniteArrayExpr, RepeatedDefiniteArrayExpr, IndefiniteArrayExpr, TupleExpr, SimdExpr,
+    StructExpr, TypeAppExpr, MapExpr, SliceExpr, BlockExpr, IfExpr, MatchExpr, WhileExpr, ForExpr,
+    // patterns
+    TuplePtrn, IdPtrn, EnumPtrn, LiteralPtrn, CharPtrn, RangePtrn, OrPtrn,
+    // statements
+    ExprStmt, ItemStmt, LetStmt, AsmStmt,
+    Num
+};
+
+bool is_preparsed(const std::string& filename) {
+    auto ext_size = std::strlen(preparsed_ext);
+    return filename.size() > ext_size && filename.compare(filename.size() - ext_size, ext_size, preparsed_ext) == 0;
+}
+
+static void put_num(std::string& out, uint64_t num) {
+    for (; num >= 0x80; num >>= 7)
+        out += char(num | 0x80);
+    out += char(num);
+}
+
+//------------------------------------------------------------------------------
+
+class Writer {
+public:
+    void items(const Items& items) { list(items, [&] (const Item* item) { this->item(item); }); }
+
+    void flush(std::ostream& os) const {
+        std::string header(magic, sizeof(magic));
+        put_num(header, version);
+        put_num(header, strings_.size());
+        for (auto str : strings_) {
+            put_num(header, str->size());
+            header += *str;
+        }
+        os.write(header.data(), header.size());
+        os.write(body_.data(), body_.size());
+    }
+
+private:
+    void num(uint64_t num) { put_num(body_, num); }
+    void flag(bool flag) { num(flag); }
+    void node(Node node) { num(uint64_t(node)); }
+    void sym(Symbol symbol) { str(symbol.str()); }
+
+    void str(const std::string& str) {
+        auto p = string2index_.emplace(str, strings_.size());
+        if (p.second)
+            strings_.push_back(&p.first->first);
+        num(p.first->second);
+    }
+
+    void loc(Loc loc) {
+        str(loc.file);
+        num(loc.begin.row);
+        num(loc.begin.col);
+        num(loc.finis.row);
+        num(loc.finis.col);
+    }
+
+    void vis(Visibility vis) { num(vis.is_pub() ? 1 : vis.is_priv() ? 2 : 0); }
+
+    template<class List, class F>
+    void list(const List& list, F f) {
+        num(list.size());
+        for (const auto& elem : list)
+            f(elem.get());
+    }
+
+    [[noreturn]] void unsupported(const ASTNode* n) {
+        std::ostringstream os;
+        Stream s(os);
+        s.fmt("{}: only unchecked nodes with all function bodies parsed can be stored in a preparsed module", n->loc());
+        throw std::logic_error(os.str());
+    }
+
+    void identifier(const Identifier*);
+    void path(const Path*);
+    void ast_type_params(const ASTTypeParams&);
+    void local(const LocalDecl*);
+    void params(ArrayRef<std::unique_ptr<const Param>>);
+    void ast_type(const ASTType*);
+    void ast_types(ASTTypeArgs types) { list(types, [&] (const ASTType* type) { ast_type(type); }); }
+    void item(const Item*);
+    void fn_decl(const FnDecl*);
+    void expr(const Expr*);
+    void exprs(const Exprs& exprs) { list(exprs, [&] (const Expr* expr) { this->expr(expr); }); }
+    void ptrn(const Ptrn*);
+    void stmt(const Stmt*);
+
+    std::string body_;
+    std::unordered_map<std::string, size_t> string2index_;
+    std::vector<const std::string*> strings_;
+};
+
+void Writer::identifier(const Identifier* id) {
+    flag(id != nullptr);
+    if (id != nullptr) {
+        loc(id->loc());
+        sym(id->symbol());
+    }
+}
+
+void Writer::path(const Path* path) {
+    loc(path->loc());
+    flag(path->is_global());
+    list(path->elems(), [&] (const Path::Elem* elem) { identifier(elem->identifier()); });
+}
+
+void Writer::ast_type_params(const ASTTypeParams& ast_type_params) {
+    list(ast_type_params, [&] (const ASTTypeParam* param) {
+        loc(param->loc());
+        identifier(param->identifier());
+        ast_types(param->bounds());
+    });
+}
+
+void Writer::local(const LocalDecl* local) {
+    flag(local != nullptr);
+    if (local != nullptr) {
+        loc(local->loc());
+        flag(local->is_mut());
+        identifier(local->identifier());
+        ast_type(local->ast_type());
+    }
+}
+
+void Writer::params(ArrayRef<std::unique_ptr<const Param>> params) {
+    list(params, [&] (const Param* param) {
+        local(param);
+        expr(param->filter());
+    });
+}
+
+void Writer::ast_type(const ASTType* type) {
+    if (type == nullptr) {
+        node(Node::Null);
+    } else if (auto error = type->isa<ErrorASTType>()) {
+        node(Node::ErrorASTType);
+        loc(error->loc());
+    } else if (auto prim = type->isa<PrimASTType>()) {
+        node(Node::PrimASTType);
+        loc(prim->loc());
+        num(prim->tag());
+    } else if (auto ptr = type->isa<PtrASTType>()) {
+        node(Node::PtrASTType);
+        loc(ptr->loc());
+        num(ptr->tag());
+        num(uint32_t(ptr->addr_space()));
+        ast_type(ptr->referenced_ast_type());
+    } else if (auto array = type->isa<IndefiniteArrayASTType>()) {
+        node(Node::IndefiniteArrayASTType);
+        loc(array->loc());
+        ast_type(array->elem_ast_type());
+    } else if (auto array = type->isa<DefiniteArrayASTType>()) {
+        node(Node::DefiniteArrayASTType);
+        loc(array->loc());
+        ast_type(array->elem_ast_type());
+        expr(array->dim());
+    } else if (auto slice = type->isa<SliceASTType>()) {
+        node(Node::SliceASTType);
+        loc(slice->loc());
+        ast_type(slice->elem_ast_type());
+    } else if (auto simd = type->isa<SimdASTType>()) {
+        node(Node::SimdASTType);
+        loc(simd->loc());
+        ast_type(simd->elem_ast_type());
+        num(simd->size());
+    } else if (auto tuple = type->isa<TupleASTType>()) {
+        node(Node::TupleASTType);
+        loc(tuple->loc());
+        ast_types(tuple->ast_type_args());
+    } else if (auto app = type->isa<ASTTypeApp>()) {
+        node(Node::ASTTypeApp);
+        loc(app->loc());
+        path(app->path());
+        ast_types(app->ast_type_args());
+    } else if (auto fn = type->isa<FnASTType>()) {
+        node(Node::FnASTType);
+        loc(fn->loc());
+        ast_type_params(fn->ast_type_params());
+        ast_types(fn->ast_type_args());
+    } else if (auto type_of = type->isa<Typeof>()) {
+        node(Node::Typeof);
+        loc(type_of->loc());
+        expr(type_of->expr());
+    } else {
+        unsupported(type);
+    }
+}
+
+void Writer::fn_decl(const FnDecl* fn) {
+    if (fn->is_lazy())
+        unsupported(fn);
+    loc(fn->loc());
+    vis(fn->visibility());
+    flag(fn->is_extern());
+    sym(fn->abi());
+    expr(fn->filter());
+    sym(fn->export_name());
+    identifier(fn->identifier());
+    ast_type_params(fn->ast_type_params());
+    params(fn->params());
+    expr(fn->body());
+}
+
+void Writer::item(const Item* item) {
+    if (auto module = item->isa<Module>()) {
+        node(Node::Module);
+        loc(module->loc());
+        vis(module->visibility());
+        identifier(module->identifier());
+        ast_type_params(module->ast_type_params());
+        items(module->items());
+    } else if (auto module_decl = item->isa<ModuleDecl>()) {
+        node(Node::ModuleDecl);
+        loc(module_decl->loc());
+        vis(module_decl->visibility());
+        identifier(module_decl->identifier());
+        ast_type_params(module_decl->ast_type_params());
+    } else if (auto extern_block = item->isa<ExternBlock>()) {
+        node(Node::ExternBlock);
+        loc(extern_block->loc());
+        vis(extern_block->visibility());
+        sym(extern_block->abi());
+        list(extern_block->fn_decls(), [&] (const FnDecl* fn) { fn_decl(fn); });
+    } else if (auto typedef_ = item->isa<Typedef>()) {
+        node(Node::Typedef);
+        loc(typedef_->loc());
+        vis(typedef_->visibility());
+        identifier(typedef_->identifier());
+        ast_type_params(typedef_->ast_type_params());
+        ast_type(typedef_->ast_type());
+    } else if (auto struct_decl = item->isa<StructDecl>()) {
+        node(Node::StructDecl);
+        loc(struct_decl->loc());
+        vis(struct_decl->visibility());
+        identifier(struct_decl->identifier());
+        ast_type_params(struct_decl->ast_type_params());
+        list(struct_decl->field_decls(), [&] (const FieldDecl* field) {
+            loc(field->loc());
+            num(field->index());
+            vis(field->visibility());
+            identifier(field->identifier());
+            ast_type(field->ast_type());
+        });
+    } else if (auto enum_decl = item->isa<EnumDecl>()) {
+        node(Node::EnumDecl);
+        loc(enum_decl->loc());
+        vis(enum_decl->visibility());
+        identifier(enum_decl->identifier());
+        ast_type_params(enum_decl->ast_type_params());
+        list(enum_decl->option_decls(), [&] (const OptionDecl* option) {
+            loc(option->loc());
+            num(option->index());
+            identifier(option->identifier());
+            ast_types(option->args());
+        });
+    } else if (auto static_item = item->isa<StaticItem>()) {
+        node(Node::StaticItem);
+        loc(static_item->loc());
+        vis(static_item->visibility());
+        flag(static_item->is_mut());
+        identifier(static_item->identifier());
+        ast_type(static_item->ast_type());
+        expr(static_item->init());
+    } else if (auto fn = item->isa<FnDecl>()) {
+        node(Node::FnDecl);
+        fn_decl(fn);
+    } else if (auto trait = item->isa<TraitDecl>()) {
+        node(Node::TraitDecl);
+        loc(trait->loc());
+        vis(trait->visibility());
+        identifier(trait->identifier());
+        ast_type_params(trait->ast_type_params());
+        list(trait->super_traits(), [&] (const ASTTypeApp* super) { ast_type(super); });
+        list(trait->methods(), [&] (const FnDecl* fn) { fn_decl(fn); });
+    } else if (auto impl = item->isa<ImplItem>()) {
+        node(Node::ImplItem);
+        loc(impl->loc());
+        vis(impl->visibility());
+        ast_type_params(impl->ast_type_params());
+        ast_type(impl->trait());
+        ast_type(impl->ast_type());
+        list(impl->methods(), [&] (const FnDecl* fn) { fn_decl(fn); });
+    } else {
+        unsupported(item);
+    }
+}
+
+void Writer::expr(const Expr* expr) {
+    if (expr == nullptr) {
+        node(Node::Null);
+    } else if (auto empty = expr->isa<EmptyExpr>()) {
+        node(Node::EmptyExpr);
+        loc(empty->loc());
+    } else if (auto literal = expr->isa<LiteralExpr>()) {
+        node(Node::LiteralExpr);
+        loc(literal->loc());
+        num(literal->tag());
+        num(literal->get_u64());
+    } else if (auto chr = expr->isa<CharExpr>()) {
+        node(Node::CharExpr);
+        loc(chr->loc());
+        sym(chr->symbol());
+        num(uint8_t(chr->value()));
+    } else if (auto str = expr->isa<StrExpr>()) {
+        node(Node::StrExpr);
+        loc(str->loc());
+        num(str->symbols().size());
+        for (auto symbol : str->symbols())
+            sym(symbol);
+        this->str(std::string(str->values().begin(), str->values().end()));
+    } else if (auto fn = expr->isa<FnExpr>()) {
+        node(Node::FnExpr);
+        loc(fn->loc());
+        this->expr(fn->filter());
+        params(fn->params());
+        this->expr(fn->body());
+    } else if (auto path_expr = expr->isa<PathExpr>()) {
+        node(Node::PathExpr);
+        path(path_expr->path());
+    } else if (auto prefix = expr->isa<PrefixExpr>()) {
+        node(Node::PrefixExpr);
+        loc(prefix->loc());
+        num(prefix->tag());
+        this->expr(prefix->rhs());
+    } else if (auto infix = expr->isa<InfixExpr>()) {
+        node(Node::InfixExpr);
+        loc(infix->loc());
+        this->expr(infix->lhs());
+        num(infix->tag());
+        this->expr(infix->rhs());
+    } else if (auto postfix = expr->isa<PostfixExpr>()) {
+        node(Node::PostfixExpr);
+        loc(postfix->loc());
+        this->expr(postfix->lhs());
+        num(postfix->tag());
+    } else if (auto field = expr->isa<FieldExpr>()) {
+        node(Node::FieldExpr);
+        loc(field->loc());
+        this->expr(field->lhs());
+        identifier(field->identifier());
+    } else if (auto cast = expr->isa<ExplicitCastExpr>()) {
+        node(Node::ExplicitCastExpr);
+        loc(cast->loc());
+        this->expr(cast->src());
+        ast_type(cast->ast_type());
+    } else if (auto array = expr->isa<DefiniteArrayExpr>()) {
+        node(Node::DefiniteArrayExpr);
+        loc(array->loc());
+        exprs(array->args());
+    } else if (auto array = expr->isa<RepeatedDefiniteArrayExpr>()) {
+        node(Node::RepeatedDefiniteArrayExpr);
+        loc(array->loc());
+        this->expr(array->value());
+        num(array->count());
+    } else if (auto array = expr->isa<IndefiniteArrayExpr>()) {
+        node(Node::IndefiniteArrayExpr);
+        loc(array->loc());
+        this->expr(array->dim());
+        ast_type(array->elem_ast_type());
+    } else if (auto tuple = expr->isa<TupleExpr>()) {
+        node(Node::TupleExpr);
+        loc(tuple->loc());
+        exprs(tuple->args());
+    } else if (auto simd = expr->isa<SimdExpr>()) {
+        node(Node::SimdExpr);
+        loc(simd->loc());
+        exprs(simd->args());
+    } else if (auto struct_expr = expr->isa<StructExpr>()) {
+        node(Node::StructExpr);
+        loc(struct_expr->loc());
+        ast_type(struct_expr->ast_type_app());
+        list(struct_expr->elems(), [&] (const StructExpr::Elem* elem) {
+            loc(elem->loc());
+            identifier(elem->identifier());
+            this->expr(elem->expr());
+        });
+    } else if (auto type_app = expr->isa<TypeAppExpr>()) {
+        node(Node::TypeAppExpr);
+        loc(type_app->loc());
+        this->expr(type_app->lhs());
+        ast_types(type_app->ast_type_args());
+    } else if (auto map = expr->isa<MapExpr>()) {
+        node(Node::MapExpr);
+        loc(map->loc());
+        this->expr(map->lhs());
+        exprs(map->args());
+    } else if (auto slice = expr->isa<SliceExpr>()) {
+        node(Node::SliceExpr);
+        loc(slice->loc());
+        this->expr(slice->lhs());
+        this->expr(slice->lo());
+        this->expr(slice->hi());
+    } else if (auto block = expr->isa<BlockExpr>()) {
+        node(Node::BlockExpr);
+        loc(block->loc());
+        list(block->stmts(), [&] (const Stmt* stmt) { this->stmt(stmt); });
+        this->expr(block->expr());
+    } else if (auto if_expr = expr->isa<IfExpr>()) {
+        node(Node::IfExpr);
+        loc(if_expr->loc());
+        this->expr(if_expr->cond());
+        this->expr(if_expr->then_expr());
+        this->expr(if_expr->else_expr());
+    } else if (auto match = expr->isa<MatchExpr>()) {
+        node(Node::MatchExpr);
+        loc(match->loc());
+        this->expr(match->expr());
+        list(match->arms(), [&] (const MatchExpr::Arm* arm) {
+            loc(arm->loc());
+            ptrn(arm->ptrn());
+            this->expr(arm->expr());
+        });
+    } else if (auto while_expr = expr->isa<WhileExpr>()) {
+        node(Node::WhileExpr);
+        loc(while_expr->loc());
+        local(while_expr->continue_decl());
+        this->expr(while_expr->cond());
+        this->expr(while_expr->body());
+        local(while_expr->break_decl());
+    } else if (auto for_expr = expr->isa<ForExpr>()) {
+        node(Node::ForExpr);
+        loc(for_expr->loc());
+        this->expr(for_expr->fn_expr());
+        this->expr(for_expr->expr());
+        local(for_expr->break_decl());
+    } else {
+        unsupported(expr);
+    }
+}
+
+void Writer::ptrn(const Ptrn* ptrn) {
+    if (ptrn == nullptr) {
+        node(Node::Null);
+    } else if (auto tuple = ptrn->isa<TuplePtrn>()) {
+        node(Node::TuplePtrn);
+        loc(tuple->loc());
+        list(tuple->elems(), [&] (const Ptrn* elem) { this->ptrn(elem); });
+    } else if (auto id = ptrn->isa<IdPtrn>()) {
+        node(Node::IdPtrn);
+        local(id->local());
+    } else if (auto enum_ptrn = ptrn->isa<EnumPtrn>()) {
+        node(Node::EnumPtrn);
+        loc(enum_ptrn->loc());
+        path(enum_ptrn->path());
+        list(enum_ptrn->args(), [&] (const Ptrn* arg) { this->ptrn(arg); });
+    } else if (auto literal = ptrn->isa<LiteralPtrn>()) {
+        node(Node::LiteralPtrn);
+        expr(literal->literal());
+        flag(literal->has_minus());
+    } else if (auto chr = ptrn->isa<CharPtrn>()) {
+        node(Node::CharPtrn);
+        expr(chr->chr());
+    } else if (auto range = ptrn->isa<RangePtrn>()) {
+        node(Node::RangePtrn);
+        loc(range->loc());
+        this->ptrn(range->lo());
+        this->ptrn(range->hi());
+    } else if (auto or_ptrn = ptrn->isa<OrPtrn>()) {
+        node(Node::OrPtrn);
+        loc(or_ptrn->loc());
+        list(or_ptrn->alts(), [&] (const Ptrn* alt) { this->ptrn(alt); });
+    } else {
+        unsupported(ptrn);
+    }
+}
+
+void Writer::stmt(const Stmt* stmt) {
+    if (auto expr_stmt = stmt->isa<ExprStmt>()) {
+        node(Node::ExprStmt);
+        loc(expr_stmt->loc());
+        expr(expr_stmt->expr());
+    } else if (auto item_stmt = stmt->isa<ItemStmt>()) {
+        node(Node::ItemStmt);
+        loc(item_stmt->loc());
+        item(item_stmt->item());
+    } else if (auto let = stmt->isa<LetStmt>()) {
+        node(Node::LetStmt);
+        loc(let->loc());
+        ptrn(let->ptrn());
+        expr(let->init());
+    } else if (auto asm_stmt = stmt->isa<AsmStmt>()) {
+        node(Node::AsmStmt);
+        loc(asm_stmt->loc());
+        str(asm_stmt->asm_template());
+        auto elem = [&] (const AsmStmt::Elem* elem) {
+            loc(elem->loc());
+            str(elem->constraint());
+            expr(elem->expr());
+        };
+        list(asm_stmt->outputs(), elem);
+        list(asm_stmt->inputs(), elem);
+        num(asm_stmt->clobbers().size());
+        for (const auto& clobber : asm_stmt->clobbers())
+            str(clobber);
+        num(asm_stmt->options().size());
+        for (const auto& option : asm_stmt->options())
+            str(option);
+    } else {
+        unsupported(stmt);
+    }
+}
+
+void store(std::ostream& os, const Items& items) {
+    Writer writer;
+    writer.items(items);
+    writer.flush(os);
+}
+
+//------------------------------------------------------------------------------
+
+class Reader {
+public:
+    Reader(const char* begin, const char* end, const char* filename)
+        : cur_(begin)
+        , end_(end)
+        , filename_(filename)
+    {
+        if (size_t(end_ - cur_) < sizeof(magic) || std::memcmp(cur_, magic, sizeof(magic)) != 0)
+            throw std::runtime_error(filename_ + ": not a preparsed module");
+        cur_ += sizeof(magic);
+        if (num() != version)
+            throw std::runtime_error(filename_ + ": preparsed module has an unsupported version");
+
+        strings_.resize(count(1));
+        for (auto& str : strings_) {
+            auto size = count(1);
+            str.assign(cur_, size);
+            cur_ += size;
+        }
+        symbols_.resize(strings_.size());
+    }
+
+    void items(Items& items) {
+        for (auto n = count(1); n-- != 0;)
+            items.emplace_back(item());
+    }
+
+    bool done() const { return cur_ == end_; }
+
+private:
+    [[noreturn]] void corrupt() { throw std::runtime_error(filename_ + ": corrupt preparsed module"); }
+
+    uint64_t num() {
+        uint64_t result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cur_ == end_)
+                corrupt();
+            auto byte = uint8_t(*cur_++);
+            result |= uint64_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return result;
+        }
+        corrupt();
+    }
+
+    /// A number of elements each of which takes at least @p min_size bytes; guards allocations against corrupt files.
+    size_t count(size_t min_size) {
+        auto n = num();
+        if (n > size_t(end_ - cur_) / min_size)
+            corrupt();
+        return size_t(n);
+    }
+
+    bool flag() { return num() != 0; }
+
+    Node node() {
+        auto node = num();
+        if (node >= uint64_t(Node::Num))
+            corrupt();
+        return Node(node);
+    }
+
+    const std::string& str() {
+        auto i = num();
+        if (i >= strings_.size())
+            corrupt();
+        return strings_[i];
+    }
+
+    Symbol sym() {
+        auto i = num();
+        if (i >= strings_.size())
+            corrupt();
+        if (strings_[i].empty())
+            return Symbol();
+        if (!symbols_[i])
+            symbols_[i] = Symbol(strings_[i]);
+        return *symbols_[i];
+    }
+
+    Loc loc() {
+        const auto& file = str();
+        auto begin_row = uint32_t(num());
+        auto begin_col = uint32_t(num());
+        auto finis_row = uint32_t(num());
+        auto finis_col = uint32_t(num());
+        return Loc(file, {begin_row, begin_col}, {finis_row, finis_col});
+    }
+
+    Visibility vis() {
+        switch (num()) {
+            case 0: return Visibility(Visibility::None);
+            case 1: return Visibility(Visibility::Pub);
+            case 2: return Visibility(Visibility::Priv);
+            default: corrupt();
+        }
+    }
+
+    template<class T>
+    const T* expect(const ASTNode* n) {
+        if (n == nullptr || !n->isa<T>())
+            corrupt();
+        return n->as<T>();
+    }
+
+    template<class List, class F>
+    List list(F f) {
+        List list;
+        for (auto n = count(1); n-- != 0;)
+            list.emplace_back(f());
+        return list;
+    }
+
+    const Identifier* identifier();
+    const Path* path();
+    ASTTypeParams ast_type_params();
+    const LocalDecl* local();
+    Params params();
+    const ASTType* ast_type();
+    ASTTypes ast_types() { return list<ASTTypes>([&] { return ast_type(); }); }
+    const Item* item();
+    const FnDecl* fn_decl();
+    const Expr* expr();
+    Exprs exprs() { return list<Exprs>([&] { return expr(); }); }
+    const Ptrn* ptrn();
+    const Stmt* stmt();
+
+    const char* cur_;
+    const char* end_;
+    std::string filename_;
+    std::vector<std::string> strings_;
+    std::vector<std::optional<Symbol>> symbols_;
+};
+
+const Identifier* Reader::identifier() {
+    if (!flag())
+        return nullptr;
+    auto loc = this->loc();
+    return new Identifier(loc, sym());
+}
+
+const Path* Reader::path() {
+    auto loc = this->loc();
+    auto global = flag();
+    auto elems = list<Path::Elems>([&] { return new Path::Elem(expect<Identifier>(identifier())); });
+    return new Path(loc, global, std::move(elems));
+}
+
+ASTTypeParams Reader::ast_type_params() {
+    return list<ASTTypeParams>([&] {
+        auto loc = this->loc();
+        auto id = identifier();
+        return new ASTTypeParam(loc, id, ast_types());
+    });
+}
+
+const LocalDecl* Reader::local() {
+    if (!flag())
+        return nullptr;
+    auto loc = this->loc();
+    auto mut = flag();
+    auto id = identifier();
+    return new LocalDecl(loc, mut, id, ast_type());
+}
+
+Params Reader::params() {
+    return list<Params>([&] {
+        if (!flag())
+            corrupt();
+        auto loc = this->loc();
+        auto mut = flag();
+        auto id = identifier();
+        auto type = ast_type();
+        return new Param(loc, mut, id, type, expr());
+    });
+}
+
+const ASTType* Reader::ast_type() {
+    auto node = this->node();
+    if (node == Node::Null)
+        return nullptr;
+
+    auto loc = this->loc();
+    switch (node) {
+        case Node::ErrorASTType:
+            return new ErrorASTType(loc);
+        case Node::PrimASTType:
+            return new PrimASTType(loc, PrimASTType::Tag(num()));
+        case Node::PtrASTType: {
+            auto tag = PtrASTType::Tag(num());
+            auto addr_space = int(uint32_t(num()));
+            return new PtrASTType(loc, tag, addr_space, ast_type());
+        }
+        case Node::IndefiniteArrayASTType:
+            return new IndefiniteArrayASTType(loc, ast_type());
+        case Node::DefiniteArrayASTType: {
+            auto elem = ast_type();
+            return new DefiniteArrayASTType(loc, elem, expr());
+        }
+        case Node::SliceASTType:
+            return new SliceASTType(loc, ast_type());
+        case Node::SimdASTType: {
+            auto elem = ast_type();
+            return new SimdASTType(loc, elem, num());
+        }
+        case Node::TupleASTType:
+            return new TupleASTType(loc, ast_types());
+        case Node::ASTTypeApp: {
+            auto path = this->path();
+            return new ASTTypeApp(loc, path, ast_types());
+        }
+        case Node::FnASTType: {
+            auto type_params = ast_type_params();
+            return new FnASTType(loc, std::move(type_params), ast_types());
+        }
+        case Node::Typeof:
+            return new Typeof(loc, expr());
+        default:
+            corrupt();
+    }
+}
+
+const FnDecl* Reader::fn_decl() {
+    auto loc = this->loc();
+    auto vis = this->vis();
+    auto is_extern = flag();
+    auto abi = sym();
+    auto filter = expr();
+    auto export_name = sym();
+    auto id = identifier();
+    auto type_params = ast_type_params();
+    auto params = this->params();
+    return new FnDecl(loc, vis, is_extern, abi, filter, export_name, id, std::move(type_params), std::move(params), expr());
+}
+
+const Item* Reader::item() {
+    auto node = this->node();
+    if (node == Node::FnDecl)
+        return fn_decl();
+
+    auto loc = this->loc();
+    auto vis = this->vis();
+    switch (node) {
+        case Node::Module: {
+            auto id = identifier();
+            auto type_params = ast_type_params();
+            Items items;
+            this->items(items);
+            return new Module(loc, vis, id, std::move(type_params), std::move(items));
+        }
+        case Node::ModuleDecl: {
+            auto id = identifier();
+            return new ModuleDecl(loc, vis, id, ast_type_params());
+        }
+        case Node::ExternBlock: {
+            auto abi = sym();
+            return new ExternBlock(loc, vis, abi, list<FnDecls>([&] { return fn_decl(); }));
+        }
+        case Node::Typedef: {
+            auto id = identifier();
+            auto type_params = ast_type_params();
+            return new Typedef(loc, vis, id, std::move(type_params), ast_type());
+        }
+        case Node::StructDecl: {
+            auto id = identifier();
+            auto type_params = ast_type_params();
+            auto fields = list<FieldDecls>([&] {
+                auto loc = this->loc();
+                auto index = num();
+                auto vis = this->vis();
+                auto id = identifier();
+                return new FieldDecl(loc, index, vis, id, ast_type());
+            });
+            return new StructDecl(loc, vis, id, std::move(type_params), std::move(fields));
+        }
+        case Node::EnumDecl: {
+            auto id = identifier();
+            auto type_params = ast_type_params();
+            auto options = list<OptionDecls>([&] {
+                auto loc = this->loc();
+                auto index = num();
+                auto id = identifier();
+                return new OptionDecl(loc, index, id, ast_types());
+            });
+            return new EnumDecl(loc, vis, id, std::move(type_params), std::move(options));
+        }
+        case Node::StaticItem: {
+            auto mut = flag();
+            auto id = identifier();
+            auto type = ast_type();
+            return new StaticItem(loc, vis, mut, id, type, expr());
+        }
+        case Node::TraitDecl: {
+            auto id = identifier();
+            auto type_params = ast_type_params();
+            auto super_traits = list<ASTTypeApps>([&] { return expect<ASTTypeApp>(ast_type()); });
+            auto methods = list<FnDecls>([&] { return fn_decl(); });
+            return new TraitDecl(loc, vis, id, std::move(type_params), std::move(super_traits), std::move(methods));
+        }
+        case Node::ImplItem: {
+            auto type_params = ast_type_params();
+            auto trait = ast_type();
+            auto type = ast_type();
+            auto methods = list<FnDecls>([&] { return fn_decl(); });
+            return new ImplItem(loc, vis, std::move(type_params), trait, type, std::move(methods));
+        }
+        default:
+            corrupt();
+    }
+}
+
+const Expr* Reader::expr() {
+    auto node = this->node();
+    switch (node) {
+        case Node::Null:
+            return nullptr;
+        case Node::PathExpr:
+            return new PathExpr(path());
+        default:
+            break;
+    }
+
+    auto loc = this->loc();
+    switch (node) {
+        case Node::EmptyExpr:
+            return new EmptyExpr(loc);
+        case Node::LiteralExpr: {
+            auto tag = LiteralExpr::Tag(num());
+            return new LiteralExpr(loc, tag, thorin::bitcast<thorin::Box, uint64_t>(num()));
+        }
+        case Node::CharExpr: {
+            auto symbol = sym();
+            return new CharExpr(loc, symbol, char(num()));
+        }
+        case Node::StrExpr: {
+            auto symbols = list<Symbols>([&] { return sym(); });
+            const auto& values = str();
+            return new StrExpr(loc, std::move(symbols), std::vector<char>(values.begin(), values.end()));
+        }
+        case Node::FnExpr: {
+            auto filter = expr();
+            auto params = this->params();
+            return new FnExpr(loc, filter, std::move(params), expr());
+        }
+        case Node::PrefixExpr: {
+            auto tag = PrefixExpr::Tag(num());
+            return new PrefixExpr(loc, tag, expr());
+        }
+        case Node::InfixExpr: {
+            auto lhs = expr();
+            auto tag = InfixExpr::Tag(num());
+            return new InfixExpr(loc, lhs, tag, expr());
+        }
+        case Node::PostfixExpr: {
+            auto lhs = expr();
+            return new PostfixExpr(loc, lhs, PostfixExpr::Tag(num()));
+        }
+        case Node::FieldExpr: {
+            auto lhs = expr();
+            return new FieldExpr(loc, lhs, identifier());
+        }
+        case Node::ExplicitCastExpr: {
+            auto src = expr();
+            return new ExplicitCastExpr(loc, src, ast_type());
+        }
+        case Node::DefiniteArrayExpr:
+            return new DefiniteArrayExpr(loc, exprs());
+        case Node::RepeatedDefiniteArrayExpr: {
+            auto value = expr();
+            return new RepeatedDefiniteArrayExpr(loc, value, num());
+        }
+        case Node::IndefiniteArrayExpr: {
+            auto dim = expr();
+            return new IndefiniteArrayExpr(loc, dim, ast_type());
+        }
+        case Node::TupleExpr:
+            return new TupleExpr(loc, exprs());
+        case Node::SimdExpr:
+            return new SimdExpr(loc, exprs());
+        case Node::StructExpr: {
+            auto app = expect<ASTTypeApp>(ast_type());
+            auto elems = list<StructExpr::Elems>([&] {
+                auto loc = this->loc();
+                auto id = identifier();
+                return new StructExpr::Elem(loc, id, expr());
+            });
+            return new StructExpr(loc, app, std::move(elems));
+        }
+        case Node::TypeAppExpr: {
+            auto lhs = expr();
+            return new TypeAppExpr(loc, lhs, ast_types());
+        }
+        case Node::MapExpr: {
+            auto lhs = expr();
+            return new MapExpr(loc, lhs, exprs());
+        }
+        case Node::SliceExpr: {
+            auto lhs = expr();
+            auto lo = expr();
+            auto hi = expr();
+            return new SliceExpr(loc, lhs, lo, hi);
+        }
+        case Node::BlockExpr: {
+            auto stmts = list<Stmts>([&] { return stmt(); });
+            return new BlockExpr(loc, std::move(stmts), expr());
+        }
+        case Node::IfExpr: {
+            auto cond = expr();
+            auto then_expr = expr();
+            return new IfExpr(loc, cond, then_expr, expr());
+        }
+        case Node::MatchExpr: {
+            auto matched = expr();
+            auto arms = list<MatchExpr::Arms>([&] {
+                auto loc = this->loc();
+                auto ptrn = this->ptrn();
+                return new MatchExpr::Arm(loc, ptrn, expr());
+            });
+            return new MatchExpr(loc, matched, std::move(arms));
+        }
+        case Node::WhileExpr: {
+            auto continue_decl = local();
+            auto cond = expr();
+            auto body = expect<BlockExpr>(expr());
+            return new WhileExpr(loc, continue_decl, cond, body, local());
+        }
+        case Node::ForExpr: {
+            auto fn_expr = expect<FnExpr>(expr());
+            auto iter = expr();
+            return new ForExpr(loc, fn_expr, iter, local());
+        }
+        default:
+            corrupt();
+    }
+}
+
+const Ptrn* Reader::ptrn() {
+    switch (node()) {
+        case Node::Null:
+            return nullptr;
+        case Node::TuplePtrn: {
+            auto loc = this->loc();
+            return new TuplePtrn(loc, list<Ptrns>([&] { return ptrn(); }));
+        }
+        case Node::IdPtrn:
+            return new IdPtrn(expect<LocalDecl>(local()));
+        case Node::EnumPtrn: {
+            auto loc = this->loc();
+            auto path = this->path();
+            return new EnumPtrn(loc, path, list<Ptrns>([&] { return ptrn(); }));
+        }
+        case Node::LiteralPtrn: {
+            auto literal = expect<LiteralExpr>(expr());
+            return new LiteralPtrn(literal, flag());
+        }
+        case Node::CharPtrn:
+            return new CharPtrn(expect<CharExpr>(expr()));
+        case Node::RangePtrn: {
+            auto loc = this->loc();
+            auto lo = expect<Ptrn>(ptrn());
+            auto hi = expect<Ptrn>(ptrn());
+            if (!lo->isa<LiteralPtrn>() && !lo->isa<CharPtrn>()) corrupt();
+            if (!hi->isa<LiteralPtrn>() && !hi->isa<CharPtrn>()) corrupt();
+            return new RangePtrn(loc, lo, hi);
+        }
+        case Node::OrPtrn: {
+            auto loc = this->loc();
+            return new OrPtrn(loc, list<Ptrns>([&] { return ptrn(); }));
+        }
+        default:
+            corrupt();
+    }
+}
+
+const Stmt* Reader::stmt() {
+    auto node = this->node();
+    auto loc = this->loc();
+    switch (node) {
+        case Node::ExprStmt:
+            return new ExprStmt(loc, expr());
+        case Node::ItemStmt:
+            return new ItemStmt(loc, item());
+        case Node::LetStmt: {
+            auto ptrn = this->ptrn();
+            return new LetStmt(loc, ptrn, expr());
+        }
+        case Node::AsmStmt: {
+            auto asm_template = str();
+            auto elem = [&] {
+                auto loc = this->loc();
+                auto constraint = str();
+                return new AsmStmt::Elem(loc, std::move(constraint), expr());
+            };
+            auto outputs = list<AsmStmt::Elems>(elem);
+            auto inputs  = list<AsmStmt::Elems>(elem);
+            auto clobbers = list<Strings>([&] { return str(); });
+            auto options  = list<Strings>([&] { return str(); });
+            return new AsmStmt(loc, std::move(asm_template), std::move(outputs), std::move(inputs), std::move(clobbers), std::move(options));
+        }
+        default:
+            corrupt();
+    }
+}
+
+void load(Items& items, const char* begin, const char* end, const char* filename) {
+    Reader reader(begin, end, filename);
+    reader.items(items);
+    if (!reader.done())
+        throw std::runtime_error(std::string(filename) + ": corrupt preparsed module");
+}
+
+void load(Items& items, const char* filename) {
+    SourceBuffer buffer(filename);
+    load(items, buffer.begin(), buffer.end(), filename);
+}
+
+//------------------------------------------------------------------------------
+
+}
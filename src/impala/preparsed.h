@@ -0,0 +1,32 @@
+#ifndef IMPALA_PREPARSED_H
+#define IMPALA_PREPARSED_H
+
+#include <ostream>
+#include <string>
+
+#include "impala/impala.h"
+
+namespace impala {
+
+/**
+ * Preparsed modules are a compact binary encoding of parsed @p Item%s.
+ * Loading one replaces lexing and parsing of the sources it was made from - nothing else: semantic analysis still runs
+ * on the whole program as neither resolved declarations nor types are stored.
+ * Thus, a preparsed module yields exactly the same program as its sources.
+ * Files in this format have the extension @p preparsed_ext and may be passed wherever Impala sources are expected.
+ */
+constexpr const char* preparsed_ext = ".impp";
+
+/// Does @p filename have the extension @p preparsed_ext?
+bool is_preparsed(const std::string& filename);
+
+/// Writes @p items which must not have been checked yet as preparsed module to @p os.
+void store(std::ostream& os, const Items& items);
+
+/// Appends the @p Item%s of the preparsed module @p filename to @p items; throws @c std::runtime_error if it is corrupt.
+void load(Items& items, const char* filename);
+void load(Items& items, const char* begin, const char* end, const char* filename);
+
+}
+
+#endif
@@ -0,0 +1,692 @@
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+#include "impala/ast.h"
+#include "impala/impala.h"
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+/*
+ * The borrow checker looks at all calls of a program.
+ * Impala permits aliasing @c &mut pointers, so passing the very same variable twice - at least once mutably - only
+ * yields a warning.
+ * Furthermore, it tracks which memory escapes into memory, a closure or an unknown function.
+ *
+ * Owned pointers are moved whenever their value is used other than through a borrow - a dereference, a comparison or
+ * a coercion to a borrowed pointer. A local which may have been moved must be assigned anew before its next use.
+ * An owned local which only ever holds fresh memory nothing else refers to is released when its scope is left; if that
+ * memory has a small static size, it lives in the stack frame instead.
+ * Moving an owned local into another one - <tt>let owner = buf;</tt> - hands this responsibility over to the new local.
+ */
+
+/// Owned allocations of up to this many scalars may live in the stack frame.
+static const uint64_t max_frame_scalars = 1024;
+
+/// Where a pointer - or a closure which captures variables - may point to.
+struct Origin {
+    enum Kind {
+        Unknown, ///< Loaded from memory, returned from a call, the address of a static, ...
+        Addr,    ///< The address of the @p LocalDecl @p node or a part of it.
+        Value,   ///< The pointer stored in the @p LocalDecl @p node.
+        Fresh,   ///< The memory allocated by the @c ~ @p PrefixExpr @p node.
+    };
+
+    Origin(Kind kind = Unknown, const ASTNode* node = nullptr)
+        : kind(kind)
+        , node(node)
+    {}
+
+    size_t gid() const { return node ? node->gid() : 0; }
+    bool operator<(Origin other) const { return kind != other.kind ? kind < other.kind : gid() < other.gid(); }
+    bool operator==(Origin other) const { return kind == other.kind && node == other.node; }
+
+    Kind kind;
+    const ASTNode* node;
+};
+
+typedef std::set<Origin> Origins;
+
+class BorrowSema {
+public:
+    void check(const Item*);
+    void solve();
+
+private:
+    /// The raw @p Origins of the value of @p expr; all subexpressions are visited.
+    Origins visit(const Expr* expr);
+    /// The raw @p Origins of the memory @p expr refers to.
+    Origins place(const Expr* expr);
+    enum class Access { Borrow, Move, Write };
+    Origins use(const PathExpr* path, Access access = Access::Borrow);
+    /// Like @p visit but an owned local @p expr names is only borrowed - not moved.
+    Origins borrow(const Expr* expr);
+    Origins call(const MapExpr* map, const FnExpr* body = nullptr);
+    void visit(const Stmt* stmt);
+    void check_fn(const Fn* fn);
+    void escape(const Origins& origins) { escapes_.insert(origins.begin(), origins.end()); }
+    void bind(const LocalDecl* local, const Origins& origins) {
+        sources_[local].insert(origins.begin(), origins.end());
+        retain(origins);
+    }
+    void retain(const Origins& origins) { retained_.insert(origins.begin(), origins.end()); }
+    Origins unknown_if(const Type* type) const { return may_point(type) ? Origins{Origin()} : Origins(); }
+    static bool may_point(const Type* type);
+    static uint64_t num_scalars(const Type* type);
+    /// Does the value of @p expr have a static size small enough for a @c ~ allocation in the stack frame?
+    static bool fits_frame(const Expr* expr);
+
+    /// The state of the owned locals at a point of the program.
+    struct Flow {
+        thorin::GIDSet<const LocalDecl*> moved; ///< The owned locals which may have been moved.
+        bool diverged = true;                   ///< Is this point unreachable - after a @c return for instance?
+    };
+
+    Flow flow() const { return {moved_, diverged_}; }
+    void restore(const Flow& flow) { moved_ = flow.moved; diverged_ = flow.diverged; }
+    /// Control flow from @p src joins @p dst.
+    static void join(Flow& dst, const Flow& src);
+    void join(const Flow& src) {
+        auto dst = flow();
+        join(dst, src);
+        restore(dst);
+    }
+
+    /// The roots of the raw @p origins - @c Value%s of @p LocalDecl%s are replaced by what they are bound to.
+    Origins resolve(const Origins& origins) const;
+    void resolve(Origin origin, Origins& roots, thorin::GIDSet<const ASTNode*>& done) const;
+    struct Arg {
+        const Expr* expr;
+        Origins origins;
+    };
+
+    /// A call of a function of this program; whatever escapes within the callee escapes at the call as well.
+    struct Call {
+        const FnDecl* callee;
+        std::vector<Arg> args;
+    };
+
+    const Fn* cur_fn_ = nullptr;
+    std::vector<Call> calls_;
+    Origins escapes_;
+    thorin::GIDMap<const LocalDecl*, Origins> sources_;
+    std::unordered_map<const Fn*, thorin::GIDSet<const LocalDecl*>> captures_; ///< Locals of outer functions by function.
+
+    thorin::GIDSet<const LocalDecl*> moved_;
+    bool diverged_ = false;
+    thorin::GIDMap<const LocalDecl*, Flow> exits_;          ///< The joined @p Flow%s of all jumps to a continuation.
+    thorin::GIDMap<const LocalDecl*, const PathExpr*> moves_; ///< The last move of each owned local ever moved.
+    thorin::GIDSet<const LocalDecl*> assigned_;
+    std::vector<const LocalDecl*> declared_;
+    std::vector<std::pair<const LocalDecl*, const Expr*>> owned_; ///< All owned locals with their initializer.
+    Origins retained_; ///< Bound to a local or passed to a call whose result may point to any of its arguments.
+};
+
+//------------------------------------------------------------------------------
+
+bool BorrowSema::may_point(const Type* type) {
+    type = unpack_ref_type(type);
+    if (type->isa<PtrType>() || type->isa<FnType>() || type->isa<Lambda>() || type->isa<Var>())
+        return true;
+    for (auto op : type->ops()) {
+        if (op != nullptr && may_point(op))
+            return true;
+    }
+    return false;
+}
+
+uint64_t BorrowSema::num_scalars(const Type* type) {
+    if (auto array = type->isa<DefiniteArrayType>())
+        return array->dim() * num_scalars(array->elem_type());
+    if (auto simd = type->isa<SimdType>())
+        return simd->dim();
+    if (type->isa<PtrType>() || type->num_ops() == 0)
+        return 1;
+    uint64_t result = 0;
+    for (auto op : type->ops())
+        result += num_scalars(op);
+    return result;
+}
+
+bool BorrowSema::fits_frame(const Expr* expr) {
+    auto type = expr->type();
+    if (auto array = expr->isa<IndefiniteArrayExpr>()) {
+        auto dim = array->dim()->isa<LiteralExpr>();
+        auto elem_type = type->as<IndefiniteArrayType>()->elem_type();
+        return dim != nullptr && elem_type->is_monomorphic() && dim->get_u64() * num_scalars(elem_type) <= max_frame_scalars;
+    }
+    return type->is_monomorphic() && !type->isa<IndefiniteArrayType>() && num_scalars(type) <= max_frame_scalars;
+}
+
+void BorrowSema::join(Flow& dst, const Flow& src) {
+    if (src.diverged)
+        return;
+    if (dst.diverged)
+        dst = src;
+    else
+        dst.moved.insert(src.moved.begin(), src.moved.end());
+}
+
+Origins BorrowSema::use(const PathExpr* path, Access access) {
+    auto decl = path->value_decl();
+    if (auto local = decl ? decl->isa<LocalDecl>() : nullptr) {
+        // a local of an outer function is captured by all functions in between
+        if (local->fn() != cur_fn_ && cur_fn_ != nullptr)
+            captures_[cur_fn_].emplace(local);
+
+        if (access != Access::Write && local->type()->isa<OwnedPtrType>()) {
+            if (moved_.contains(local)) {
+                error(path, "use of moved value '{}'", local->symbol());
+                moved_.erase(local); // report it only once
+            }
+            if (access == Access::Move) {
+                if (local->fn() != cur_fn_) {
+                    error(path, "cannot move captured variable '{}' out of a closure", local->symbol());
+                } else {
+                    moved_.emplace(local);
+                    moves_[local] = path;
+                }
+            }
+        }
+        return may_point(local->type()) ? Origins{Origin(Origin::Value, local)} : Origins();
+    }
+    if (decl != nullptr && decl->isa<FnDecl>())
+        return Origins();
+    return unknown_if(path->type());
+}
+
+Origins BorrowSema::borrow(const Expr* expr) {
+    if (auto path = expr->isa<PathExpr>())
+        return use(path);
+    if (auto rvalue = expr->isa<RValueExpr>()) {
+        if (auto path = rvalue->src()->isa<PathExpr>())
+            return use(path);
+    }
+    return visit(expr);
+}
+
+Origins BorrowSema::place(const Expr* expr) {
+    if (auto path = expr->isa<PathExpr>()) {
+        auto decl = path->value_decl();
+        if (auto local = decl ? decl->isa<LocalDecl>() : nullptr) {
+            use(path);
+            return {Origin(Origin::Addr, local)};
+        }
+        return {Origin()};
+    }
+    if (auto prefix = expr->isa<PrefixExpr>()) {
+        if (prefix->tag() == PrefixExpr::MUL)
+            return borrow(prefix->rhs());
+    }
+    if (auto field = expr->isa<FieldExpr>()) {
+        if (field->method() == nullptr)
+            return place(field->lhs());
+    }
+    if (auto map = expr->isa<MapExpr>()) {
+        if (!unpack_ref_type(map->lhs()->type())->isa<FnType>()) {
+            for (auto&& arg : map->args())
+                visit(arg.get());
+            return place(map->lhs());
+        }
+    }
+    escape(visit(expr));
+    return {Origin()};
+}
+
+Origins BorrowSema::visit(const Expr* expr) {
+    if (auto path = expr->isa<PathExpr>())
+        return use(path, Access::Move);
+
+    if (auto rvalue = expr->isa<RValueExpr>()) {
+        if (auto path = rvalue->src()->isa<PathExpr>())
+            return use(path, Access::Move);
+        place(rvalue->src()); // loads from memory
+        return unknown_if(expr->type());
+    }
+
+    if (auto cast = expr->isa<CastExpr>())
+        return cast->type()->isa<OwnedPtrType>() ? visit(cast->src()) : borrow(cast->src());
+
+    if (auto prefix = expr->isa<PrefixExpr>()) {
+        switch (prefix->tag()) {
+            case PrefixExpr::AND:
+            case PrefixExpr::MUT:
+                return place(prefix->rhs());
+            case PrefixExpr::TILDE:
+                escape(visit(prefix->rhs()));
+                return {Origin(Origin::Fresh, prefix)};
+            case PrefixExpr::MUL:
+                borrow(prefix->rhs());
+                return unknown_if(expr->type());
+            case PrefixExpr::RUN:
+            case PrefixExpr::RUNRUN:
+            case PrefixExpr::HLT:
+                return visit(prefix->rhs());
+            case PrefixExpr::INC:
+            case PrefixExpr::DEC:
+                place(prefix->rhs());
+                return Origins();
+            default:
+                visit(prefix->rhs());
+                return Origins();
+        }
+    }
+
+    if (auto infix = expr->isa<InfixExpr>()) {
+        if (infix->tag() == InfixExpr::ASGN) {
+            auto origins = visit(infix->rhs());
+            auto path = infix->lhs()->isa<PathExpr>();
+            auto local = path && path->value_decl() ? path->value_decl()->isa<LocalDecl>() : nullptr;
+            if (local != nullptr) {
+                // the assignment initializes a moved local anew
+                bind(local, origins);
+                use(path, Access::Write);
+                assigned_.emplace(local);
+                if (local->fn() == cur_fn_)
+                    moved_.erase(local);
+            } else {
+                escape(origins); // stored into memory
+                place(infix->lhs());
+            }
+        } else if (infix->tag() == InfixExpr::ANDAND || infix->tag() == InfixExpr::OROR) {
+            borrow(infix->lhs());
+            auto lhs_flow = flow();
+            borrow(infix->rhs());
+            auto rhs_flow = flow();
+            restore(lhs_flow);
+            join(rhs_flow);
+        } else {
+            borrow(infix->lhs());
+            borrow(infix->rhs());
+        }
+        return Origins();
+    }
+
+    if (auto postfix = expr->isa<PostfixExpr>()) {
+        place(postfix->lhs());
+        return Origins();
+    }
+
+    if (auto field = expr->isa<FieldExpr>()) {
+        // a field of a struct value carries whatever the struct carries
+        auto origins = visit(field->lhs());
+        if (field->method() != nullptr) {
+            escape(origins);
+            return unknown_if(expr->type());
+        }
+        return may_point(expr->type()) ? origins : Origins();
+    }
+
+    if (auto map = expr->isa<MapExpr>()) {
+        auto field = map->lhs()->isa<FieldExpr>();
+        if (unpack_ref_type(map->lhs()->type())->isa<FnType>() || (field && field->method()))
+            return call(map);
+        for (auto&& arg : map->args())
+            visit(arg.get());
+        auto origins = visit(map->lhs());
+        return may_point(expr->type()) ? origins : Origins();
+    }
+
+    if (auto slice = expr->isa<SliceExpr>()) {
+        // a slice points into its array like '&' or '&mut'
+        visit(slice->lo());
+        visit(slice->hi());
+        return place(slice->lhs());
+    }
+
+    if (auto for_expr = expr->isa<ForExpr>()) {
+        call(for_expr->expr()->as<MapExpr>(), for_expr->fn_expr());
+        return Origins();
+    }
+
+    if (auto fn_expr = expr->isa<FnExpr>()) {
+        check_fn(fn_expr);
+        // the closure carries all variables it captures
+        Origins origins;
+        for (auto local : captures_[fn_expr]) {
+            origins.emplace(Origin::Addr, local);
+            if (may_point(local->type()))
+                origins.emplace(Origin::Value, local);
+        }
+        return origins;
+    }
+
+    if (auto type_app = expr->isa<TypeAppExpr>())
+        return visit(type_app->lhs());
+
+    if (auto block = expr->isa<BlockExpr>()) {
+        for (auto&& stmt : block->stmts())
+            visit(stmt.get());
+        return visit(block->expr());
+    }
+
+    if (auto if_expr = expr->isa<IfExpr>()) {
+        visit(if_expr->cond());
+        auto entry = flow();
+        auto origins = visit(if_expr->then_expr());
+        auto then_flow = flow();
+        restore(entry);
+        auto else_origins = visit(if_expr->else_expr());
+        join(then_flow);
+        origins.insert(else_origins.begin(), else_origins.end());
+        return origins;
+    }
+
+    if (auto match = expr->isa<MatchExpr>()) {
+        // variables bound by patterns are not tracked
+        escape(visit(match->expr()));
+        auto entry = flow();
+        Flow exit;
+        Origins origins;
+        for (auto&& arm : match->arms()) {
+            restore(entry);
+            auto arm_origins = visit(arm->expr());
+            origins.insert(arm_origins.begin(), arm_origins.end());
+            join(exit, flow());
+        }
+        restore(exit);
+        return origins;
+    }
+
+    if (auto while_expr = expr->isa<WhileExpr>()) {
+        visit(while_expr->cond());
+        auto entry = flow();
+        auto mark = declared_.size();
+        visit(while_expr->body());
+        join(exits_[while_expr->continue_decl()]);
+
+        // whatever the body moves must be assigned anew before the next iteration
+        if (!diverged_) {
+            for (auto local : moved_) {
+                if (!entry.moved.contains(local) && std::find(declared_.begin() + mark, declared_.end(), local) == declared_.end())
+                    error(moves_[local], "'{}' is moved again in the next iteration of this loop", local->symbol());
+            }
+        }
+
+        auto body_flow = flow();
+        restore(entry);
+        join(body_flow);
+        join(exits_[while_expr->break_decl()]);
+        return Origins();
+    }
+
+    // aggregates: their elements are not tracked
+    auto escape_args = [&] (const Args* args) {
+        for (auto&& arg : args->args())
+            escape(visit(arg.get()));
+        return Origins();
+    };
+    if (auto tuple = expr->isa<TupleExpr>())
+        return escape_args(tuple);
+    if (auto array = expr->isa<DefiniteArrayExpr>())
+        return escape_args(array);
+    if (auto simd = expr->isa<SimdExpr>())
+        return escape_args(simd);
+    if (auto struct_expr = expr->isa<StructExpr>()) {
+        for (auto&& elem : struct_expr->elems())
+            escape(visit(elem->expr()));
+        return Origins();
+    }
+    if (auto repeated = expr->isa<RepeatedDefiniteArrayExpr>()) {
+        escape(visit(repeated->value()));
+        return Origins();
+    }
+    if (auto array = expr->isa<IndefiniteArrayExpr>()) {
+        visit(array->dim());
+        return Origins();
+    }
+
+    // literals and EmptyExpr
+    return Origins();
+}
+
+Origins BorrowSema::call(const MapExpr* map, const FnExpr* body) {
+    std::vector<Arg> args;
+    const FnDecl* callee = nullptr;
+    const LocalDecl* target = nullptr; // a continuation like return or break
+
+    auto lhs = map->lhs();
+    while (true) {
+        if (auto type_app = lhs->isa<TypeAppExpr>())
+            lhs = type_app->lhs();
+        else if (auto prefix = lhs->isa<PrefixExpr>()) {
+            if (prefix->tag() != PrefixExpr::RUN && prefix->tag() != PrefixExpr::RUNRUN && prefix->tag() != PrefixExpr::HLT)
+                break;
+            lhs = prefix->rhs();
+        } else
+            break;
+    }
+
+    if (auto path = lhs->isa<PathExpr>()) {
+        auto decl = path->value_decl();
+        callee = decl ? decl->isa<FnDecl>() : nullptr;
+        target = decl ? decl->isa<LocalDecl>() : nullptr;
+        if (callee == nullptr)
+            visit(path);
+    } else if (lhs->isa<FieldExpr>() && lhs->as<FieldExpr>()->method()) {
+        // method call: the receiver is the first argument
+        auto receiver = lhs->as<FieldExpr>()->lhs();
+        args.push_back({receiver, visit(receiver)});
+    } else {
+        visit(lhs);
+    }
+
+    for (auto&& arg : map->args())
+        args.push_back({arg.get(), visit(arg.get())});
+    if (body != nullptr)
+        args.push_back({body, visit(body)});
+
+    // passing the very same variable twice
+    for (size_t j = 1, e = args.size(); j != e; ++j) {
+        auto rtype = unpack_ref_type(args[j].expr->type())->isa<PtrType>();
+        if (rtype == nullptr)
+            continue;
+        bool rmut = rtype->isa<BorrowedPtrType>() && rtype->is_mut();
+
+        for (size_t i = 0; i != j; ++i) {
+            auto ltype = unpack_ref_type(args[i].expr->type())->isa<PtrType>();
+            if (ltype == nullptr)
+                continue;
+            bool lmut = ltype->isa<BorrowedPtrType>() && ltype->is_mut();
+            if (!lmut && !rmut)
+                continue;
+
+            auto conflict = std::find_if(args[i].origins.begin(), args[i].origins.end(), [&] (Origin origin) {
+                return (origin.kind == Origin::Addr || origin.kind == Origin::Value) && args[j].origins.count(origin) != 0;
+            });
+            if (conflict != args[i].origins.end()) {
+                auto symbol = conflict->node->as<LocalDecl>()->symbol();
+                if (lmut && rmut)
+                    warning(args[j].expr, "'{}' is borrowed mutably more than once in this call", symbol);
+                else
+                    warning(args[j].expr, "'{}' is borrowed both mutably and immutably in this call", symbol);
+                break;
+            }
+        }
+    }
+
+    // the call of a for loop has no type on its own; the ForExpr yields the result
+    auto type = body != nullptr ? nullptr : map->type();
+
+    // the result may point to whatever the arguments point to
+    if (type != nullptr && may_point(type)) {
+        for (auto&& arg : args)
+            retain(arg.origins);
+    }
+
+    if (callee != nullptr && callee->body() != nullptr && callee->num_params() >= args.size()) {
+        calls_.push_back({callee, std::move(args)});
+    } else {
+        for (auto&& arg : args)
+            escape(arg.origins);
+    }
+
+    // a call which never returns
+    auto fn_type = type != nullptr ? unpack_ref_type(map->lhs()->type())->isa<FnType>() : nullptr;
+    if (fn_type != nullptr && map->num_args() == fn_type->num_params()) {
+        if (target != nullptr)
+            join(exits_[target], flow());
+        diverged_ = true;
+    }
+
+    return type != nullptr ? unknown_if(type) : Origins();
+}
+
+void BorrowSema::visit(const Stmt* stmt) {
+    if (auto expr_stmt = stmt->isa<ExprStmt>()) {
+        visit(expr_stmt->expr());
+    } else if (auto let = stmt->isa<LetStmt>()) {
+        if (let->init() != nullptr) {
+            auto origins = visit(let->init());
+            if (auto id_ptrn = let->ptrn()->isa<IdPtrn>()) {
+                auto local = id_ptrn->local();
+                bind(local, origins);
+                declared_.push_back(local);
+                moved_.erase(local);
+                if (local->type()->isa<OwnedPtrType>())
+                    owned_.emplace_back(local, let->init());
+            } else {
+                escape(origins);
+            }
+        }
+    } else if (auto item_stmt = stmt->isa<ItemStmt>()) {
+        THORIN_PUSH(cur_fn_, nullptr);
+        check(item_stmt->item());
+    } else if (auto asm_stmt = stmt->isa<AsmStmt>()) {
+        for (auto&& output : asm_stmt->outputs())
+            escape(place(output->expr()));
+        for (auto&& input : asm_stmt->inputs())
+            escape(visit(input->expr()));
+    }
+}
+
+void BorrowSema::check_fn(const Fn* fn) {
+    if (fn->body() == nullptr)
+        return;
+
+    {
+        // moves within the body don't affect the enclosing function
+        THORIN_PUSH(cur_fn_, fn);
+        auto outer = flow();
+        diverged_ = false;
+        escape(visit(fn->body()));
+        restore(outer);
+    }
+
+    // captures of a nested function are captured by the enclosing one as well
+    auto& captures = captures_[fn];
+    for (auto local : captures) {
+        if (local->fn() != cur_fn_ && cur_fn_ != nullptr)
+            captures_[cur_fn_].emplace(local);
+    }
+
+    // the callers of named nested functions are not tracked
+    if (fn->isa<FnDecl>()) {
+        for (auto local : captures) {
+            escapes_.emplace(Origin::Addr, local);
+            escapes_.emplace(Origin::Value, local);
+        }
+    }
+}
+
+void BorrowSema::check(const Item* item) {
+    if (auto module = item->isa<Module>()) {
+        for (auto&& item : module->items())
+            check(item.get());
+    } else if (auto fn_decl = item->isa<FnDecl>()) {
+        check_fn(fn_decl);
+    } else if (auto impl = item->isa<ImplItem>()) {
+        for (auto&& method : impl->methods())
+            check_fn(method.get());
+    } else if (auto trait = item->isa<TraitDecl>()) {
+        for (auto&& method : trait->methods())
+            check_fn(method.get());
+    } else if (auto static_item = item->isa<StaticItem>()) {
+        if (static_item->init() != nullptr)
+            escape(visit(static_item->init()));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void BorrowSema::resolve(Origin origin, Origins& roots, thorin::GIDSet<const ASTNode*>& done) const {
+    if (origin.kind != Origin::Value) {
+        roots.emplace(origin);
+        return;
+    }
+
+    auto local = origin.node->as<LocalDecl>();
+    if (!done.emplace(local).second)
+        return;
+    if (local->isa<Param>())
+        roots.emplace(origin);
+
+    auto i = sources_.find(local);
+    if (i != sources_.end()) {
+        for (auto source : i->second)
+            resolve(source, roots, done);
+    } else if (!local->isa<Param>()) {
+        roots.emplace(); // bound by a pattern or never initialized
+    }
+}
+
+Origins BorrowSema::resolve(const Origins& origins) const {
+    Origins roots;
+    thorin::GIDSet<const ASTNode*> done;
+    for (auto origin : origins)
+        resolve(origin, roots, done);
+    return roots;
+}
+
+void BorrowSema::solve() {
+    // whatever a parameter which escapes is bound to escapes as well
+    auto escaped = resolve(escapes_);
+    for (bool todo = true; todo;) {
+        todo = false;
+        for (auto&& call : calls_) {
+            for (size_t i = 0, e = call.args.size(); i != e; ++i) {
+                if (escaped.count(Origin(Origin::Value, call.callee->param(i))) != 0) {
+                    for (auto root : resolve(call.args[i].origins))
+                        todo |= escaped.emplace(root).second;
+                }
+            }
+        }
+    }
+
+    // an owned local which solely holds fresh memory releases it
+    // a local moved into another one is skipped while the memory of the latter still resolves to the allocation
+    for (auto&& owned : owned_) {
+        auto local = owned.first;
+        if (moves_.find(local) != moves_.end() || assigned_.contains(local) || local->is_address_taken_
+                || retained_.count(Origin(Origin::Value, local)) != 0)
+            continue;
+
+        auto roots = resolve({Origin(Origin::Value, local)});
+        bool fresh = std::all_of(roots.begin(), roots.end(), [&] (Origin root) {
+            return root.kind == Origin::Fresh && escaped.count(root) == 0;
+        });
+        if (roots.empty() || !fresh)
+            continue;
+
+        // the allocation may belong to the initializer of a local which has been moved into this one
+        auto prefix = roots.size() == 1 ? roots.begin()->node->as<PrefixExpr>() : nullptr;
+        if (prefix != nullptr && fits_frame(prefix->rhs()))
+            prefix->in_frame_ = true;
+        else
+            local->released_ = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void borrow_check(const Module* module) {
+    BorrowSema sema;
+    sema.check(module);
+    sema.solve();
+}
+
+//------------------------------------------------------------------------------
+
+}
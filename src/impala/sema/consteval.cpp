@@ -0,0 +1,919 @@
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "impala/ast.h"
+#include "impala/impala.h"
+#include "impala/sema/consteval.h"
+
+namespace impala {
+
+using thorin::Box;
+using thorin::half;
+
+//------------------------------------------------------------------------------
+
+/*
+ * The constant evaluator interprets the AST directly.
+ * Values carry their primitive type, so evaluation works before type inference is done - which array dimensions need.
+ * Local variables live in Frames; a closure keeps the Frame it was created in alive.
+ * Continuations - return, break and continue - are values as well: calling one throws a Jump to the activation it
+ * belongs to. Calls in tail position reuse the activation of the caller, so loops written as recursive functions like
+ * the ones for-expressions iterate over don't exhaust the stack.
+ */
+
+/// At most this many expressions are evaluated for a single constant.
+static const size_t max_steps = 10000000;
+/// At most this many calls may be active at once - calls in tail position don't count.
+static const size_t max_depth = 256;
+
+struct Frame;
+
+/// A value during evaluation - besides the data of a @p ConstValue also closures and continuations.
+struct Val {
+    enum Kind { Prim, Agg, Closure, Cont };
+
+    Kind kind = Agg;
+    PrimTypeTag tag = PrimType_bool;
+    Box box;
+    std::vector<Val> elems;
+    const Fn* fn = nullptr;
+    const FnDecl* fn_decl = nullptr; ///< @p fn if it is a top-level function - which a constant may refer to.
+    std::shared_ptr<Frame> frame;    ///< Where the body of the closure @p fn looks up the variables it captures.
+    size_t cont = 0;              ///< The activation this continuation belongs to.
+};
+
+struct Frame {
+    Frame(std::shared_ptr<Frame> parent)
+        : parent(std::move(parent))
+    {}
+
+    std::shared_ptr<Frame> parent;
+    std::unordered_map<const LocalDecl*, Val> locals;
+};
+
+/// Thrown by calling a continuation; caught by the activation @p cont belongs to.
+struct Jump {
+    size_t cont;
+    Val val;
+};
+
+/// Thrown if something is no compile-time constant.
+struct NotConst {
+    const ASTNode* node;
+    std::string msg;
+    bool unrepresentable = false;
+};
+
+/// @p symbol in quotes for a message.
+static std::string quote(Symbol symbol) { return "'" + std::string(symbol.str()) + "'"; }
+
+[[noreturn]] static void not_const(const ASTNode* node, std::string msg) { throw NotConst{node, std::move(msg)}; }
+
+/*
+ * primitive values
+ */
+
+static bool is_float(PrimTypeTag tag) { return tag == PrimType_f16 || tag == PrimType_f32 || tag == PrimType_f64; }
+
+static bool is_signed(PrimTypeTag tag) {
+    return tag == PrimType_i8 || tag == PrimType_i16 || tag == PrimType_i32 || tag == PrimType_i64;
+}
+
+static uint64_t num_bits(PrimTypeTag tag) {
+    switch (tag) {
+        case PrimType_bool:                   return 1;
+        case PrimType_i8:  case PrimType_u8:  return 8;
+        case PrimType_i16: case PrimType_u16: case PrimType_f16: return 16;
+        case PrimType_i32: case PrimType_u32: case PrimType_f32: return 32;
+        case PrimType_i64: case PrimType_u64: case PrimType_f64: return 64;
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+/// The integer or bool @p box of type @p tag sign- or zero-extended to 64 bits.
+static uint64_t get_int(PrimTypeTag tag, Box box) {
+    switch (tag) {
+        case PrimType_bool: return box.get_bool();
+        case PrimType_i8:   return uint64_t(int64_t(box.get_s8()));
+        case PrimType_i16:  return uint64_t(int64_t(box.get_s16()));
+        case PrimType_i32:  return uint64_t(int64_t(box.get_s32()));
+        case PrimType_i64:  return uint64_t(box.get_s64());
+        case PrimType_u8:   return box.get_u8();
+        case PrimType_u16:  return box.get_u16();
+        case PrimType_u32:  return box.get_u32();
+        case PrimType_u64:  return box.get_u64();
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+static double get_float(PrimTypeTag tag, Box box) {
+    switch (tag) {
+        case PrimType_f16: return float(box.get_f16());
+        case PrimType_f32: return box.get_f32();
+        case PrimType_f64: return box.get_f64();
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+/// @p bits truncated to the integer or bool type @p tag.
+static Box int_box(PrimTypeTag tag, uint64_t bits) {
+    switch (tag) {
+        case PrimType_bool: return Box((bits & 1) != 0);
+        case PrimType_i8:   return Box( int8_t(bits));
+        case PrimType_i16:  return Box(int16_t(bits));
+        case PrimType_i32:  return Box(int32_t(bits));
+        case PrimType_i64:  return Box(int64_t(bits));
+        case PrimType_u8:   return Box( uint8_t(bits));
+        case PrimType_u16:  return Box(uint16_t(bits));
+        case PrimType_u32:  return Box(uint32_t(bits));
+        case PrimType_u64:  return Box(uint64_t(bits));
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+static Box float_box(PrimTypeTag tag, double d) {
+    switch (tag) {
+        case PrimType_f16: return Box(half(float(d)));
+        case PrimType_f32: return Box(float(d));
+        case PrimType_f64: return Box(d);
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+static Val prim(PrimTypeTag tag, Box box) {
+    Val val;
+    val.kind = Val::Prim;
+    val.tag = tag;
+    val.box = box;
+    return val;
+}
+
+static Val int_val(PrimTypeTag tag, uint64_t bits) { return prim(tag, int_box(tag, bits)); }
+static Val float_val(PrimTypeTag tag, double d) { return prim(tag, float_box(tag, d)); }
+static Val bool_val(bool b) { return prim(PrimType_bool, Box(b)); }
+static Val one(PrimTypeTag tag) { return is_float(tag) ? float_val(tag, 1.0) : int_val(tag, 1); }
+
+static Val agg(std::vector<Val>&& elems) {
+    Val val;
+    val.elems = std::move(elems);
+    return val;
+}
+
+static Val unit() { return agg({}); }
+
+static Val cont_val(size_t cont) {
+    Val val;
+    val.kind = Val::Cont;
+    val.cont = cont;
+    return val;
+}
+
+static Val closure(const Fn* fn, std::shared_ptr<Frame> frame) {
+    Val val;
+    val.kind = Val::Closure;
+    val.fn = fn;
+    val.frame = std::move(frame);
+    return val;
+}
+
+/// @p val converted to the primitive type @p to like a cast does.
+static Val convert(const Val& val, PrimTypeTag to) {
+    auto from = val.tag;
+    if (is_float(from)) {
+        auto d = get_float(from, val.box);
+        if (is_float(to))      return float_val(to, d);
+        if (to == PrimType_bool) return bool_val(d != 0.0);
+        return int_val(to, is_signed(to) || d < 0.0 ? uint64_t(int64_t(d)) : uint64_t(d));
+    }
+
+    auto bits = get_int(from, val.box);
+    if (is_float(to))
+        return float_val(to, is_signed(from) ? double(int64_t(bits)) : double(bits));
+    return int_val(to, bits);
+}
+
+static PrimTypeTag prim_tag(const PrimASTType* prim) {
+    switch (prim->tag()) {
+#define IMPALA_TYPE(itype, atype) case PrimASTType::TYPE_##itype: return PrimType_##itype;
+#include "impala/tokenlist.h"
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+static Val from_const(const ConstValue& value) {
+    if (value.is_prim())
+        return prim(value.tag(), value.box());
+    if (auto fn_decl = value.fn_decl()) {
+        auto val = closure(fn_decl, nullptr);
+        val.fn_decl = fn_decl;
+        return val;
+    }
+    std::vector<Val> elems;
+    for (auto&& elem : value.elems())
+        elems.push_back(from_const(elem));
+    return agg(std::move(elems));
+}
+
+static ConstValue to_const(const ASTNode* node, const Val& val) {
+    switch (val.kind) {
+        case Val::Prim: return ConstValue(val.tag, val.box);
+        case Val::Agg: {
+            std::vector<ConstValue> elems;
+            for (auto&& elem : val.elems)
+                elems.push_back(to_const(node, elem));
+            return ConstValue(std::move(elems));
+        }
+        case Val::Closure:
+            if (val.fn_decl != nullptr && val.fn_decl->num_ast_type_params() == 0)
+                return ConstValue(val.fn_decl);
+            not_const(node, "only functions which are not polymorphic can be part of a constant");
+        default: not_const(node, "continuations cannot be part of a constant");
+    }
+}
+
+//------------------------------------------------------------------------------
+
+class ConstEval {
+public:
+    ConstEval()
+        : frame_(std::make_shared<Frame>(nullptr))
+    {}
+
+    Val eval(const Expr* expr, bool tail = false);
+
+private:
+    Val eval_path(const PathExpr* path);
+    Val eval_prefix(const PrefixExpr* prefix);
+    Val eval_infix(const InfixExpr* infix);
+    Val eval_cast(const CastExpr* cast);
+    Val eval_map(const MapExpr* map, bool tail);
+    Val eval_block(const BlockExpr* block, bool tail);
+    Val eval_match(const MatchExpr* match, bool tail);
+    Val eval_while(const WhileExpr* loop);
+    Val eval_for(const ForExpr* loop);
+    void exec(const Stmt* stmt);
+
+    /// Binary operator @p op of the primitive values @p a and @p b.
+    Val binop(const ASTNode* node, Token::Tag op, const Val& a, const Val& b);
+    bool truth(const Expr* cond);
+    uint64_t index(const Expr* expr, const Val& agg);
+    Val zero(const ASTNode* node, const Type* type);
+
+    /**
+     * The storage of @p expr if it names a local variable, an immutable static or a part of these.
+     * Returns @c nullptr - without evaluating anything - if @p expr is none of these; fails if @p required is set.
+     */
+    Val* place(const Expr* expr, bool required);
+    Val* lookup(const LocalDecl* local);
+    Val* static_value(const ASTNode* node, const StaticItem* static_item);
+    void bind(const Ptrn* ptrn, Val&& val);
+    bool match(const Ptrn* ptrn, const Val& val);
+
+    /**
+     * Calls @p callee with @p args.
+     * A function which takes a return continuation gets @p ret - or a fresh one if @c 0.
+     */
+    Val call(const ASTNode* node, Val callee, std::vector<Val>&& args, size_t ret = 0);
+
+    /// Fails at @p node which is constant but cannot be represented - see @p ConstEvalError::unrepresentable.
+    [[noreturn]] void unrepresentable(const ASTNode* node, std::string msg) const {
+        throw NotConst{node, std::move(msg), data_};
+    }
+
+    struct TailCall {
+        const ASTNode* node;
+        Val callee;
+        std::vector<Val> args;
+    };
+
+    std::shared_ptr<Frame> frame_;
+    std::optional<TailCall> tail_call_; ///< Set by a call in tail position instead of calling.
+    std::unordered_map<const StaticItem*, Val> statics_;
+    std::unordered_set<const StaticItem*> evaluating_;
+    size_t num_steps_ = 0;
+    size_t depth_ = 0;
+    size_t num_conts_ = 0;
+    bool data_ = true; ///< Does only data lead from the evaluated expression up to the root?
+};
+
+/// Does @p expr merely build data from its operands - without calls, which includes constructors of enum variants?
+static bool is_data(const Expr* expr) {
+    if (auto prefix = expr->isa<PrefixExpr>())
+        return prefix->tag() == PrefixExpr::AND || prefix->tag() == PrefixExpr::MUT;
+    return expr->isa<LiteralExpr>() || expr->isa<CharExpr>() || expr->isa<StrExpr>() || expr->isa<PathExpr>()
+        || expr->isa<RValueExpr>() || expr->isa<CastExpr>() || expr->isa<FieldExpr>() || expr->isa<TypeAppExpr>()
+        || expr->isa<DefiniteArrayExpr>() || expr->isa<RepeatedDefiniteArrayExpr>() || expr->isa<TupleExpr>()
+        || expr->isa<SimdExpr>() || expr->isa<StructExpr>();
+}
+
+Val ConstEval::eval(const Expr* expr, bool tail) {
+    if (++num_steps_ > max_steps)
+        not_const(expr, "evaluation exceeds " + std::to_string(max_steps) + " steps");
+    THORIN_PUSH(data_, data_ && is_data(expr));
+
+    if (expr->isa<EmptyExpr>())
+        return unit();
+    if (auto literal = expr->isa<LiteralExpr>())
+        return prim(literal->literal2type(), literal->box());
+    if (auto chr = expr->isa<CharExpr>())
+        return int_val(PrimType_u8, uint8_t(chr->value()));
+    if (auto str = expr->isa<StrExpr>()) {
+        std::vector<Val> elems;
+        for (auto c : str->values())
+            elems.push_back(int_val(PrimType_u8, uint8_t(c)));
+        return agg(std::move(elems));
+    }
+    if (auto path = expr->isa<PathExpr>())
+        return eval_path(path);
+    if (auto prefix = expr->isa<PrefixExpr>())
+        return eval_prefix(prefix);
+    if (auto infix = expr->isa<InfixExpr>())
+        return eval_infix(infix);
+    if (auto postfix = expr->isa<PostfixExpr>()) {
+        auto var = place(postfix->lhs(), true);
+        auto old = *var;
+        *var = binop(postfix, postfix->tag() == PostfixExpr::INC ? Token::ADD : Token::SUB, old, one(old.tag));
+        return old;
+    }
+    if (auto rvalue = expr->isa<RValueExpr>())
+        return eval(rvalue->src());
+    if (auto cast = expr->isa<CastExpr>())
+        return eval_cast(cast);
+    if (auto field = expr->isa<FieldExpr>()) {
+        if (field->method() != nullptr || field->field_decl() == nullptr)
+            not_const(field, quote(field->symbol()) + " does not name a field of a constant");
+        if (auto var = place(field, false))
+            return *var;
+        auto lhs = eval(field->lhs());
+        if (lhs.kind != Val::Agg || field->index() >= lhs.elems.size())
+            not_const(field, quote(field->symbol()) + " does not name a field of a constant");
+        return std::move(lhs.elems[field->index()]);
+    }
+    if (auto array = expr->isa<DefiniteArrayExpr>()) {
+        std::vector<Val> elems;
+        for (auto&& arg : array->args())
+            elems.push_back(eval(arg.get()));
+        return agg(std::move(elems));
+    }
+    if (auto array = expr->isa<RepeatedDefiniteArrayExpr>())
+        return agg(std::vector<Val>(array->count(), eval(array->value())));
+    if (auto tuple = expr->isa<TupleExpr>()) {
+        std::vector<Val> elems;
+        for (auto&& arg : tuple->args())
+            elems.push_back(eval(arg.get()));
+        return agg(std::move(elems));
+    }
+    if (auto simd = expr->isa<SimdExpr>()) {
+        std::vector<Val> elems;
+        for (auto&& arg : simd->args())
+            elems.push_back(eval(arg.get()));
+        return agg(std::move(elems));
+    }
+    if (auto struct_expr = expr->isa<StructExpr>()) {
+        std::vector<Val> elems(struct_expr->num_elems());
+        for (auto&& elem : struct_expr->elems()) {
+            if (elem->field_decl() == nullptr || elem->field_decl()->index() >= elems.size())
+                not_const(elem.get(), "unknown field " + quote(elem->symbol()));
+            elems[elem->field_decl()->index()] = eval(elem->expr());
+        }
+        return agg(std::move(elems));
+    }
+    if (auto type_app = expr->isa<TypeAppExpr>())
+        return eval(type_app->lhs()); // values don't depend on type arguments
+    if (auto fn_expr = expr->isa<FnExpr>())
+        return closure(fn_expr, frame_);
+    if (auto map = expr->isa<MapExpr>())
+        return eval_map(map, tail);
+    if (auto block = expr->isa<BlockExpr>())
+        return eval_block(block, tail);
+    if (auto if_expr = expr->isa<IfExpr>())
+        return truth(if_expr->cond()) ? eval(if_expr->then_expr(), tail) : eval(if_expr->else_expr(), tail);
+    if (auto match = expr->isa<MatchExpr>())
+        return eval_match(match, tail);
+    if (auto loop = expr->isa<WhileExpr>())
+        return eval_while(loop);
+    if (auto loop = expr->isa<ForExpr>())
+        return eval_for(loop);
+
+    not_const(expr, "expression is not a compile-time constant");
+}
+
+Val ConstEval::eval_path(const PathExpr* path) {
+    auto decl = path->value_decl();
+    if (decl == nullptr)
+        not_const(path, "expression is not a compile-time constant");
+    if (auto local = decl->isa<LocalDecl>()) {
+        if (auto var = lookup(local))
+            return *var;
+        not_const(path, "variable " + quote(local->symbol()) + " is not known at compile time");
+    }
+    if (auto static_item = decl->isa<StaticItem>())
+        return *static_value(path, static_item);
+    if (auto fn_decl = decl->isa<FnDecl>()) {
+        auto val = closure(fn_decl, nullptr);
+        val.fn_decl = fn_decl;
+        return val;
+    }
+    if (auto option_decl = decl->isa<OptionDecl>()) {
+        if (option_decl->num_args() == 0)
+            unrepresentable(path, "enum variants are not supported in constants");
+        not_const(path, "enum variants are not supported in constants");
+    }
+    not_const(path, quote(decl->symbol()) + " is not a compile-time constant");
+}
+
+Val ConstEval::eval_prefix(const PrefixExpr* prefix) {
+    switch (prefix->tag()) {
+        case PrefixExpr::ADD:
+        case PrefixExpr::RUN:
+        case PrefixExpr::RUNRUN:
+        case PrefixExpr::HLT:
+            return eval(prefix->rhs()); // partial evaluation annotations are meaningless for a constant
+        case PrefixExpr::KNOWN:
+            eval(prefix->rhs());
+            return bool_val(true);
+        case PrefixExpr::SUB: {
+            auto val = eval(prefix->rhs());
+            if (is_float(val.tag))
+                return float_val(val.tag, -get_float(val.tag, val.box));
+            return int_val(val.tag, uint64_t(0) - get_int(val.tag, val.box));
+        }
+        case PrefixExpr::NOT: {
+            auto val = eval(prefix->rhs());
+            return int_val(val.tag, ~get_int(val.tag, val.box));
+        }
+        case PrefixExpr::INC:
+        case PrefixExpr::DEC: {
+            auto var = place(prefix->rhs(), true);
+            *var = binop(prefix, prefix->tag() == PrefixExpr::INC ? Token::ADD : Token::SUB, *var, one(var->tag));
+            return *var;
+        }
+        case PrefixExpr::AND:
+        case PrefixExpr::MUT:
+            unrepresentable(prefix, "pointers are not supported in constants");
+        default:
+            not_const(prefix, "pointers are not supported in constants");
+    }
+}
+
+Val ConstEval::eval_infix(const InfixExpr* infix) {
+    auto op = Token::Tag(infix->tag());
+    switch (op) {
+        case Token::ANDAND: return bool_val(truth(infix->lhs()) && truth(infix->rhs()));
+        case Token::OROR:   return bool_val(truth(infix->lhs()) || truth(infix->rhs()));
+        default: break;
+    }
+
+    if (Token::is_assign(op)) {
+        auto val = eval(infix->rhs());
+        auto var = place(infix->lhs(), true);
+        *var = op == Token::ASGN ? std::move(val) : binop(infix, Token::separate_assign(op), *var, val);
+        return unit();
+    }
+
+    auto a = eval(infix->lhs());
+    auto b = eval(infix->rhs());
+    if (a.kind != Val::Prim || b.kind != Val::Prim)
+        not_const(infix, "operands of a constant operator must be primitive values");
+    return binop(infix, op, a, b);
+}
+
+Val ConstEval::binop(const ASTNode* node, Token::Tag op, const Val& a, const Val& b) {
+    auto tag = a.tag;
+    if (is_float(tag)) {
+        auto x = get_float(tag, a.box), y = get_float(tag, b.box);
+        switch (op) {
+            case Token::ADD: return float_val(tag, x + y);
+            case Token::SUB: return float_val(tag, x - y);
+            case Token::MUL: return float_val(tag, x * y);
+            case Token::DIV: return float_val(tag, x / y);
+            case Token::REM: return float_val(tag, std::fmod(x, y));
+            case Token::EQ:  return bool_val(x == y);
+            case Token::NE:  return bool_val(x != y);
+            case Token::LT:  return bool_val(x <  y);
+            case Token::LE:  return bool_val(x <= y);
+            case Token::GT:  return bool_val(x >  y);
+            case Token::GE:  return bool_val(x >= y);
+            default: not_const(node, "invalid operator for floating-point constants");
+        }
+    }
+
+    auto x = get_int(tag, a.box), y = get_int(tag, b.box);
+    auto sx = int64_t(x), sy = int64_t(y);
+    bool s = is_signed(tag);
+    switch (op) {
+        case Token::ADD: return int_val(tag, x + y);
+        case Token::SUB: return int_val(tag, x - y);
+        case Token::MUL: return int_val(tag, x * y);
+        case Token::DIV:
+        case Token::REM:
+            if (y == 0)
+                not_const(node, "division by zero");
+            if (s && sy == -1) // avoids the overflow of the smallest value divided by -1
+                return int_val(tag, op == Token::DIV ? uint64_t(0) - x : 0);
+            if (op == Token::DIV)
+                return int_val(tag, s ? uint64_t(sx / sy) : x / y);
+            return int_val(tag, s ? uint64_t(sx % sy) : x % y);
+        case Token::AND: return int_val(tag, x & y);
+        case Token::OR:  return int_val(tag, x | y);
+        case Token::XOR: return int_val(tag, x ^ y);
+        case Token::SHL:
+        case Token::SHR:
+            if (y >= num_bits(tag))
+                not_const(node, "shift amount " + (s ? std::to_string(sy) : std::to_string(y)) + " is out of range");
+            if (op == Token::SHL)
+                return int_val(tag, x << y);
+            return int_val(tag, s ? uint64_t(sx >> y) : x >> y);
+        case Token::EQ: return bool_val(x == y);
+        case Token::NE: return bool_val(x != y);
+        case Token::LT: return bool_val(s ? sx <  sy : x <  y);
+        case Token::LE: return bool_val(s ? sx <= sy : x <= y);
+        case Token::GT: return bool_val(s ? sx >  sy : x >  y);
+        case Token::GE: return bool_val(s ? sx >= sy : x >= y);
+        default: not_const(node, "invalid operator for constants");
+    }
+}
+
+Val ConstEval::eval_cast(const CastExpr* cast) {
+    auto val = eval(cast->src());
+    const Type* type = cast->type();
+    if (auto explicit_cast = cast->isa<ExplicitCastExpr>()) {
+        // the target is known before type inference is done
+        if (auto prim_ast_type = explicit_cast->ast_type()->isa<PrimASTType>())
+            return val.kind == Val::Prim ? convert(val, prim_tag(prim_ast_type)) : val;
+    }
+
+    if (type == nullptr)
+        not_const(cast, "type of cast is not known yet");
+    if (auto prim_type = type->isa<PrimType>())
+        return val.kind == Val::Prim ? convert(val, prim_type->primtype_tag()) : val;
+    if (type->isa<PtrType>() && (val.kind != Val::Prim || is_float(val.tag)))
+        not_const(cast, "pointers are not supported in constants");
+    return val; // an integer cast to a pointer keeps its value; all other casts only change the type
+}
+
+Val ConstEval::eval_map(const MapExpr* map, bool tail) {
+    // a method call passes its receiver as first argument
+    if (auto field = map->lhs()->skip_rvalue()->isa<FieldExpr>()) {
+        if (auto method = field->method()) {
+            if (auto trait_decl = method->owner()->isa<TraitDecl>()) {
+                for (auto type_arg : field->method_type_args()) {
+                    if (!type_arg->is_known() || type_arg->is_polymorphic())
+                        not_const(field, "trait method " + quote(field->symbol()) + " on a receiver of unknown type");
+                }
+                std::vector<const Type*> by_depth;
+                method = trait_decl->resolve_method(field->symbol(), field->method_type_args(), by_depth);
+                if (method == nullptr)
+                    not_const(field, "trait method " + quote(field->symbol()) + " is not implemented");
+            }
+
+            std::vector<Val> args;
+            args.push_back(eval(field->lhs()));
+            for (auto&& arg : map->args())
+                args.push_back(eval(arg.get()));
+            if (tail) {
+                tail_call_ = TailCall{map, closure(method, nullptr), std::move(args)};
+                return unit();
+            }
+            return call(map, closure(method, nullptr), std::move(args));
+        }
+    }
+
+    if (auto var = place(map, false))
+        return *var;
+
+    auto lhs = eval(map->lhs());
+    if (lhs.kind == Val::Agg)
+        return std::move(lhs.elems[index(map->arg(0), lhs)]);
+
+    std::vector<Val> args;
+    for (auto&& arg : map->args())
+        args.push_back(eval(arg.get()));
+    if (tail && lhs.kind == Val::Closure) {
+        tail_call_ = TailCall{map, std::move(lhs), std::move(args)};
+        return unit();
+    }
+    return call(map, std::move(lhs), std::move(args));
+}
+
+Val ConstEval::call(const ASTNode* node, Val callee, std::vector<Val>&& args, size_t ret) {
+    if (callee.kind == Val::Cont)
+        throw Jump{callee.cont, args.size() == 1 ? std::move(args.front()) : agg(std::move(args))};
+    if (callee.kind != Val::Closure)
+        not_const(node, "callee is not a function");
+
+    THORIN_PUSH(depth_, depth_ + 1);
+    if (depth_ > max_depth)
+        not_const(node, "evaluation exceeds the maximum call depth of " + std::to_string(max_depth));
+
+    while (true) {
+        auto fn = callee.fn;
+        if (fn->body() == nullptr)
+            not_const(node, "function " + quote(fn->fn_symbol()) + " has no body to evaluate");
+        if (fn->num_params() != args.size() && fn->num_params() != args.size() + 1)
+            not_const(node, "wrong number of arguments");
+
+        auto frame = std::make_shared<Frame>(callee.frame);
+        for (size_t i = 0, e = args.size(); i != e; ++i)
+            frame->locals[fn->param(i)] = std::move(args[i]);
+        // the continuation this activation returns through - a tail call keeps the one of its caller
+        auto cont = ret;
+        if (fn->num_params() == args.size() + 1) {
+            if (cont == 0)
+                cont = ++num_conts_;
+            frame->locals[fn->param(args.size())] = cont_val(cont);
+        }
+
+        THORIN_PUSH(frame_, frame);
+        Val result;
+        try {
+            result = eval(fn->body(), /*tail*/ true);
+        } catch (Jump& jump) {
+            if (cont == 0 || jump.cont != cont)
+                throw;
+            tail_call_.reset();
+            return std::move(jump.val);
+        }
+
+        if (!tail_call_)
+            return result;
+
+        // the body ends with a call which returns to where this activation returns to
+        node   = tail_call_->node;
+        callee = std::move(tail_call_->callee);
+        args   = std::move(tail_call_->args);
+        ret    = cont;
+        tail_call_.reset();
+    }
+}
+
+Val ConstEval::eval_block(const BlockExpr* block, bool tail) {
+    for (auto&& stmt : block->stmts())
+        exec(stmt.get());
+    return eval(block->expr(), tail);
+}
+
+void ConstEval::exec(const Stmt* stmt) {
+    if (auto expr_stmt = stmt->isa<ExprStmt>()) {
+        eval(expr_stmt->expr());
+    } else if (auto let = stmt->isa<LetStmt>()) {
+        bind(let->ptrn(), let->init() ? eval(let->init()) : zero(let, let->ptrn()->type()));
+    } else if (!stmt->isa<ItemStmt>()) { // nested items are evaluated on demand
+        not_const(stmt, "statement is not allowed in a constant");
+    }
+}
+
+Val ConstEval::eval_match(const MatchExpr* match, bool tail) {
+    auto val = eval(match->expr());
+    for (auto&& arm : match->arms()) {
+        if (this->match(arm->ptrn(), val))
+            return eval(arm->expr(), tail);
+    }
+    not_const(match, "no arm matches");
+}
+
+Val ConstEval::eval_while(const WhileExpr* loop) {
+    auto brk = ++num_conts_, cnt = ++num_conts_;
+    frame_->locals[loop->break_decl()] = cont_val(brk);
+    frame_->locals[loop->continue_decl()] = cont_val(cnt);
+    try {
+        while (truth(loop->cond())) {
+            try {
+                eval(loop->body());
+            } catch (Jump& jump) {
+                if (jump.cont != cnt)
+                    throw;
+            }
+        }
+    } catch (Jump& jump) {
+        if (jump.cont != brk)
+            throw;
+    }
+    return unit();
+}
+
+Val ConstEval::eval_for(const ForExpr* loop) {
+    auto map = loop->expr()->isa<MapExpr>();
+    if (map == nullptr)
+        not_const(loop, "expression is not a compile-time constant");
+
+    auto brk = ++num_conts_;
+    frame_->locals[loop->break_decl()] = cont_val(brk);
+    std::vector<Val> args;
+    for (auto&& arg : map->args())
+        args.push_back(eval(arg.get()));
+    args.push_back(closure(loop->fn_expr(), frame_));
+    auto callee = eval(map->lhs());
+
+    try {
+        return call(map, std::move(callee), std::move(args), brk);
+    } catch (Jump& jump) {
+        if (jump.cont != brk)
+            throw;
+        return std::move(jump.val);
+    }
+}
+
+bool ConstEval::truth(const Expr* cond) {
+    auto val = eval(cond);
+    if (val.kind != Val::Prim || val.tag != PrimType_bool)
+        not_const(cond, "condition is not a boolean constant");
+    return val.box.get_bool();
+}
+
+uint64_t ConstEval::index(const Expr* expr, const Val& agg) {
+    auto val = eval(expr);
+    if (val.kind != Val::Prim || is_float(val.tag) || val.tag == PrimType_bool)
+        not_const(expr, "index is not an integer constant");
+    auto i = get_int(val.tag, val.box);
+    if (i >= agg.elems.size()) {
+        auto str = is_signed(val.tag) ? std::to_string(int64_t(i)) : std::to_string(i);
+        not_const(expr, "index " + str + " is out of bounds for " + std::to_string(agg.elems.size()) + " elements");
+    }
+    return i;
+}
+
+Val ConstEval::zero(const ASTNode* node, const Type* type) {
+    if (type != nullptr) {
+        if (auto prim_type = type->isa<PrimType>()) {
+            auto tag = prim_type->primtype_tag();
+            return is_float(tag) ? float_val(tag, 0.0) : int_val(tag, 0);
+        }
+        if (auto array_type = type->isa<DefiniteArrayType>())
+            return agg(std::vector<Val>(array_type->dim(), zero(node, array_type->elem_type())));
+        if (auto simd_type = type->isa<SimdType>())
+            return agg(std::vector<Val>(simd_type->dim(), zero(node, simd_type->elem_type())));
+        if (type->isa<TupleType>() || type->isa<StructType>()) {
+            std::vector<Val> elems;
+            for (auto op : type->ops())
+                elems.push_back(zero(node, op));
+            return agg(std::move(elems));
+        }
+    }
+    not_const(node, "variable of this type must be initialized in a constant");
+}
+
+Val* ConstEval::place(const Expr* expr, bool required) {
+    if (auto rvalue = expr->isa<RValueExpr>())
+        return place(rvalue->src(), required);
+
+    if (auto path = expr->isa<PathExpr>()) {
+        auto decl = path->value_decl();
+        if (auto local = decl ? decl->isa<LocalDecl>() : nullptr) {
+            if (auto var = lookup(local))
+                return var;
+            not_const(path, "variable " + quote(local->symbol()) + " is not known at compile time");
+        }
+        if (auto static_item = decl ? decl->isa<StaticItem>() : nullptr) {
+            if (!required)
+                return static_value(path, static_item);
+        }
+    } else if (auto map = expr->isa<MapExpr>()) {
+        auto lhs = place(map->lhs(), required);
+        if (lhs != nullptr && lhs->kind == Val::Agg)
+            return &lhs->elems[index(map->arg(0), *lhs)];
+    } else if (auto field = expr->isa<FieldExpr>()) {
+        if (field->method() == nullptr && field->field_decl() != nullptr) {
+            auto lhs = place(field->lhs(), required);
+            if (lhs != nullptr && lhs->kind == Val::Agg && field->index() < lhs->elems.size())
+                return &lhs->elems[field->index()];
+        }
+    }
+
+    if (required)
+        not_const(expr, "cannot assign to this expression in a constant");
+    return nullptr;
+}
+
+Val* ConstEval::lookup(const LocalDecl* local) {
+    for (auto frame = frame_.get(); frame != nullptr; frame = frame->parent.get()) {
+        auto i = frame->locals.find(local);
+        if (i != frame->locals.end())
+            return &i->second;
+    }
+    return nullptr;
+}
+
+Val* ConstEval::static_value(const ASTNode* node, const StaticItem* static_item) {
+    auto name = quote(static_item->symbol());
+    if (static_item->is_mut())
+        not_const(node, "mutable static " + name + " is not a compile-time constant");
+
+    auto i = statics_.find(static_item);
+    if (i != statics_.end())
+        return &i->second;
+
+    if (auto value = static_item->value())
+        return &(statics_[static_item] = from_const(*value));
+    if (static_item->init() == nullptr)
+        not_const(node, "static " + name + " has no initializer");
+    if (!evaluating_.emplace(static_item).second)
+        not_const(node, "static " + name + " depends on itself");
+
+    Val val;
+    {
+        THORIN_PUSH(frame_, std::make_shared<Frame>(nullptr));
+        val = eval(static_item->init());
+    }
+    evaluating_.erase(static_item);
+    return &(statics_[static_item] = std::move(val));
+}
+
+void ConstEval::bind(const Ptrn* ptrn, Val&& val) {
+    if (auto id = ptrn->isa<IdPtrn>()) {
+        frame_->locals[id->local()] = std::move(val);
+    } else if (auto tuple = ptrn->isa<TuplePtrn>()) {
+        if (val.kind != Val::Agg || val.elems.size() != tuple->elems().size())
+            not_const(tuple, "pattern does not match");
+        for (size_t i = 0, e = val.elems.size(); i != e; ++i)
+            bind(tuple->elem(i), std::move(val.elems[i]));
+    } else {
+        not_const(ptrn, "pattern is not supported in constants");
+    }
+}
+
+bool ConstEval::match(const Ptrn* ptrn, const Val& val) {
+    if (auto id = ptrn->isa<IdPtrn>()) {
+        frame_->locals[id->local()] = val;
+        return true;
+    }
+    if (auto tuple = ptrn->isa<TuplePtrn>()) {
+        if (val.kind != Val::Agg || val.elems.size() != tuple->elems().size())
+            not_const(tuple, "pattern does not match");
+        for (size_t i = 0, e = val.elems.size(); i != e; ++i) {
+            if (!match(tuple->elem(i), val.elems[i]))
+                return false;
+        }
+        return true;
+    }
+    if (auto literal = ptrn->isa<LiteralPtrn>()) {
+        auto lit = eval(literal->literal());
+        if (literal->has_minus())
+            lit = is_float(lit.tag) ? float_val(lit.tag, -get_float(lit.tag, lit.box)) : int_val(lit.tag, uint64_t(0) - get_int(lit.tag, lit.box));
+        return binop(literal, Token::EQ, val, lit).box.get_bool();
+    }
+    if (auto chr = ptrn->isa<CharPtrn>())
+        return binop(chr, Token::EQ, val, eval(chr->chr())).box.get_bool();
+    if (auto range = ptrn->isa<RangePtrn>()) {
+        auto bound = [&] (const Ptrn* bound) {
+            if (auto chr = bound->isa<CharPtrn>())
+                return eval(chr->chr());
+            auto literal = bound->as<LiteralPtrn>();
+            auto lit = eval(literal->literal());
+            return literal->has_minus() ? int_val(lit.tag, uint64_t(0) - get_int(lit.tag, lit.box)) : lit;
+        };
+        return binop(range, Token::LE, bound(range->lo()), val).box.get_bool()
+            && binop(range, Token::LE, val, bound(range->hi())).box.get_bool();
+    }
+    if (auto alts = ptrn->isa<OrPtrn>()) {
+        for (auto&& alt : alts->alts()) {
+            if (match(alt.get(), val))
+                return true;
+        }
+        return false;
+    }
+    not_const(ptrn, "pattern is not supported in constants");
+}
+
+//------------------------------------------------------------------------------
+
+std::optional<ConstValue> const_eval(const Expr* expr, ConstEvalError* error) {
+    try {
+        ConstEval eval;
+        return to_const(expr, eval.eval(expr));
+    } catch (NotConst& not_const) {
+        if (error != nullptr) {
+            error->node = not_const.node;
+            error->msg = std::move(not_const.msg);
+            error->unrepresentable = not_const.unrepresentable;
+        }
+    } catch (Jump&) {
+        if (error != nullptr) {
+            error->node = expr;
+            error->msg = "continuation leaves the constant";
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> const_dim(const Expr* dim, ConstEvalError* error) {
+    auto value = const_eval(dim, error);
+    if (!value)
+        return std::nullopt;
+    if (value->is_prim() && !is_float(value->tag()) && value->tag() != PrimType_bool) {
+        auto bits = get_int(value->tag(), value->box());
+        if (!is_signed(value->tag()) || int64_t(bits) >= 0)
+            return bits;
+    }
+    if (error != nullptr) {
+        error->node = dim;
+        error->msg = "expected a non-negative integer";
+    }
+    return std::nullopt;
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,81 @@
+#ifndef IMPALA_SEMA_CONSTEVAL_H
+#define IMPALA_SEMA_CONSTEVAL_H
+
+#include <cassert>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "thorin/util/types.h"
+
+#include "impala/sema/type.h"
+
+namespace impala {
+
+class ASTNode;
+class Expr;
+class FnDecl;
+
+/**
+ * A value computed at compile time: a primitive, a function or an aggregate - array, tuple, struct or simd vector -
+ * of such values.
+ */
+class ConstValue {
+public:
+    /// The unit value - an aggregate without elements.
+    ConstValue() {}
+    ConstValue(PrimTypeTag tag, thorin::Box box)
+        : tag_(tag)
+        , box_(box)
+        , prim_(true)
+    {}
+    explicit ConstValue(std::vector<ConstValue>&& elems)
+        : elems_(std::move(elems))
+    {}
+    /// A monomorphic function.
+    explicit ConstValue(const FnDecl* fn_decl)
+        : fn_decl_(fn_decl)
+    {}
+
+    bool is_prim() const { return prim_; }
+    PrimTypeTag tag() const { assert(is_prim()); return tag_; }
+    thorin::Box box() const { assert(is_prim()); return box_; }
+    const FnDecl* fn_decl() const { return fn_decl_; }
+    const std::vector<ConstValue>& elems() const { assert(!is_prim()); return elems_; }
+    const ConstValue& elem(size_t i) const { return elems()[i]; }
+    size_t num_elems() const { return elems().size(); }
+
+private:
+    PrimTypeTag tag_ = PrimType_bool;
+    thorin::Box box_;
+    std::vector<ConstValue> elems_;
+    const FnDecl* fn_decl_ = nullptr;
+    bool prim_ = false;
+};
+
+/// Why @p const_eval failed.
+struct ConstEvalError {
+    const ASTNode* node = nullptr; ///< The node whose evaluation failed.
+    std::string msg;
+    /**
+     * The expression is built from data alone - aggregates, casts, enum variants without arguments and addresses - but a
+     * part of it, like such an enum variant or an address, cannot be represented by a @p ConstValue.
+     * Such an expression may still be emitted as initializer of a global.
+     */
+    bool unrepresentable = false;
+};
+
+/**
+ * Evaluates @p expr at compile time.
+ * Besides literals and operators this runs calls of functions with a body, loops, closures and local variables;
+ * immutable statics are evaluated on demand.
+ * Returns @c std::nullopt and - if given - fills in @p error if @p expr is no compile-time constant.
+ */
+std::optional<ConstValue> const_eval(const Expr* expr, ConstEvalError* error = nullptr);
+
+/// Evaluates the dimension @p dim of an array type which must be a non-negative integer.
+std::optional<uint64_t> const_dim(const Expr* dim, ConstEvalError* error = nullptr);
+
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <limits>
 #include <memory>
 
 #include "thorin/util/array.h"
@@ -33,6 +34,13 @@ public:
     const Type* find_type(const Type*& type);
     const Type* find_type(const Typeable* node) { return find_type(node->type_); }
 
+    /// Creates a fresh @p UnknownType the current @p Item depends on.
+    const UnknownType* unknown_type() {
+        auto type = TypeTable::unknown_type();
+        read(type);
+        return type;
+    }
+
     /**
      * @c unify(t, u).
      * Initializes @p t with @p UnknownType if @p type is @c nullptr.
@@ -48,31 +56,44 @@ public:
 
     // infer wrappers
 
+    /**
+     * Infers the top-level @p items of a @p Module.
+     * All @p items are inferred once; afterwards only those which read a type that has changed in the meantime are
+     * inferred again until nothing changes anymore.
+     */
+    void infer(const Items& items);
+
     const Type* infer(const LocalDecl* local) {
+        ++stats_.num_node_visits;
         auto type = local->infer(*this);
         constrain(local, type);
         return type;
     }
-    const Type* infer(const Ptrn* p) { return constrain(p, p->infer(*this)); }
-    const Type* infer(const FieldDecl* f) { return constrain(f, f->infer(*this)); }
-    const Type* infer(const OptionDecl* o) { return constrain(o, o->infer(*this)); }
-    void infer(const Item* n) { n->infer(*this); }
+    const Type* infer(const Ptrn* p) { ++stats_.num_node_visits; return constrain(p, p->infer(*this)); }
+    const Type* infer(const FieldDecl* f) { ++stats_.num_node_visits; return constrain(f, f->infer(*this)); }
+    const Type* infer(const OptionDecl* o) { ++stats_.num_node_visits; return constrain(o, o->infer(*this)); }
+    void infer(const Item* n) { ++stats_.num_node_visits; n->infer(*this); }
     const Type* infer_head(const Item* n) {
         return (n->type_ == nullptr || n->type_->isa<UnknownType>()) ? n->type_ = n->infer_head(*this) : n->type_;
     }
-    void infer(const Stmt* n) { n->infer(*this); }
-    const Type* infer(const Expr* expr) { return constrain(expr, expr->infer(*this)); }
-    const Type* infer(const Expr* expr, const Type* t) { return constrain(expr, expr->infer(*this), t); }
-    const Type* infer(const Path* path) { return constrain(path, path->infer(*this)); }
-    const Type* infer(const Path* path, const Type* t) { return constrain(path, path->infer(*this), t); }
+    void infer(const Stmt* n) { ++stats_.num_node_visits; n->infer(*this); }
+    const Type* infer(const Expr* expr) { ++stats_.num_node_visits; return constrain(expr, expr->infer(*this)); }
+    const Type* infer(const Expr* expr, const Type* t) { ++stats_.num_node_visits; return constrain(expr, expr->infer(*this), t); }
+    const Type* infer(const Path* path) { ++stats_.num_node_visits; return constrain(path, path->infer(*this)); }
+    const Type* infer(const Path* path, const Type* t) { ++stats_.num_node_visits; return constrain(path, path->infer(*this), t); }
 
     const Var* infer(const ASTTypeParam* ast_type_param) {
         if (!ast_type_param->type())
             ast_type_param->type_ = ast_type_param->infer(*this);
+        auto depth = size_t(ast_type_param->lambda_depth());
+        if (type_params_.size() < depth)
+            type_params_.resize(depth);
+        type_params_[depth-1] = ast_type_param;
         return ast_type_param->type()->as<Var>();
     }
 
     const Type* infer(const ASTType* ast_type) {
+        ++stats_.num_node_visits;
         return constrain(ast_type, ast_type->infer(*this));
     }
 
@@ -87,7 +108,7 @@ public:
     const Type* rvalue(const Expr* expr) {
         auto type = infer(expr);
         if (type->isa<RefType>() || (type->isa<UnknownType>() && !expr->isa<RValueExpr>())) {
-            todo_ = true;
+            todo();
             return infer(RValueExpr::create(expr));
         }
         return type;
@@ -97,42 +118,81 @@ public:
         return ref ? ref_type(type, ref->is_mut(), ref->addr_space()) : type;
     }
 
+    // methods
+
+    void add_impl(const ImplItem* impl) { impls_.push_back(impl); }
+
+    /**
+     * Looks up the method @p field names on a @p receiver of the given type and records it in @p field.
+     * Returns the type of the method without its @c self parameter or @c nullptr if there is no such method.
+     */
+    const Type* infer_method(const FieldExpr* field, const Type* receiver);
+
+    /**
+     * Searches @p trait_decl and its super traits for the method @p symbol.
+     * @p trait_args are the implementing type followed by the type arguments of @p trait_decl.
+     */
+    const FnDecl* find_trait_method(const TraitDecl* trait_decl, Types trait_args, Symbol symbol,
+                                    std::vector<const Type*>& method_type_args, GIDSet<const TraitDecl*>& done);
+
+    const InferStats& stats() const { return stats_; }
+
 private:
-    /// Used for union/find - see https://en.wikipedia.org/wiki/Disjoint-set_data_structure#Disjoint-set_forests .
+    /**
+     * Used for union/find - see https://en.wikipedia.org/wiki/Disjoint-set_data_structure#Disjoint-set_forests .
+     * All @p Representative%s live in one vector and are addressed by the gid of their @p Type relative to
+     * @p first_gid() - parent links are indices into this vector.
+     */
     struct Representative {
-        Representative() {}
-        Representative(const Type* type)
-            : parent(this)
-            , type(type)
-        {}
-
-        bool is_root() const { return parent != nullptr; }
+        const Type* type = nullptr; ///< @c nullptr if there is no @p Type with this index (yet).
+        uint32_t parent = 0;
+        uint32_t rank = 0;
+    };
 
-        Representative* parent = nullptr;
-        const Type* type = nullptr;
-        int rank = 0;
+    /// Top-level @p Item%s which depend on a @p Representative; kept apart to keep the union-find compact.
+    struct Readers {
+        std::vector<size_t> items;
+        size_t last = size_t(-1);
     };
 
-    Representative* representative(const Type* type);
-    Representative* find(Representative* repr);
+    uint32_t representative(const Type* type);
+    uint32_t find(uint32_t repr);
     const Type* find(const Type* type);
+    const Type* type(uint32_t repr) const { return representatives_[repr].type; }
 
     /**
      * @p x will be the new representative.
      * Returns again @p x.
      */
-    Representative* unify(Representative* x, Representative* y);
+    uint32_t unify(uint32_t x, uint32_t y);
 
     /**
      * Depending on the rank either @p x or @p y will be the new representative.
      * Returns the new representative.
      */
-    Representative* unify_by_rank(Representative* x, Representative* y);
+    uint32_t unify_by_rank(uint32_t x, uint32_t y);
+
+    /// Makes @p x the parent of @p y and schedules all readers of @p y for re-inference.
+    uint32_t link(uint32_t x, uint32_t y);
 
-    TypeMap<std::unique_ptr<Representative>> representatives_;
-    bool todo_ = true;
+    /// Records that the current @p Item depends on all @p UnknownType%s in @p type.
+    void read(const Type* type);
 
-    friend void type_inference(std::unique_ptr<TypeTable>& typetable, const Module*);
+    /// The current @p Item must be inferred again.
+    void todo() {
+        if (cur_item_ != no_item)
+            todo_[cur_item_] = true;
+    }
+
+    static constexpr size_t no_item = size_t(-1);
+
+    std::vector<Representative> representatives_;
+    std::vector<Readers> readers_;
+    std::vector<bool> todo_; ///< Which top-level @p Item%s must be inferred (again)?
+    size_t cur_item_ = no_item;
+    std::vector<const ImplItem*> impls_;
+    std::vector<const ASTTypeParam*> type_params_; ///< The @p ASTTypeParam%s in scope by depth.
+    InferStats stats_;
 };
 
 //------------------------------------------------------------------------------
@@ -150,12 +210,7 @@ const Type* InferSema::reduce(const Lambda* lambda, ASTTypeArgs ast_type_args, s
         while (type_args.size() < num)
             type_args.push_back(unknown_type());
 
-        size_t i = type_args.size();
-        const Type* type = lambda;
-        while (auto lambda = type->isa<Lambda>())
-            type = app(lambda, type_args[--i]);
-
-        return type;
+        return instantiate(lambda, type_args);
     }
 
     return type_error();
@@ -229,20 +284,22 @@ void InferSema::assign(const Expr* dst, const Expr* src) {
 }
 
 const Type* InferSema::unify(const Type* dst, const Type* src) {
+    read(dst);
+    read(src);
     auto dst_repr = find(representative(dst));
     auto src_repr = find(representative(src));
 
-    dst = dst_repr->type;
-    src = src_repr->type;
+    dst = type(dst_repr);
+    src = type(src_repr);
 
     // normalize singleton tuples to their element
     if (src->isa<TupleType>() && src->num_ops() == 1) src = src->op(0);
     if (dst->isa<TupleType>() && dst->num_ops() == 1) dst = dst->op(0);
 
     if (dst->isa<UnknownType>() && src->isa<UnknownType>())
-        return unify_by_rank(dst_repr, src_repr)->type;
-    if (dst->isa<UnknownType>()) return unify(src_repr, dst_repr)->type;
-    if (src->isa<UnknownType>()) return unify(dst_repr, src_repr)->type;
+        return type(unify_by_rank(dst_repr, src_repr));
+    if (dst->isa<UnknownType>()) return type(unify(src_repr, dst_repr));
+    if (src->isa<UnknownType>()) return type(unify(dst_repr, src_repr));
 
     if (dst == src && dst->is_known()) return dst;
     if (dst->isa<TypeError>() || dst->isa<InferError>()) return dst; // propagate errors
@@ -283,66 +340,153 @@ const Type* InferSema::unify(const Type* dst, const Type* src) {
  * union-find
  */
 
-auto InferSema::representative(const Type* type) -> Representative* {
-    auto i = representatives_.find(type);
-    if (i == representatives_.end()) {
-        auto p = representatives_.emplace(type, std::make_unique<Representative>(type));
-        assert_unused(p.second);
-        i = p.first;
+uint32_t InferSema::representative(const Type* type) {
+    assert(type->gid() >= first_gid() && "type from another table");
+    auto i = type->gid() - first_gid();
+    assert(i < std::numeric_limits<uint32_t>::max());
+
+    if (i >= representatives_.size()) {
+        auto size = std::max(i + 1, 2 * representatives_.size());
+        representatives_.resize(size);
+        readers_.resize(size);
+    }
+
+    auto& repr = representatives_[i];
+    if (repr.type == nullptr) {
+        repr.type = type;
+        repr.parent = uint32_t(i);
     }
-    return &*i->second;
+    return uint32_t(i);
 }
 
-auto InferSema::find(Representative* repr) -> Representative* {
-    if (repr->parent != repr) {
-        todo_ = true;
-        repr->parent = find(repr->parent);
+uint32_t InferSema::find(uint32_t repr) {
+    auto root = repr;
+    while (representatives_[root].parent != root)
+        root = representatives_[root].parent;
+
+    if (root != repr) {
+        todo();
+        // path compression
+        while (repr != root) {
+            auto next = representatives_[repr].parent;
+            representatives_[repr].parent = root;
+            repr = next;
+        }
     }
-    return repr->parent;
+    return root;
 }
 
 const Type* InferSema::find(const Type* type) {
-    return find(representative(type))->type;
+    auto result = this->type(find(representative(type)));
+    read(result);
+    return result;
 }
 
-auto InferSema::unify(Representative* x, Representative* y) -> Representative* {
-    assert(x->is_root() && y->is_root());
+uint32_t InferSema::unify(uint32_t x, uint32_t y) {
+    assert(representatives_[x].parent == x && representatives_[y].parent == y);
 
     if (x == y)
         return x;
-    ++x->rank;
-    todo_ = true;
-    return y->parent = x;
+    ++representatives_[x].rank;
+    todo();
+    return link(x, y);
 }
 
-auto InferSema::unify_by_rank(Representative* x, Representative* y) -> Representative* {
-    assert(x->is_root() && y->is_root());
+uint32_t InferSema::unify_by_rank(uint32_t x, uint32_t y) {
+    assert(representatives_[x].parent == x && representatives_[y].parent == y);
 
     if (x == y)
         return x;
-    if (x->rank < y->rank)
-        return x->parent = y;
-    else if (x->rank > y->rank)
-        return y->parent = x;
+    auto& x_rank = representatives_[x].rank;
+    auto& y_rank = representatives_[y].rank;
+    if (x_rank < y_rank)
+        return link(y, x);
+    else if (x_rank > y_rank)
+        return link(x, y);
     else {
-        ++x->rank;
-        return y->parent = x;
+        ++x_rank;
+        return link(x, y);
+    }
+}
+
+uint32_t InferSema::link(uint32_t x, uint32_t y) {
+    // everyone who has seen y must pick up its new representative
+    auto& x_readers = readers_[x].items;
+    auto& y_readers = readers_[y].items;
+    for (auto reader : y_readers)
+        todo_[reader] = true;
+    x_readers.insert(x_readers.end(), y_readers.begin(), y_readers.end());
+    y_readers.clear();
+    y_readers.shrink_to_fit();
+    representatives_[y].parent = x;
+    return x;
+}
+
+void InferSema::read(const Type* type) {
+    if (cur_item_ == no_item || type->is_known())
+        return;
+
+    if (type->isa<UnknownType>()) {
+        // do not compress paths here - this would count as progress
+        auto repr = representative(type);
+        while (representatives_[repr].parent != repr)
+            repr = representatives_[repr].parent;
+
+        auto& readers = readers_[repr];
+        if (readers.last == cur_item_)
+            return; // also stops at cyclic types
+        readers.last = cur_item_;
+        readers.items.push_back(cur_item_);
+        if (this->type(repr) != type)
+            read(this->type(repr));
+    } else {
+        for (auto op : type->ops())
+            read(op);
     }
 }
 
 //------------------------------------------------------------------------------
 
-void type_inference(std::unique_ptr<TypeTable>& typetable, const Module* module) {
-    auto sema = new InferSema;
-    typetable.reset(sema);
+void InferSema::infer(const Items& items) {
+    todo_.resize(items.size());
+    for (size_t i = 0, e = items.size(); i != e; ++i)
+        todo_[i] = !items[i]->is_lazy();
+
+    std::vector<size_t> worklist;
+    while (true) {
+        worklist.clear();
+        for (size_t i = 0, e = items.size(); i != e; ++i) {
+            if (todo_[i]) {
+                todo_[i] = false;
+                worklist.push_back(i);
+            }
+        }
+
+        if (worklist.empty())
+            break;
+
+        ++stats_.num_rounds;
+        for (auto i : worklist) {
+            cur_item_ = i;
+            infer_head(items[i].get());
+        }
 
-    int i = 0;
-    for (;sema->todo_; ++i) {
-        sema->todo_ = false;
-        sema->infer(module);
+        for (auto i : worklist) {
+            cur_item_ = i;
+            ++stats_.num_item_visits;
+            infer(items[i].get());
+        }
+        cur_item_ = no_item;
     }
+}
 
-    //DLOG("iterations needed for type inference: {}", i);
+void type_inference(std::unique_ptr<TypeTable>& typetable, const Module* module) {
+    auto sema = new InferSema;
+    typetable.reset(sema);
+    sema->infer(module);
+    infer_stats() = sema->stats();
+    infer_stats().num_instantiations = sema->num_instantiations();
+    infer_stats().num_instantiation_hits = sema->num_instantiation_hits();
 }
 
 //------------------------------------------------------------------------------
@@ -423,9 +567,19 @@ const Type* PtrASTType::infer(InferSema& sema) const {
 }
 
 const Type* IndefiniteArrayASTType::infer(InferSema& sema) const { return sema.indefinite_array_type(sema.infer(elem_ast_type())); }
-const Type* DefiniteArrayASTType::infer(InferSema& sema) const { return sema.definite_array_type(sema.infer(elem_ast_type()), dim()); }
+const Type* SliceASTType::infer(InferSema& sema) const { return sema.slice_type(sema.infer(elem_ast_type())); }
 const Type* SimdASTType::infer(InferSema& sema) const { return sema.simd_type(sema.infer(elem_ast_type()), size()); }
 
+const Type* DefiniteArrayASTType::infer(InferSema& sema) const {
+    auto elem_type = sema.infer(elem_ast_type());
+    sema.rvalue(dim());
+    // literals know their types, so most dimensions are known right away; type checking reports the others
+    if (auto dim = const_dim(this->dim()))
+        return sema.definite_array_type(elem_type, *dim);
+    // a fresh unknown in each round would count as progress
+    return type() ? type() : sema.unknown_type();
+}
+
 const Type* TupleASTType::infer(InferSema& sema) const {
     Array<const Type*> types(num_ast_type_args());
     for (size_t i = 0, e = num_ast_type_args(); i != e; ++i)
@@ -452,6 +606,12 @@ const Type* ASTTypeApp::infer(InferSema& sema) const {
     if (decl() && decl()->is_type_decl()) {
         if (auto ast_type_param = decl()->isa<ASTTypeParam>())
             return sema.var(ast_type_param->lambda_depth_);
+        if (auto trait_decl = decl()->isa<TraitDecl>()) {
+            // a trait is not a type - only its arguments are of interest
+            type_args_.resize(trait_decl->num_ast_type_params());
+            sema.fill_type_args(type_args_, ast_type_args_);
+            return sema.type_error();
+        }
         auto type = sema.find_type(decl());
         if (auto lambda = type->isa<Lambda>())
             return sema.reduce(lambda, ast_type_args(), type_args_);
@@ -506,8 +666,28 @@ const Type* FnDecl::infer_head(InferSema& sema) const {
     return sema.close(num_ast_type_params(), sema.fn_type(param_types));
 }
 
-const Type* TraitDecl::infer_head(InferSema&) const { /*TODO*/ return nullptr; }
-const Type* ImplItem::infer_head(InferSema&) const { /*TODO*/ return nullptr; }
+const Type* TraitDecl::infer_head(InferSema& sema) const {
+    sema.infer(self_param());
+    infer_ast_type_params(sema);
+    for (auto&& super_trait : super_traits())
+        sema.infer(super_trait.get());
+    for (auto&& method : methods())
+        sema.infer_head(method.get());
+    return nullptr;
+}
+
+const Type* ImplItem::infer_head(InferSema& sema) const {
+    if (type() == nullptr)
+        sema.add_impl(this);
+
+    infer_ast_type_params(sema);
+    if (trait())
+        sema.infer(trait());
+    auto self_type = sema.infer(ast_type());
+    for (auto&& method : methods())
+        sema.infer_head(method.get());
+    return self_type;
+}
 
 /*
  * Item::infer
@@ -516,13 +696,7 @@ const Type* ImplItem::infer_head(InferSema&) const { /*TODO*/ return nullptr; }
 void ModuleDecl::infer(InferSema&) const {
 }
 
-void Module::infer(InferSema& sema) const {
-    for (auto&& item : items())
-        sema.infer_head(item.get());
-
-    for (auto&& item : items())
-        sema.infer(item.get());
-}
+void Module::infer(InferSema& sema) const { sema.infer(items()); }
 
 void ExternBlock::infer(InferSema& sema) const {
     for (auto&& fn_decl : fn_decls())
@@ -599,8 +773,21 @@ void StaticItem::infer(InferSema& sema) const {
         sema.constrain(this, sema.rvalue(init()));
 }
 
-void TraitDecl::infer(InferSema& /*sema*/) const {}
-void ImplItem::infer(InferSema& /*sema*/) const {}
+void TraitDecl::infer(InferSema& sema) const {
+    sema.infer(self_param());
+    infer_ast_type_params(sema);
+    for (auto&& method : methods())
+        sema.infer(method.get());
+}
+
+void ImplItem::infer(InferSema& sema) const {
+    infer_ast_type_params(sema);
+    if (trait())
+        sema.infer(trait());
+    sema.infer(ast_type());
+    for (auto&& method : methods())
+        sema.infer(method.get());
+}
 
 //------------------------------------------------------------------------------
 
@@ -878,13 +1065,143 @@ const Type* FieldExpr::infer(InferSema& sema) const {
 
     auto ref = split_ref_type(ltype);
 
+    if (ltype->isa<SliceType>() && symbol() == "len")
+        return sema.type_i32();
+
     if (auto struct_type = ltype->isa<StructType>()) {
         if (auto field_decl = struct_type->struct_decl()->field_decl(symbol())) {
             return sema.wrap_ref(ref, struct_type->op((*field_decl)->index()));
         }
     }
 
-    return ltype->is_known() ? sema.type_error() : sema.find_type(this);
+    if (ltype->is_known()) {
+        auto method_type = sema.infer_method(this, ltype);
+        return method_type ? method_type : sema.type_error();
+    }
+
+    return sema.find_type(this);
+}
+
+const FnDecl* InferSema::find_trait_method(const TraitDecl* trait_decl, Types trait_args, Symbol symbol,
+                                           std::vector<const Type*>& method_type_args, GIDSet<const TraitDecl*>& done) {
+    if (!done.emplace(trait_decl).second)
+        return nullptr; // also stops at cyclic super traits
+
+    if (auto method = trait_decl->find_method(symbol)) {
+        method_type_args.assign(trait_args.begin(), trait_args.end());
+        return method;
+    }
+
+    // the type arguments of a super trait refer to the type parameters of trait_decl
+    std::vector<const Type*> by_depth;
+    trait_decl->trait_args_by_depth(trait_args, by_depth);
+    for (auto&& super_trait : trait_decl->super_traits()) {
+        if (auto super_decl = super_trait->decl() ? super_trait->decl()->isa<TraitDecl>() : nullptr) {
+            std::vector<const Type*> super_args(1, trait_args.front());
+            for (auto type_arg : super_trait->type_args())
+                super_args.push_back(substitute(find(type_arg), by_depth));
+            if (auto method = find_trait_method(super_decl, super_args, symbol, method_type_args, done))
+                return method;
+        }
+    }
+
+    return nullptr;
+}
+
+const Type* InferSema::infer_method(const FieldExpr* field, const Type* receiver) {
+    const FnDecl* method = nullptr;
+    std::vector<const Type*> method_type_args;
+
+    // several bounds or impls may provide the same trait method with different trait arguments - the call decides
+    auto candidate = [&] (const FnDecl* fn_decl, Types type_args) {
+        if (fn_decl == nullptr || (method != nullptr && method != fn_decl))
+            return;
+        if (method == nullptr) {
+            method = fn_decl;
+            method_type_args.assign(type_args.begin(), type_args.end());
+        } else {
+            for (size_t i = 1, e = method_type_args.size(); i != e; ++i) {
+                if (method_type_args[i] != type_args[i])
+                    method_type_args[i] = nullptr;
+            }
+        }
+    };
+
+    if (auto var = receiver->isa<Var>()) {
+        // the method must stem from a bound of the type parameter or - for Self - from its trait
+        auto depth = size_t(var->depth());
+        if (auto ast_type_param = depth <= type_params_.size() ? type_params_[depth-1] : nullptr) {
+            std::vector<const Type*> type_args;
+            if (auto trait_decl = ast_type_param->trait_decl()) {
+                std::vector<const Type*> trait_args(1, receiver);
+                for (auto&& trait_param : trait_decl->ast_type_params())
+                    trait_args.push_back(trait_param->type());
+                GIDSet<const TraitDecl*> done;
+                candidate(find_trait_method(trait_decl, trait_args, field->symbol(), type_args, done), type_args);
+            }
+
+            for (auto&& bound : ast_type_param->bounds()) {
+                auto type_app = bound->isa<ASTTypeApp>();
+                if (auto trait_decl = type_app && type_app->decl() ? type_app->decl()->isa<TraitDecl>() : nullptr) {
+                    std::vector<const Type*> trait_args(1, receiver);
+                    for (auto type_arg : type_app->type_args())
+                        trait_args.push_back(find(type_arg));
+                    GIDSet<const TraitDecl*> done;
+                    candidate(find_trait_method(trait_decl, trait_args, field->symbol(), type_args, done), type_args);
+                }
+            }
+        }
+    } else {
+        for (auto impl : impls_) {
+            std::vector<const Type*> impl_args;
+            if (impl->ast_type()->type() == nullptr || !match(find(impl->ast_type()->type()), receiver, impl_args))
+                continue;
+
+            // all type parameters of the impl must be determined by the receiver
+            Array<const Type*> type_args(impl->num_ast_type_params());
+            bool determined = true;
+            for (size_t i = 0, e = type_args.size(); i != e; ++i) {
+                auto depth = size_t(impl->ast_type_param(i)->lambda_depth());
+                type_args[i] = depth <= impl_args.size() ? impl_args[depth-1] : nullptr;
+                determined &= type_args[i] != nullptr;
+            }
+            if (!determined)
+                continue;
+
+            if (auto trait_decl = impl->trait_decl()) {
+                std::vector<const Type*> trait_args, method_args;
+                for (auto type : impl->trait_args())
+                    trait_args.push_back(substitute(find(type), impl_args));
+                GIDSet<const TraitDecl*> done;
+                candidate(find_trait_method(trait_decl, trait_args, field->symbol(), method_args, done), method_args);
+            } else {
+                candidate(impl->find_method(field->symbol()), type_args);
+            }
+        }
+    }
+
+    // undecided trait arguments become unknowns which are kept across iterations
+    for (size_t i = 0, e = method_type_args.size(); i != e; ++i) {
+        if (method_type_args[i] == nullptr) {
+            bool keep = field->method_ == method && i < field->method_type_args_.size();
+            method_type_args[i] = keep ? unify(field->method_type_args_[i], field->method_type_args_[i]) : unknown_type();
+        }
+    }
+
+    field->method_ = method;
+    field->method_type_args_ = method_type_args;
+    if (method == nullptr)
+        return nullptr;
+
+    // methods with type parameters of their own are not supported
+    auto method_type = field->method_type();
+    if (method_type == nullptr || method_type->num_params() == 0)
+        return type_error();
+
+    Array<const Type*> param_types(method_type->num_params() - 1);
+    for (size_t i = 0, e = param_types.size(); i != e; ++i)
+        param_types[i] = method_type->param(i+1);
+    return fn_type(param_types);
 }
 
 const Type* TypeAppExpr::infer(InferSema& sema) const {
@@ -957,6 +1274,29 @@ const Type* MapExpr::infer(InferSema& sema) const {
     return sema.type_error();
 }
 
+const Type* SliceExpr::infer(InferSema& sema) const {
+    auto ltype = sema.infer(lhs());
+    if (is_ptr(ltype)) {
+        PrefixExpr::create_deref(lhs_.get());
+        ltype = sema.infer(lhs());
+    }
+
+    auto ref = split_ref_type(ltype);
+    sema.rvalue(lo());
+    sema.rvalue(hi());
+
+    if (ltype->isa<UnknownType>())
+        return sema.find_type(this);
+
+    // a mutable place yields a mutable slice
+    if (ltype->isa<ArrayType>() && !ltype->isa<SimdType>()) {
+        auto elem_type = ltype->as<ArrayType>()->elem_type();
+        return sema.borrowed_ptr_type(sema.slice_type(elem_type), ref && ref->is_mut(), ref ? ref->addr_space() : 0);
+    }
+
+    return sema.type_error();
+}
+
 const Type* BlockExpr::infer(InferSema& sema) const {
     for (auto&& stmt : stmts()) {
         if (auto item_stmt = stmt->isa<ItemStmt>())
@@ -1071,6 +1411,20 @@ const Type* CharPtrn::infer(InferSema& sema) const {
     return sema.infer(chr());
 }
 
+const Type* RangePtrn::infer(InferSema& sema) const {
+    sema.infer(hi());
+    return sema.constrain(hi(), sema.infer(lo()));
+}
+
+const Type* OrPtrn::infer(InferSema& sema) const {
+    auto type = sema.infer(alt(0));
+    for (size_t i = 1, e = num_alts(); i != e; ++i) {
+        sema.infer(alt(i));
+        type = sema.constrain(alt(i), type);
+    }
+    return type;
+}
+
 //------------------------------------------------------------------------------
 
 /*
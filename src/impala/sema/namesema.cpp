@@ -10,6 +10,8 @@ public:
     /**
      * Looks up the current definition of \p symbol.
      * Reports an error at location of \p n if was \p symbol was not found.
+     * A function with a skipped body is queued for @p bind_lazy_bodies.
+     * A found @p Item is added to the @p Item::uses of @p cur_item_.
      * @return Returns nullptr on failure.
      */
     const Decl* lookup(const ASTNode* n, Symbol);
@@ -28,6 +30,8 @@ public:
     const Decl* clash(Symbol symbol) const;
     void push_scope() { levels_.push_back(decl_stack_.size()); } ///< Opens a new scope.
     void pop_scope();                                            ///< Discards current scope.
+    /// Parses and binds the skipped bodies of the referenced functions declared in the current scope.
+    void bind_lazy_bodies();
 
     void bind_head(const Item* item) {
         if (item->is_no_decl()) {
@@ -45,9 +49,11 @@ private:
     thorin::HashMap<Symbol, const Decl*, Symbol::Hash> symbol2decl_;
     std::vector<const Decl*> decl_stack_;
     std::vector<size_t> levels_;
+    std::vector<std::vector<const FnDecl*>> lazy_fns_; ///< Referenced functions with skipped bodies by their depth.
 
 public: // HACK
     int lambda_depth_ = 0;
+    const Item* cur_item_ = nullptr; ///< The @p Item of a @p Module that is being bound.
 };
 
 //------------------------------------------------------------------------------
@@ -57,8 +63,28 @@ const Decl* NameSema::lookup(const ASTNode* n, Symbol symbol) {
 
     if (!symbol.is_anonymous()) {
         auto decl = symbol2decl_.lookup(symbol);
-        if (!decl)
+        if (!decl) {
             error(n, "'{}' not found in current scope", symbol);
+            return nullptr;
+        }
+
+        auto item = (*decl)->isa<Item>();
+        if (item != nullptr && cur_item_ != nullptr && item != cur_item_) {
+            auto& uses = cur_item_->uses_;
+            if (uses.empty() || uses.back() != item)
+                uses.push_back(item);
+        }
+
+        if (auto fn_decl = (*decl)->isa<FnDecl>()) {
+            auto lazy_body = fn_decl->lazy_body();
+            if (lazy_body != nullptr && !lazy_body->referenced) {
+                // its body needs the scope fn_decl has been declared in - bind it when this scope is about to be closed
+                lazy_body->referenced = true;
+                if (lazy_fns_.size() <= fn_decl->depth())
+                    lazy_fns_.resize(fn_decl->depth() + 1);
+                lazy_fns_[fn_decl->depth()].push_back(fn_decl);
+            }
+        }
         return *decl;
     } else {
         error(n, "identifier '_' is reserved for anonymous declarations");
@@ -94,6 +120,17 @@ const Decl* NameSema::clash(Symbol symbol) const {
     return nullptr;
 }
 
+void NameSema::bind_lazy_bodies() {
+    // binding a body may reference further functions of this scope
+    for (auto d = depth(); d < lazy_fns_.size() && !lazy_fns_[d].empty();) {
+        auto fn_decl = lazy_fns_[d].back();
+        lazy_fns_[d].pop_back();
+        fn_decl->parse_lazy_body();
+        THORIN_PUSH(cur_item_, fn_decl);
+        fn_decl->fn_bind(*this);
+    }
+}
+
 void NameSema::pop_scope() {
     size_t level = levels_.back();
     for (size_t i = level, e = decl_stack_.size(); i != e; ++i) {
@@ -146,7 +183,8 @@ void ErrorASTType::bind(NameSema&) const {}
 void PrimASTType::bind(NameSema&) const {}
 void PtrASTType::bind(NameSema& sema) const { referenced_ast_type()->bind(sema); }
 void IndefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
-void DefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
+void DefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); dim()->bind(sema); }
+void SliceASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
 void SimdASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
 void Typeof::bind(NameSema& sema) const { expr()->bind(sema); }
 
@@ -185,8 +223,11 @@ void Module::bind(NameSema& sema) const {
         if (item->is_named_decl())
             symbol2item_[item->symbol()] = item.get();
     }
-    for (auto&& item : items())
+    for (auto&& item : items()) {
+        THORIN_PUSH(sema.cur_item_, item.get());
         item->bind(sema);
+    }
+    sema.bind_lazy_bodies();
     sema.pop_scope();
 }
 
@@ -248,7 +289,8 @@ void Fn::fn_bind(NameSema& sema) const {
 }
 
 void FnDecl::bind(NameSema& sema) const {
-    fn_bind(sema);
+    if (!is_lazy())
+        fn_bind(sema);
 }
 
 void StructDecl::bind(NameSema& sema) const {
@@ -269,14 +311,21 @@ void FieldDecl::bind(NameSema& sema) const {
 
 void TraitDecl::bind(NameSema& sema) const {
     sema.push_scope();
+    // Self comes first and is, thus, bound outside of all other type parameters
+    sema.insert(self_param());
+    self_param()->lambda_depth_ = ++sema.lambda_depth_;
     bind_ast_type_params(sema);
-    for (auto&& t : super_traits())
+    for (auto&& t : super_traits()) {
         t->bind(sema);
+        if (auto super_decl = t->decl() ? t->decl()->isa<TraitDecl>() : nullptr)
+            super_decl->sub_traits_.push_back(this);
+    }
     for (auto&& method : methods()) {
         method->bind(sema);
+        method->owner_ = this;
         method_table_[method->symbol()] = method.get();
     }
-    sema.lambda_depth_ -= num_ast_type_params();
+    sema.lambda_depth_ -= num_ast_type_params() + 1;
     sema.pop_scope();
 }
 
@@ -286,8 +335,13 @@ void ImplItem::bind(NameSema& sema) const {
     if (trait())
         trait()->bind(sema);
     ast_type()->bind(sema);
-    for (auto&& fn : methods())
+    for (auto&& fn : methods()) {
         fn->bind(sema);
+        fn->owner_ = this;
+        method_table_[fn->symbol()] = fn.get();
+    }
+    if (auto trait_decl = this->trait_decl())
+        trait_decl->impls_.push_back(this);
     sema.lambda_depth_ -= num_ast_type_params();
     sema.pop_scope();
 }
@@ -381,6 +435,12 @@ void MapExpr::bind(NameSema& sema) const {
         arg->bind(sema);
 }
 
+void SliceExpr::bind(NameSema& sema) const {
+    lhs()->bind(sema);
+    lo()->bind(sema);
+    hi()->bind(sema);
+}
+
 void IfExpr::bind(NameSema& sema) const {
     cond()->bind(sema);
     then_expr()->bind(sema);
@@ -439,6 +499,13 @@ void EnumPtrn::bind(NameSema& sema) const {
 
 void LiteralPtrn::bind(NameSema&) const {}
 void CharPtrn::bind(NameSema&) const {}
+void RangePtrn::bind(NameSema&) const {}
+
+void OrPtrn::bind(NameSema& sema) const {
+    for (auto&& alt : alts()) {
+        alt->bind(sema);
+    }
+}
 
 //------------------------------------------------------------------------------
 
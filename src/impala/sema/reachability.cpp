@@ -0,0 +1,53 @@
+#include "impala/ast.h"
+#include "impala/impala.h"
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+/*
+ * Roots are all items code may be entered from - main, extern and pub functions as well as pub statics and enums.
+ * Declarations without code of their own - types and extern blocks - are cheap to emit and are always kept.
+ * Impls and traits are kept as well: their methods are instantiated on demand by method calls, which name analysis does
+ * not resolve, so whatever these methods refer to must stay alive.
+ */
+static bool is_root(const Item* item) {
+    if (item->is_lazy())
+        return false;
+    if (auto fn_decl = item->isa<FnDecl>())
+        return fn_decl->is_extern() || fn_decl->symbol() == "main" || fn_decl->visibility().is_pub();
+    if (item->isa<StaticItem>() || item->isa<EnumDecl>() || item->isa<Typedef>())
+        return item->visibility().is_pub();
+    return true;
+}
+
+static void collect_roots(const Module* module, std::vector<const Item*>& roots) {
+    for (auto&& item : module->items()) {
+        if (is_root(item.get()))
+            roots.push_back(item.get());
+        if (auto nested = item->isa<Module>())
+            collect_roots(nested, roots);
+    }
+}
+
+void reachability_analysis(const Module* module) {
+    std::vector<const Item*> stack;
+    collect_roots(module, stack);
+    for (auto root : stack)
+        root->reachable_ = true;
+
+    while (!stack.empty()) {
+        auto item = stack.back();
+        stack.pop_back();
+        for (auto use : item->uses()) {
+            if (!use->reachable_) {
+                use->reachable_ = true;
+                stack.push_back(use);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+}
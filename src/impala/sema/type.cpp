@@ -115,18 +115,42 @@ bool is_strict_subtype(const Type* dst, const Type* src) {
     return dst != src && is_subtype(dst, src);
 }
 
-//------------------------------------------------------------------------------
+const Type* substitute(const Type* type, Types args) {
+    if (type->is_monomorphic() || type->is_nominal())
+        return type;
 
-/*
- * hash
- */
+    if (auto var = type->isa<Var>()) {
+        auto depth = size_t(var->depth());
+        return depth <= args.size() && args[depth-1] ? args[depth-1] : type;
+    }
 
-hash_t RefTypeBase::vhash() const {
-    return thorin::hash_combine(Type::vhash(), ((hash_t)addr_space() << 1) | hash_t(is_mut()));
+    Array<const Type*> ops(type->num_ops());
+    for (size_t i = 0, e = ops.size(); i != e; ++i)
+        ops[i] = substitute(type->op(i), args);
+    return type->rebuild(ops);
 }
 
-hash_t Var::vhash() const {
-    return thorin::murmur3(hash_t(tag()) << hash_t(32-8) | uint8_t(depth()));
+bool match(const Type* pattern, const Type* type, std::vector<const Type*>& args) {
+    if (auto var = pattern->isa<Var>()) {
+        auto depth = size_t(var->depth());
+        if (args.size() < depth)
+            args.resize(depth);
+        if (args[depth-1] == nullptr)
+            args[depth-1] = type;
+        return args[depth-1] == type;
+    }
+
+    if (pattern->is_monomorphic() || pattern->is_nominal())
+        return pattern == type;
+
+    if (pattern->tag() != type->tag() || pattern->num_ops() != type->num_ops() || pattern->payload() != type->payload())
+        return false;
+
+    for (size_t i = 0, e = pattern->num_ops(); i != e; ++i) {
+        if (!match(pattern->op(i), type->op(i), args))
+            return false;
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -135,16 +159,6 @@ hash_t Var::vhash() const {
  * equal
  */
 
-bool RefTypeBase::equal(const Type* other) const {
-    return Type::equal(other)
-        && this->is_mut() == other->as<RefTypeBase>()->is_mut()
-        && this->addr_space() == other->as<RefTypeBase>()->addr_space();
-}
-
-bool Var::equal(const Type* other) const {
-    return other->isa<Var>() ? this->as<Var>()->depth() == other->as<Var>()->depth() : false;
-}
-
 bool UnknownType::equal(const Type* other) const { return this == other; }
 
 //------------------------------------------------------------------------------
@@ -164,6 +178,7 @@ const Type* EnumType           ::vrebuild(TypeTable&   , Types    ) const { retu
 const Type* DefiniteArrayType  ::vrebuild(TypeTable& to, Types ops) const { return to.  definite_array_type(ops[0], dim()); }
 const Type* SimdType           ::vrebuild(TypeTable& to, Types ops) const { return to.            simd_type(ops[0], dim()); }
 const Type* IndefiniteArrayType::vrebuild(TypeTable& to, Types ops) const { return to.indefinite_array_type(ops[0]); }
+const Type* SliceType          ::vrebuild(TypeTable& to, Types ops) const { return to.           slice_type(ops[0]); }
 const Type* BorrowedPtrType    ::vrebuild(TypeTable& to, Types ops) const { return to.borrowed_ptr_type(ops[0], is_mut(), addr_space()); }
 const Type* OwnedPtrType       ::vrebuild(TypeTable& to, Types ops) const { return to.   owned_ptr_type(ops[0], addr_space()); }
 const Type* RefType            ::vrebuild(TypeTable& to, Types ops) const { return to.      ref_type(ops[0], is_mut(), addr_space()); }
@@ -242,6 +257,7 @@ Stream& TypeBase<TypeTable>::stream(Stream& s) const {
     } else if (auto t = isa<App>())                 { return s.fmt("{}[{}]", t->callee(), t->arg());
     } else if (auto t = isa<DefiniteArrayType>())   { return s.fmt("[{} * {}]", t->elem_type(), t->dim());
     } else if (auto t = isa<IndefiniteArrayType>()) { return s.fmt("[{}]", t->elem_type());
+    } else if (auto t = isa<SliceType>())           { return s.fmt("[{}..]", t->elem_type());
     } else if (auto t = isa<SimdType>())            { return s.fmt("simd[{} * {}]", t->elem_type(), t->dim());
     } else if (auto t = isa<StructType>())          { return s.fmt("{}", t->struct_decl()->symbol().str());
     } else if (auto t = isa<EnumType>())            { return s.fmt("{}", t->enum_decl()->symbol().str());
@@ -253,15 +269,15 @@ Stream& TypeBase<TypeTable>::stream(Stream& s) const {
 //------------------------------------------------------------------------------
 
 TypeTable::TypeTable()
-    : unit_(unify(new TupleType(*this, {})))
-    , type_noret_(unify(new NoRetType(*this)))
-    , type_error_(unify(new TypeError(*this)))
-#define IMPALA_TYPE(itype, atype) , itype##_(unify(new PrimType(*this, PrimType_##itype)))
+    : unit_(intern<TupleType>(Tag_tuple, {}, 0, Types()))
+    , type_noret_(intern<NoRetType>(Tag_noret, {}, 0))
+    , type_error_(intern<TypeError>(Tag_error, {}, 0))
+#define IMPALA_TYPE(itype, atype) , itype##_(intern<PrimType>(Tag_##itype, {}, 0, PrimType_##itype))
 #include "impala/tokenlist.h"
 {}
 
 const Type* TypeTable::app(const Type* callee, const Type* op) {
-    auto app = unify(new App(*this, callee, op));
+    auto app = intern<App>(Tag_app, {callee, op}, 0, callee, op);
 
     if (auto cache = app->cache_)
         return cache;
@@ -275,18 +291,37 @@ const Type* TypeTable::app(const Type* callee, const Type* op) {
     return app;
 }
 
+const Type* TypeTable::instantiate(const Lambda* lambda, Types type_args) {
+    ++num_instantiations_;
+    Instantiation key{lambda, std::vector<const Type*>(type_args.begin(), type_args.end())};
+    if (auto result = instantiations_.lookup(key)) {
+        ++num_instantiation_hits_;
+        return *result;
+    }
+
+    size_t i = type_args.size();
+    const Type* type = lambda;
+    while (auto lambda = type->isa<Lambda>()) {
+        assert(i != 0 && "too few type arguments");
+        type = app(lambda, type_args[--i]);
+    }
+
+    return instantiations_[std::move(key)] = type;
+}
+
+hash_t TypeTable::InstantiationHash::hash(const Instantiation& instantiation) {
+    hash_t seed = thorin::hash_begin(uint32_t(instantiation.lambda->gid()));
+    for (auto type_arg : instantiation.type_args)
+        seed = thorin::hash_combine(seed, uint32_t(type_arg->gid()));
+    return seed;
+}
+
 const StructType* TypeTable::struct_type(const StructDecl* decl, size_t size) {
-    auto type = new StructType(*this, decl, size);
-    const auto& p = types_.insert(type);
-    assert_unused(p.second && "hash/equal broken");
-    return type;
+    return unique<StructType>(decl, size);
 }
 
 const EnumType* TypeTable::enum_type(const EnumDecl* decl, size_t size) {
-    auto type = new EnumType(*this, decl, size);
-    const auto& p = types_.insert(type);
-    assert_unused(p.second && "hash/equal broken");
-    return type;
+    return unique<EnumType>(decl, size);
 }
 
 const PrimType* TypeTable::prim_type(const PrimTypeTag tag) {
@@ -308,7 +343,7 @@ const InferError* TypeTable::infer_error(const Type* dst, const Type* src) {
             return si;
     }
 
-    return unify(new InferError(*this, dst, src));
+    return intern<InferError>(Tag_infer_error, {dst, src}, 0, dst, src);
 }
 
 }
@@ -1,6 +1,8 @@
 #ifndef IMPALA_SEMA_TYPE_H
 #define IMPALA_SEMA_TYPE_H
 
+#include <vector>
+
 #include "thorin/util/array.h"
 #include "thorin/util/cast.h"
 #include "thorin/util/hash.h"
@@ -32,6 +34,7 @@ enum Tag {
     Tag_pi,
     Tag_ref,
     Tag_simd,
+    Tag_slice,
     Tag_struct,
     Tag_enum,
     Tag_tuple,
@@ -86,6 +89,17 @@ inline bool is_int  (const Type* t) { return is_i8(t) || is_i16(t) || is_i32(t)
 bool is_void(const Type*);
 bool is_subtype(const Type* dst, const Type* src);
 bool is_strict_subtype(const Type* dst, const Type* src);
+/**
+ * Replaces each @p Var of depth @c d in @p type by @c args[d-1] unless this entry is @c nullptr.
+ * In contrast to @p TypeTable::app, all other @p Var%s keep their depths.
+ */
+const Type* substitute(const Type* type, Types args);
+/**
+ * Does @p type match @p pattern?
+ * Each @p Var in @p pattern matches any type but always the same one; @c args[d-1] receives the type a @p Var of depth
+ * @c d has been matched with.
+ */
+bool match(const Type* pattern, const Type* type, std::vector<const Type*>& args);
 
 //------------------------------------------------------------------------------
 
@@ -102,9 +116,9 @@ public:
     const Type* pointee() const { return op(0); }
     bool is_mut() const { return mut_; }
     uint64_t addr_space() const { return addr_space_; }
+    uint64_t payload() const override { return payload(is_mut(), addr_space()); }
+    static uint64_t payload(bool mut, uint64_t addr_space) { return addr_space << uint64_t(1) | uint64_t(mut); }
 
-    hash_t vhash() const override;
-    bool equal(const Type* other) const override;
     virtual std::string prefix() const = 0;
 
 private:
@@ -243,10 +257,9 @@ private:
 
 public:
     int depth() const { return depth_; }
+    uint64_t payload() const override { return uint64_t(depth()); }
 
 private:
-    hash_t vhash() const override;
-    bool equal(const Type*) const override;
     const Type* vrebuild(TypeTable& to, Types ops) const override;
     const Type* vreduce(int, const Type*, Type2Type&) const override;
 
@@ -363,10 +376,7 @@ public:
     {}
 
     uint64_t dim() const { return dim_; }
-    hash_t vhash() const override { return thorin::hash_combine(Type::vhash(), dim()); }
-    bool equal(const Type* other) const override {
-        return Type::equal(other) && this->dim() == other->as<DefiniteArrayType>()->dim();
-    }
+    uint64_t payload() const override { return dim(); }
 
 private:
     const Type* vrebuild(TypeTable&, Types) const override;
@@ -384,10 +394,7 @@ public:
     {}
 
     uint64_t dim() const { return dim_; }
-    hash_t vhash() const override { return thorin::hash_combine(Type::vhash(), dim()); }
-    bool equal(const Type* other) const override {
-        return Type::equal(other) && this->dim() == other->as<SimdType>()->dim();
-    }
+    uint64_t payload() const override { return dim(); }
 
 private:
     const Type* vrebuild(TypeTable&, Types) const override;
@@ -397,6 +404,22 @@ private:
     friend class TypeTable;
 };
 
+/**
+ * An array whose length is only known at run time but - in contrast to an @p IndefiniteArrayType - travels along with it.
+ * It is unsized and only occurs behind a borrowed pointer <tt>&[T..]</tt> which is emitted as <tt>(ptr, len)</tt> pair.
+ */
+class SliceType : public ArrayType {
+public:
+    SliceType(TypeTable& typetable, const Type* elem_type)
+        : ArrayType(typetable, Tag_slice, elem_type)
+    {}
+
+private:
+    const Type* vrebuild(TypeTable&, Types) const override;
+
+    friend class TypeTable;
+};
+
 class NoRetType : public Type {
 private:
     NoRetType(TypeTable& typetable)
@@ -463,11 +486,18 @@ class TypeTable : public TypeTableBase<Type> {
 public:
     TypeTable();
 
-    const Var* var(int depth) { return unify(new Var(*this, depth)); }
+    const Var* var(int depth) { return intern<Var>(Tag_var, {}, depth, depth); }
     const Type* app(const Type* callee, const Type* op);
-    const Lambda* lambda(const Type* body, const char* name) { return unify(new Lambda(*this, body, name)); }
-
-    const TupleType* tuple_type(Types ops) { assert(ops.size() != 1); return unify(new TupleType(*this, ops)); }
+    const Lambda* lambda(const Type* body, const char* name) { return intern<Lambda>(Tag_lambda, {body}, 0, body, name); }
+    /**
+     * Applies all @p type_args to the polymorphic @p lambda at once; the last one belongs to the outermost @p Lambda.
+     * As @p Type%s are hash-consed, the result only depends on the key (@p lambda, @p type_args) and is cached.
+     */
+    const Type* instantiate(const Lambda* lambda, Types type_args);
+    size_t num_instantiations() const { return num_instantiations_; }         ///< How often @p instantiate has been invoked.
+    size_t num_instantiation_hits() const { return num_instantiation_hits_; } ///< How often the result has been cached.
+
+    const TupleType* tuple_type(Types ops) { assert(ops.size() != 1); return intern<TupleType>(Tag_tuple, ops, 0, ops); }
     const TupleType* unit() { return unit_; }
 
     const StructType* struct_type(const StructDecl* decl, size_t size);
@@ -476,30 +506,61 @@ public:
 #define IMPALA_TYPE(itype, atype) const PrimType* type_##itype() { return itype##_; }
 #include "impala/tokenlist.h"
     const DefiniteArrayType* definite_array_type(const Type* elem_type, uint64_t dim) {
-        return unify(new DefiniteArrayType(*this, elem_type, dim));
+        return intern<DefiniteArrayType>(Tag_definite_array, {elem_type}, dim, elem_type, dim);
     }
-    const FnType* fn_type(const Type* op) { return unify(new FnType(*this, op)); }
-    const FnType* fn_type(Types params) { return unify(new FnType(*this, params.size() == 1 ? params.front() : tuple_type(params))); }
+    const FnType* fn_type(const Type* op) { return intern<FnType>(Tag_fn, {op}, 0, op); }
+    const FnType* fn_type(Types params) { return fn_type(params.size() == 1 ? params.front() : tuple_type(params)); }
     const IndefiniteArrayType* indefinite_array_type(const Type* elem_type) {
-        return unify(new IndefiniteArrayType(*this, elem_type));
+        return intern<IndefiniteArrayType>(Tag_indefinite_array, {elem_type}, 0, elem_type);
+    }
+    const SliceType* slice_type(const Type* elem_type) {
+        return intern<SliceType>(Tag_slice, {elem_type}, 0, elem_type);
+    }
+    const SimdType* simd_type(const Type* elem_type, uint64_t size) {
+        return intern<SimdType>(Tag_simd, {elem_type}, size, elem_type, size);
     }
-    const SimdType* simd_type(const Type* elem_type, uint64_t size) { return unify(new SimdType(*this, elem_type, size)); }
     const BorrowedPtrType* borrowed_ptr_type(const Type* pointee, bool mut, uint64_t addr_space) {
-        return unify(new BorrowedPtrType(*this, pointee, mut, addr_space));
+        return intern<BorrowedPtrType>(Tag_borrowed_ptr, {pointee}, RefTypeBase::payload(mut, addr_space), pointee, mut, addr_space);
     }
     const OwnedPtrType* owned_ptr_type(const Type* pointee, uint64_t addr_space) {
-        return unify(new OwnedPtrType(*this, pointee, addr_space));
+        return intern<OwnedPtrType>(Tag_owned_ptr, {pointee}, RefTypeBase::payload(true, addr_space), pointee, addr_space);
     }
     const RefType* ref_type(const Type* pointee, bool mut, uint64_t addr_space) {
-        return unify(new RefType(*this, pointee, mut, addr_space));
+        return intern<RefType>(Tag_ref, {pointee}, RefTypeBase::payload(mut, addr_space), pointee, mut, addr_space);
     }
     const NoRetType* type_noret() { return type_noret_; }
     const PrimType* prim_type(PrimTypeTag tag);
-    const UnknownType* unknown_type() { return unify(new UnknownType(*this)); }
+    const UnknownType* unknown_type() { return unique<UnknownType>(); }
     const TypeError* type_error() { return type_error_; }
     const InferError* infer_error(const Type* dst, const Type* src);
 
 private:
+    /// Hash-conses the @p T with key (@p tag, @p ops, @p payload) which is constructed from @p args on a miss.
+    template<class T, class... Args>
+    const T* intern(int tag, Types ops, uint64_t payload, Args&&... args) {
+        return TypeTableBase::intern<T>(tag, ops, payload, [&] (void* mem) { return new (mem) T(*this, std::forward<Args>(args)...); });
+    }
+
+    template<class T, class... Args>
+    T* unique(Args&&... args) {
+        return TypeTableBase::unique<T>([&] (void* mem) { return new (mem) T(*this, std::forward<Args>(args)...); });
+    }
+
+private:
+    struct Instantiation {
+        const Lambda* lambda;
+        std::vector<const Type*> type_args;
+    };
+
+    struct InstantiationHash {
+        static hash_t hash(const Instantiation&);
+        static bool eq(const Instantiation& i1, const Instantiation& i2) { return i1.lambda == i2.lambda && i1.type_args == i2.type_args; }
+        static Instantiation sentinel() { return {nullptr, {}}; }
+    };
+
+    thorin::HashMap<Instantiation, const Type*, InstantiationHash> instantiations_;
+    size_t num_instantiations_ = 0;
+    size_t num_instantiation_hits_ = 0;
     const TupleType* unit_;
     const NoRetType* type_noret_;
     const TypeError* type_error_;
@@ -1,11 +1,17 @@
 #ifndef IMPALA_SEMA_TYPE_TABLE_H
 #define IMPALA_SEMA_TYPE_TABLE_H
 
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
 #include "thorin/util/hash.h"
 #include "thorin/util/cast.h"
 #include "thorin/util/array.h"
 #include "thorin/util/stream.h"
 
+#include "impala/arena.h"
+
 namespace impala {
 
 template<class T> using ArrayRef = thorin::ArrayRef<T>;
@@ -28,6 +34,7 @@ protected:
     TypeBase(TypeTable& table, int tag, Types ops);
 
     void set(size_t i, const TypeBase* type) {
+        assert(i < num_ops_);
         ops_[i] = type;
         order_       = std::max(order_, type->order());
         monomorphic_ &= type->is_monomorphic();
@@ -36,15 +43,17 @@ protected:
     }
 
 public:
+    using Table = TypeTable;
+
     virtual ~TypeBase() {}
 
     int tag() const { return tag_; }
     TypeTable& table() const { return *table_; }
 
-    Types ops() const { return ops_; }
-    const TypeBase* op(size_t i) const { return ops()[i]; }
-    size_t num_ops() const { return ops_.size(); }
-    bool empty() const { return ops_.empty(); }
+    Types ops() const { return Types(num_ops_, ops_); }
+    const TypeBase* op(size_t i) const { assert(i < num_ops_); return ops_[i]; }
+    size_t num_ops() const { return num_ops_; }
+    bool empty() const { return num_ops_ == 0; }
 
     bool is_nominal() const { return nominal_; }              ///< A nominal @p Type is always different from each other @p Type.
     bool is_known()   const { return known_; }                ///< Does this @p Type depend on any @p UnknownType%s?
@@ -54,14 +63,17 @@ public:
     size_t gid() const { return gid_; }
     hash_t hash() const { return hash_ == 0 ? hash_ = vhash() : hash_; }
     virtual bool equal(const TypeBase*) const;
+    /// Does this structural @p TypeBase have the key (@p tag, @p ops, @p payload)?
+    bool equal(int tag, Types ops, uint64_t payload) const;
+    /// Distinguishes structural @p TypeBase%s with equal tag and ops, e.g. arrays of different dimensions.
+    virtual uint64_t payload() const { return 0; }
+    static hash_t hash(int tag, Types ops, uint64_t payload);
     Stream& stream(Stream&) const;
 
     const TypeBase* reduce(int, const TypeBase*, Type2Type&) const;
     const TypeBase* rebuild(TypeTable& to, Types ops) const;
     const TypeBase* rebuild(Types ops) const { return rebuild(table(), ops); }
 
-    static size_t gid_counter() { return gid_counter_; }
-
 protected:
     virtual hash_t vhash() const;
     virtual const TypeBase* vreduce(int, const TypeBase*, Type2Type&) const;
@@ -76,57 +88,87 @@ private:
     virtual const TypeBase* vrebuild(TypeTable& to, Types ops) const = 0;
 
     mutable TypeTable* table_;
+    const TypeBase** ops_; ///< Allocated in the arena of the table.
+    uint32_t num_ops_;
     int tag_;
-    Array<const TypeBase*> ops_;
     mutable size_t gid_;
-    static size_t gid_counter_;
 
     friend TypeTable;
 };
 
 //------------------------------------------------------------------------------
 
-/// Base class for all \p TypeTable%s.
+/**
+ * Base class for all \p TypeTable%s.
+ * Structural @p Type%s are hash-consed: @p intern looks up the key of a @p Type before anything is allocated.
+ * All @p Type%s live in an @p Arena owned by the table.
+ */
 template <class Type>
 class TypeTableBase {
 public:
-    struct TypeHash {
-        static hash_t hash(const Type* t) { return t->hash(); }
-        static bool eq(const Type* t1, const Type* t2) { return t2->equal(t1); }
-        static const Type* sentinel() { return (const Type*)(1); }
-    };
-
-    typedef thorin::HashSet<const Type*, TypeHash> TypeSet;
+    using Types = ArrayRef<const Type*>;
 
     TypeTableBase& operator=(const TypeTableBase&) = delete;
     TypeTableBase(const TypeTableBase&) = delete;
 
     TypeTableBase() {}
-    virtual ~TypeTableBase() { for (auto type : types_) delete type; }
+    virtual ~TypeTableBase() { for (auto type : types_) type->~Type(); }
+
+    const std::vector<const Type*>& types() const { return types_; }
+    size_t first_gid() const { return first_gid_; } ///< All @p Type%s of this table have a gid greater or equal to this one.
+    size_t next_gid() { return gid_counter_++; }    ///< gids are handed out per table; thus, tables of different threads do not race.
+    Arena& arena() { return arena_; }
+
+    /*
+     * statistics
+     */
 
-    const TypeSet& types() const { return types_; }
+    size_t num_types() const { return types_.size(); }
+    size_t num_bytes() const { return arena_.num_bytes() + buckets_.capacity() * sizeof(const Type*); }
+    size_t num_lookups() const { return num_lookups_; } ///< How often a structural @p Type has been requested.
+    size_t num_hits() const { return num_hits_; }       ///< How often a structural @p Type has already existed.
 
 protected:
-    const Type* unify_base(const Type* type);
-    template<class T> const T* unify(const T* type) { return unify_base(type)->template as<T>(); }
-    const Type* insert(const Type*);
+    /**
+     * Returns the structural @p Type with the given key if it already exists.
+     * Otherwise, @p make is invoked with memory for a new @p T which must have exactly this key.
+     */
+    template<class T, class F>
+    const T* intern(int tag, Types ops, uint64_t payload, F make);
+
+    /// Allocates a @p Type which is different from all others, e.g. a nominal one.
+    template<class T, class F>
+    T* unique(F make) {
+        auto type = make(arena_.allocate(sizeof(T)));
+        types_.push_back(type);
+        return type;
+    }
 
-    TypeSet types_;
+private:
+    void rehash();
+
+    Arena arena_;
+    std::vector<const Type*> types_;   ///< All @p Type%s in order of creation.
+    std::vector<const Type*> buckets_; ///< Open addressing with linear probing for structural @p Type%s.
+    size_t num_structural_ = 0;
+    size_t num_lookups_ = 0;
+    size_t num_hits_ = 0;
+    static constexpr size_t first_gid_ = 1;
+    size_t gid_counter_ = first_gid_;
 };
 
 //------------------------------------------------------------------------------
 
-template <class TypeTable>
-size_t TypeBase<TypeTable>::gid_counter_ = 1;
-
 template <class TypeTable>
 TypeBase<TypeTable>::TypeBase(TypeTable& table, int tag, Types ops)
     : table_(&table)
+    , ops_(ops.empty() ? nullptr : static_cast<const TypeBase**>(table.arena().allocate(ops.size() * sizeof(const TypeBase*))))
+    , num_ops_(uint32_t(ops.size()))
     , tag_(tag)
-    , ops_(ops.size())
-    , gid_(gid_counter_++)
+    , gid_(table.next_gid())
 {
     for (size_t i = 0, e = num_ops(); i != e; ++i) {
+        ops_[i] = nullptr;
         if (auto op = ops[i])
             set(i, op);
     }
@@ -159,52 +201,82 @@ const TypeBase<TypeTable>* TypeBase<TypeTable>::rebuild(TypeTable& to, Types ops
     return vrebuild(to, ops);
 }
 
+template <class TypeTable>
+hash_t TypeBase<TypeTable>::hash(int tag, Types ops, uint64_t payload) {
+    hash_t seed = thorin::hash_begin(uint8_t(tag));
+    for (auto op : ops)
+        seed = thorin::hash_combine(seed, uint32_t(op->gid()));
+    if (payload != 0)
+        seed = thorin::hash_combine(seed, payload);
+    return seed;
+}
+
 template <class TypeTable>
 hash_t TypeBase<TypeTable>::vhash() const {
     if (is_nominal())
         return thorin::murmur3(hash_t(tag()) << hash_t(32-8) | hash_t(gid()));
-
-    hash_t seed = thorin::hash_begin(uint8_t(tag()));
-    for (auto op : ops_)
-        seed = thorin::hash_combine(seed, uint32_t(op->gid()));
-    return seed;
+    return hash(tag(), ops(), payload());
 }
 
 template <class TypeTable>
 bool TypeBase<TypeTable>::equal(const TypeBase* other) const {
     if (is_nominal())
         return this == other;
+    return other->equal(tag(), ops(), payload());
+}
 
-    bool result = this->tag() == other->tag() && this->num_ops() == other->num_ops()
-        && this->is_monomorphic() == other->is_monomorphic();
+template <class TypeTable>
+bool TypeBase<TypeTable>::equal(int tag, Types ops, uint64_t payload) const {
+    if (is_nominal() || this->tag() != tag || this->num_ops() != ops.size() || this->payload() != payload)
+        return false;
 
-    if (result) {
-        for (size_t i = 0, e = num_ops(); result && i != e; ++i)
-            result &= this->op(i) == other->op(i);
+    for (size_t i = 0, e = num_ops(); i != e; ++i) {
+        if (this->op(i) != ops[i])
+            return false;
     }
-
-    return result;
+    return true;
 }
 
 //------------------------------------------------------------------------------
 
 template <class Type>
-const Type* TypeTableBase<Type>::unify_base(const Type* type) {
-    auto i = types_.find(type);
-    if (i != types_.end()) {
-        delete type;
-        type = *i;
-        return type;
+template <class T, class F>
+const T* TypeTableBase<Type>::intern(int tag, Types ops, uint64_t payload, F make) {
+    ++num_lookups_;
+    if (2 * (num_structural_ + 1) > buckets_.size())
+        rehash();
+
+    auto hash = Type::hash(tag, ops, payload);
+    for (size_t mask = buckets_.size() - 1, i = hash & mask;; i = (i + 1) & mask) {
+        auto type = buckets_[i];
+        if (type == nullptr) {
+            const T* result = make(arena_.allocate(sizeof(T)));
+            assert(result->equal(tag, ops, payload) && result->hash() == hash && "type does not match its key");
+            ++num_structural_;
+            types_.push_back(result);
+            return (buckets_[i] = result)->template as<T>();
+        }
+
+        if (type->hash() == hash && type->equal(tag, ops, payload)) {
+            ++num_hits_;
+            return type->template as<T>();
+        }
     }
-
-    return insert(type);
 }
 
 template <class Type>
-const Type* TypeTableBase<Type>::insert(const Type* type) {
-    const auto& p = types_.insert(type);
-    assert_unused(p.second && "hash/equal broken");
-    return type;
+void TypeTableBase<Type>::rehash() {
+    std::vector<const Type*> buckets(std::max(size_t(64), 2 * buckets_.size()), nullptr);
+    size_t mask = buckets.size() - 1;
+    for (auto type : buckets_) {
+        if (type != nullptr) {
+            size_t i = type->hash() & mask;
+            while (buckets[i] != nullptr)
+                i = (i + 1) & mask;
+            buckets[i] = type;
+        }
+    }
+    buckets_.swap(buckets);
 }
 
 //------------------------------------------------------------------------------
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 
 #include "impala/ast.h"
@@ -80,9 +81,39 @@ public:
         }
     }
 
+    /// Checks that @p ast_type names a trait and instantiates all of its type parameters.
+    const TraitDecl* expect_trait(const ASTType* ast_type) {
+        auto type_app = ast_type->isa<ASTTypeApp>();
+        auto trait_decl = type_app && type_app->decl() ? type_app->decl()->isa<TraitDecl>() : nullptr;
+        if (trait_decl == nullptr) {
+            error(ast_type, "expected trait instance");
+            return nullptr;
+        }
+
+        if (type_app->num_ast_type_args() != trait_decl->num_ast_type_params()) {
+            error(ast_type, "wrong number of instances for bound type variables of trait '{}': {} for {}",
+                  trait_decl->symbol(), type_app->num_ast_type_args(), trait_decl->num_ast_type_params());
+            return nullptr;
+        }
+
+        return trait_decl;
+    }
+
+    /// @p trait_decl instantiated with @p args - the implementing type followed by the type arguments of the trait.
+    static std::string trait_str(const TraitDecl* trait_decl, Types args) {
+        std::ostringstream os;
+        Stream s(os);
+        s.fmt("{}", trait_decl->symbol());
+        if (args.size() > 1)
+            s.fmt("[{, }]", args.skip_front());
+        return os.str();
+    }
+
     void no_indefinite_array(const ASTNode* n, const Type* type, const char* context) {
         if (type->isa<IndefiniteArrayType>())
             error(n, "indefinite array '{}' not allowed as {} because its size is statically unknown; use a definite array or a pointer to an indefinite array instead", type, context);
+        else if (type->isa<SliceType>())
+            error(n, "slice '{}' not allowed as {} because its size is statically unknown; use a borrowed pointer '&{}' instead", type, context, type);
     }
 
     // check wrappers
@@ -105,11 +136,92 @@ public:
         check_call(expr, array);
     }
 
+    // bounds checks
+
+    /// The immutable local @c s if @p expr is @c *s - @c s being a pointer to a slice.
+    static const LocalDecl* slice_local(const Expr* expr);
+    /**
+     * Is @p fn_decl a loop like <tt>fn range(a: int, b: int, body: fn(int) -> ()) -> () { if a < b { body(a); range(a + 1, b, body) } }</tt>?
+     * Such a loop only ever passes values from @c a up to - but excluding - @c b to @c body.
+     */
+    static bool is_counting_loop(const FnDecl* fn_decl);
+    /// Is @p index an induction variable which stays in the bounds of the slice @p slice?
+    bool is_in_bounds(const Expr* slice, const Expr* index) const;
+
+    /// Adds @p owner - the @p ImplItem or @p TraitDecl of a called method - to the @p Item::uses of @p cur_item_.
+    void use(const Item* owner) {
+        if (cur_item_ == nullptr || cur_item_ == owner)
+            return;
+        auto& uses = cur_item_->uses_;
+        if (std::find(uses.begin(), uses.end(), owner) == uses.end())
+            uses.push_back(owner);
+    }
+
 public:
+    const Item* cur_item_ = nullptr; ///< The @p Item of a @p Module that is being checked.
     const BlockExpr* cur_block_ = nullptr;
     const Fn* cur_fn_ = nullptr;
+    /// The induction variables of the enclosing for loops paired with the slices whose bounds they stay in.
+    std::vector<std::pair<const LocalDecl*, const LocalDecl*>> in_bounds_;
 };
 
+const LocalDecl* TypeSema::slice_local(const Expr* expr) {
+    auto deref = expr->skip_rvalue()->isa<PrefixExpr>();
+    auto path = deref && deref->tag() == PrefixExpr::MUL ? deref->rhs()->skip_rvalue()->isa<PathExpr>() : nullptr;
+    auto local = path && path->value_decl() ? path->value_decl()->isa<LocalDecl>() : nullptr;
+    return local && !local->is_mut() && unpack_ref_type(expr->type())->isa<SliceType>() ? local : nullptr;
+}
+
+bool TypeSema::is_counting_loop(const FnDecl* fn_decl) {
+    if (fn_decl->num_params() < 3 || fn_decl->body() == nullptr)
+        return false;
+
+    auto a = fn_decl->param(0), b = fn_decl->param(1), body = fn_decl->param(2);
+    if (a->is_mut() || b->is_mut() || body->is_mut() || !is_int(a->type()) || a->type() != b->type())
+        return false;
+
+    auto is = [] (const Expr* expr, const Decl* decl) {
+        auto path = expr->skip_rvalue()->isa<PathExpr>();
+        return path != nullptr && path->value_decl() == decl;
+    };
+
+    auto block = fn_decl->body()->isa<BlockExpr>();
+    auto if_expr = block && block->stmts().empty() ? block->expr()->isa<IfExpr>() : nullptr;
+    auto cond = if_expr && !if_expr->has_else() ? if_expr->cond()->isa<InfixExpr>() : nullptr;
+    if (cond == nullptr || cond->tag() != InfixExpr::LT || !is(cond->lhs(), a) || !is(cond->rhs(), b))
+        return false;
+
+    // the then-branch consists of exactly the two calls 'body(a)' and 'fn_decl(a + 1, b, body)'
+    auto then_block = if_expr->then_expr()->isa<BlockExpr>();
+    if (then_block == nullptr)
+        return false;
+    std::vector<const MapExpr*> calls;
+    for (auto&& stmt : then_block->stmts()) {
+        auto expr_stmt = stmt->isa<ExprStmt>();
+        calls.push_back(expr_stmt ? expr_stmt->expr()->isa<MapExpr>() : nullptr);
+    }
+    if (!then_block->expr()->isa<EmptyExpr>())
+        calls.push_back(then_block->expr()->isa<MapExpr>());
+    if (calls.size() != 2 || calls[0] == nullptr || calls[1] == nullptr)
+        return false;
+
+    auto body_call = calls[0], next = calls[1];
+    if (!is(body_call->lhs(), body) || body_call->num_args() != 1 || !is(body_call->arg(0), a))
+        return false;
+
+    auto step = next->num_args() == 3 ? next->arg(0)->isa<InfixExpr>() : nullptr;
+    auto one = step && step->tag() == InfixExpr::ADD ? step->rhs()->isa<LiteralExpr>() : nullptr;
+    return is(next->lhs(), fn_decl) && one && one->get_u64() == 1 && is(step->lhs(), a)
+        && is(next->arg(1), b) && is(next->arg(2), body);
+}
+
+bool TypeSema::is_in_bounds(const Expr* slice, const Expr* index) const {
+    auto path = index->skip_rvalue()->isa<PathExpr>();
+    auto local = path && path->value_decl() ? path->value_decl()->isa<LocalDecl>() : nullptr;
+    auto fact = std::make_pair(local, slice_local(slice));
+    return fact.first && fact.second && std::find(in_bounds_.begin(), in_bounds_.end(), fact) != in_bounds_.end();
+}
+
 void type_analysis(const Module* module) { TypeSema().check(module); }
 
 template<class T>
@@ -125,8 +237,10 @@ const char* tok2str(const T* expr) { return Token::tok2str(token_tag(expr)); }
  */
 
 const Var* ASTTypeParam::check(TypeSema& sema) const {
-    for (auto&& bound : bounds())
+    for (auto&& bound : bounds()) {
         sema.check(bound.get());
+        sema.expect_trait(bound.get());
+    }
 
     return var();
 }
@@ -144,9 +258,21 @@ void ASTTypeParamList::check_ast_type_params(TypeSema& sema) const {
 
 void ErrorASTType::check(TypeSema& ) const {}
 void PrimASTType::check(TypeSema&) const {}
-void PtrASTType::check(TypeSema& sema) const { sema.check(referenced_ast_type()); }
+void PtrASTType::check(TypeSema& sema) const {
+    if (sema.check(referenced_ast_type())->isa<SliceType>() && tag() == Owned)
+        error(this, "slice '{}' cannot be owned; use a borrowed pointer instead", referenced_ast_type()->type());
+}
 void IndefiniteArrayASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
-void   DefiniteArrayASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
+void           SliceASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
+
+void DefiniteArrayASTType::check(TypeSema& sema) const {
+    sema.check(elem_ast_type());
+    sema.check(dim());
+    sema.expect_int(dim(), "dimension of array type");
+    ConstEvalError err;
+    if (!const_dim(dim(), &err))
+        error(err.node, "dimension of array type is not a compile-time constant: {}", err.msg);
+}
 
 void SimdASTType::check(TypeSema& sema) const {
     if (!sema.check(elem_ast_type())->isa<PrimType>())
@@ -223,8 +349,12 @@ void ModuleDecl::check(TypeSema&) const {
 }
 
 void Module::check(TypeSema& sema) const {
-    for (auto&& item : items())
-        sema.check(item.get());
+    for (auto&& item : items()) {
+        if (!item->is_lazy()) {
+            THORIN_PUSH(sema.cur_item_, item.get());
+            sema.check(item.get());
+        }
+    }
 }
 
 void ExternBlock::check(TypeSema& sema) const {
@@ -273,31 +403,130 @@ void FnDecl::check(TypeSema& sema) const {
 }
 
 void StaticItem::check(TypeSema& sema) const {
-    if (init())
+    if (init()) {
         sema.check(init());
+        ConstEvalError err;
+        if (auto value = const_eval(init(), &err))
+            value_ = std::move(*value);
+        else if (!err.unrepresentable) // otherwise, the initializer is emitted as it is
+            error(err.node, "initializer of static '{}' is not a compile-time constant: {}", symbol(), err.msg);
+    }
     sema.expect_known(this);
 }
 
+/// Collects the methods of @p trait_decl and of all its super traits along with the trait arguments by depth.
+static void collect_methods(const TraitDecl* trait_decl, Types trait_args,
+                            std::vector<std::pair<const FnDecl*, std::vector<const Type*>>>& methods,
+                            GIDSet<const TraitDecl*>& done) {
+    if (!done.emplace(trait_decl).second)
+        return;
+
+    std::vector<const Type*> by_depth;
+    trait_decl->trait_args_by_depth(trait_args, by_depth);
+    for (auto&& method : trait_decl->methods())
+        methods.emplace_back(method.get(), by_depth);
+
+    for (auto&& super_trait : trait_decl->super_traits()) {
+        if (auto super_decl = super_trait->decl() ? super_trait->decl()->isa<TraitDecl>() : nullptr) {
+            std::vector<const Type*> super_args(1, trait_args.front());
+            for (auto type_arg : super_trait->type_args())
+                super_args.push_back(substitute(type_arg, by_depth));
+            collect_methods(super_decl, super_args, methods, done);
+        }
+    }
+}
+
 void TraitDecl::check(TypeSema& sema) const {
     check_ast_type_params(sema);
 
-    for (auto&& type_app : super_traits())
+    MethodTable super_methods;
+    for (auto&& type_app : super_traits()) {
         sema.check(type_app.get());
+        if (auto super_decl = sema.expect_trait(type_app.get())) {
+            std::vector<std::pair<const FnDecl*, std::vector<const Type*>>> methods;
+            GIDSet<const TraitDecl*> done;
+            std::vector<const Type*> super_args(1, self_param()->type());
+            for (auto type_arg : type_app->type_args())
+                super_args.push_back(type_arg);
+            collect_methods(super_decl, super_args, methods, done);
+            for (auto&& method : methods) {
+                auto symbol = method.first->symbol();
+                auto other = super_methods.lookup(symbol);
+                if (other && *other != method.first)
+                    error(this, "conflicting method name in super traits: '{}'", symbol);
+                super_methods[symbol] = method.first;
+            }
+        }
+    }
 
-    for (auto&& method : methods())
+    for (auto&& method : methods()) {
+        if (super_methods.contains(method->symbol()))
+            error(method.get(), "a method with this name already exists in a super trait.");
         sema.check(method.get());
+    }
 }
 
 void ImplItem::check(TypeSema& sema) const {
     check_ast_type_params(sema);
     sema.check(this->ast_type());
+    for (auto&& method : methods())
+        sema.check(method.get());
 
-    if (trait()) {
-        if (trait()->isa<ASTTypeApp>()) {
-            for (auto&& type_param : ast_type_params())
-                sema.check(type_param.get());
-        } else
-            error(trait(), "expected trait instance");
+    if (!trait())
+        return;
+
+    auto trait_decl = sema.expect_trait(trait());
+    if (trait_decl == nullptr)
+        return;
+
+    auto args = trait_args();
+    for (auto impl : trait_decl->impls()) {
+        if (impl == this)
+            break;
+        if (impl->trait_args() == args) {
+            error(this, "conflicting implementation of trait '{}'", TypeSema::trait_str(trait_decl, args));
+            error(impl, "previous implementation here");
+            break;
+        }
+    }
+
+    std::vector<std::pair<const FnDecl*, std::vector<const Type*>>> trait_methods;
+    GIDSet<const TraitDecl*> done;
+    collect_methods(trait_decl, args, trait_methods, done);
+
+    for (auto&& p : trait_methods) {
+        auto trait_method = p.first;
+        auto symbol = trait_method->symbol();
+        if (auto method = find_method(symbol)) {
+            // methods with type parameters of their own are compared as they are
+            auto expected = trait_method->num_ast_type_params() == 0 ? substitute(trait_method->type(), p.second) : trait_method->type();
+            if (method->type() != expected)
+                error(method, "method '{}' has type '{}' but trait '{}' requires '{}'", symbol, method->type(), trait_decl->symbol(), expected);
+            continue;
+        }
+
+        if (trait_method->body() != nullptr)
+            continue; // default method
+
+        // a method of a super trait may also stem from an impl of this super trait
+        auto owner = trait_method->owner()->as<TraitDecl>();
+        if (owner != trait_decl) {
+            std::vector<const Type*> owner_args(1, args.front()), impl_args;
+            for (auto&& param : owner->ast_type_params()) {
+                auto i = size_t(param->lambda_depth()) - 1;
+                owner_args.push_back(i < p.second.size() && p.second[i] ? p.second[i] : param->type());
+            }
+            auto impl = owner->find_impl(owner_args, impl_args, symbol);
+            if (impl != nullptr && impl != this)
+                continue;
+        }
+
+        error(this, "Must implement method '{}'", symbol);
+    }
+
+    for (auto&& method : methods()) {
+        if (std::none_of(trait_methods.begin(), trait_methods.end(), [&] (const auto& p) { return p.first->symbol() == method->symbol(); }))
+            error(method.get(), "method '{}' is not a member of trait '{}'", method->symbol(), trait_decl->symbol());
     }
 }
 
@@ -579,7 +808,36 @@ void StructExpr::check(TypeSema& sema) const {
 void FieldExpr::check(TypeSema& sema) const {
     auto type = unpack_ref_type(sema.check(lhs()));
 
-    if (auto struct_type = type->isa<StructType>()) {
+    if (method()) {
+        sema.use(method()->owner());
+        if (std::any_of(method_type_args().begin(), method_type_args().end(), [] (const Type* t) { return !t->is_known(); })) {
+            error(this, "cannot infer the trait arguments for method '{}'", symbol());
+            return;
+        }
+
+        auto method_type = this->method_type();
+        if (method_type == nullptr || method_type->num_params() == 0) {
+            error(this, "method '{}' cannot be called on '{}'", symbol(), type);
+            return;
+        }
+        if (method_type->param(0) != type)
+            error(lhs(), "mismatched types: expected '{}' but found '{}' as receiver of method '{}'", method_type->param(0), type, symbol());
+
+        // calls on type parameters are resolved when the surrounding function is instantiated
+        auto trait_decl = method()->owner()->isa<TraitDecl>();
+        if (trait_decl && type->is_monomorphic()
+                && std::all_of(method_type_args().begin(), method_type_args().end(), [] (const Type* t) { return t->is_monomorphic(); })) {
+            std::vector<const Type*> type_args;
+            if (!trait_decl->resolve_method(symbol(), method_type_args(), type_args))
+                error(this, "'{}' does not implement method '{}' of trait '{}'", type, symbol(), TypeSema::trait_str(trait_decl, method_type_args()));
+        }
+        return;
+    }
+
+    if (type->isa<SliceType>()) {
+        if (symbol() != "len")
+            error(lhs(), "attempted access of field '{}' on slice '{}', but slices only have a field 'len'", symbol(), type);
+    } else if (auto struct_type = type->isa<StructType>()) {
         auto struct_decl = struct_type->struct_decl();
         if (auto field_decl = struct_decl->field_decl(symbol()))
             field_decl_ = *field_decl;
@@ -589,7 +847,39 @@ void FieldExpr::check(TypeSema& sema) const {
         error(lhs(), "request for field '{}' in something not a structure", symbol());
 }
 
-void TypeAppExpr::check(TypeSema& /*sema*/) const {
+void TypeAppExpr::check(TypeSema& sema) const {
+    sema.check(lhs());
+    for (auto&& ast_type_arg : ast_type_args())
+        sema.check(ast_type_arg.get());
+
+    auto path = lhs()->skip_rvalue()->isa<PathExpr>();
+    auto fn_decl = path && path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr;
+    if (fn_decl == nullptr)
+        return;
+
+    // bounds of monomorphic instances must be implemented - polymorphic ones are checked once instantiated
+    std::vector<const Type*> by_depth;
+    fn_decl->type_args_by_depth(type_args(), by_depth);
+    for (size_t i = 0, e = std::min(num_type_args(), fn_decl->num_ast_type_params()); i != e; ++i) {
+        auto ast_type_param = fn_decl->ast_type_param(i);
+        for (auto&& bound : ast_type_param->bounds()) {
+            auto type_app = bound->isa<ASTTypeApp>();
+            auto trait_decl = type_app && type_app->decl() ? type_app->decl()->isa<TraitDecl>() : nullptr;
+            if (trait_decl == nullptr)
+                continue;
+
+            std::vector<const Type*> trait_args(1, type_arg(i));
+            for (auto arg : type_app->type_args())
+                trait_args.push_back(substitute(arg, by_depth));
+            if (std::any_of(trait_args.begin(), trait_args.end(), [] (const Type* t) { return t->is_polymorphic() || !t->is_known(); }))
+                continue;
+
+            std::vector<const Type*> impl_args;
+            if (!trait_decl->find_impl(trait_args, impl_args))
+                error(this, "'{}' (instance for '{}') does not implement bound '{}'",
+                      type_arg(i), ast_type_param->symbol(), TypeSema::trait_str(trait_decl, trait_args));
+        }
+    }
 }
 
 void MapExpr::check(TypeSema& sema) const {
@@ -605,9 +895,10 @@ void MapExpr::check(TypeSema& sema) const {
     }
 
     if (ltype->isa<ArrayType>()) {
-        if (num_args() == 1)
+        if (num_args() == 1) {
             sema.expect_int(arg(0), "for array subscript");
-        else
+            in_bounds_ = ltype->isa<SliceType>() && sema.is_in_bounds(lhs(), arg(0));
+        } else
             error(this, "too many array subscripts");
     } else if (ltype->isa<TupleType>()) {
         if (num_args() == 1) {
@@ -625,6 +916,29 @@ void MapExpr::check(TypeSema& sema) const {
         error(this, "incorrect type for map expression");
 }
 
+void SliceExpr::check(TypeSema& sema) const {
+    auto ltype = unpack_ref_type(sema.check(lhs()));
+    sema.check(lo());
+    sema.check(hi());
+
+    if (!lo()->isa<EmptyExpr>())
+        sema.expect_int(lo(), "lower bound of slice");
+    if (!hi()->isa<EmptyExpr>())
+        sema.expect_int(hi(), "upper bound of slice");
+    else if (ltype->isa<IndefiniteArrayType>())
+        error(this, "slicing indefinite array '{}' requires an upper bound", ltype);
+
+    if (!ltype->isa<ArrayType>() || ltype->isa<SimdType>()) {
+        if (!ltype->isa<TypeError>())
+            error(lhs(), "cannot slice '{}'; expected an array or a slice", ltype);
+        return;
+    }
+
+    lhs()->take_address();
+    if (is_lvalue(lhs()->type()))
+        lhs()->write();
+}
+
 void TypeSema::check_call(const Expr* expr, ArrayRef<const Expr*> args) {
     auto fn_type = expr->type()->as<FnType>();
 
@@ -667,18 +981,28 @@ inline bool is_match_complete(const MatchExpr* match) {
         Array<bool> covered(enum_decl->num_option_decls(), false);
         size_t num_covered = 0;
 
-        for (size_t i = 0, e = match->num_arms(); i != e; ++i) {
-            auto enum_ptrn = match->arm(i)->ptrn()->isa<EnumPtrn>();
-            if (!enum_ptrn) continue;
+        auto cover = [&] (const Ptrn* ptrn) {
+            auto enum_ptrn = ptrn->isa<EnumPtrn>();
+            if (!enum_ptrn) return;
             auto option_decl = enum_ptrn->path()->decl()->isa<OptionDecl>();
-            if (!option_decl || option_decl->enum_decl() != enum_decl) continue;
+            if (!option_decl || option_decl->enum_decl() != enum_decl) return;
 
             bool refutable = false;
             for (auto& arg : enum_ptrn->args()) refutable |= arg->is_refutable();
-            if (refutable) continue;
+            if (refutable) return;
 
             num_covered += covered[option_decl->index()] ? 0 : 1;
             covered[option_decl->index()] = true;
+        };
+
+        for (size_t i = 0, e = match->num_arms(); i != e; ++i) {
+            auto ptrn = match->arm(i)->ptrn();
+            if (auto or_ptrn = ptrn->isa<OrPtrn>()) {
+                for (auto&& alt : or_ptrn->alts())
+                    cover(alt.get());
+            } else {
+                cover(ptrn);
+            }
         }
 
         if (num_covered == enum_decl->num_option_decls()) return true;
@@ -726,7 +1050,20 @@ void ForExpr::check(TypeSema& sema) const {
         auto ltype = sema.check(map->lhs());
         for (auto&& arg : map->args())
             sema.check(arg.get());
+
+        // 'for i in range(0, s.len)' keeps i in the bounds of s if range is a counting loop
+        auto path = map->lhs()->skip_rvalue()->isa<PathExpr>();
+        auto fn_decl = path && path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr;
+        auto len = map->num_args() == 2 ? map->arg(1)->skip_rvalue()->isa<FieldExpr>() : nullptr;
+        auto slice = len && len->symbol() == "len" ? TypeSema::slice_local(len->lhs()) : nullptr;
+        auto index = fn_expr()->num_params() == 2 ? fn_expr()->param(0) : nullptr;
+        bool in_bounds = slice && index && !index->is_mut() && map->arg(0)->isa<LiteralExpr>()
+                      && fn_decl && TypeSema::is_counting_loop(fn_decl);
+        if (in_bounds)
+            sema.in_bounds_.emplace_back(index, slice);
         sema.check(fn_expr());
+        if (in_bounds)
+            sema.in_bounds_.pop_back();
 
         if (auto fn_for = ltype->isa<FnType>()) {
             if (fn_for->num_params() != 0) {
@@ -790,6 +1127,47 @@ void CharPtrn::check(TypeSema& sema) const {
     sema.check(chr());
 }
 
+void RangePtrn::check(TypeSema& sema) const {
+    sema.check(lo());
+    sema.check(hi());
+    auto type = lo()->type();
+    sema.expect_type(type, hi(), "upper bound of range pattern");
+    if (type != hi()->type() || type->isa<TypeError>())
+        return;
+
+    if (!is_int(type))
+        error(this, "mismatched types: expected integer type but found '{}' as range pattern", type);
+    else if (ordinal(lo()) > ordinal(hi()))
+        error(this, "lower bound of range pattern exceeds its upper bound");
+}
+
+/// Returns an @p IdPtrn in @p ptrn which binds a variable or @c nullptr if there is none.
+static const IdPtrn* find_binding(const Ptrn* ptrn) {
+    if (auto id_ptrn = ptrn->isa<IdPtrn>())
+        return id_ptrn->local()->symbol().is_anonymous() ? nullptr : id_ptrn;
+
+    const Ptrns* sub_ptrns = nullptr;
+    if (auto tuple_ptrn = ptrn->isa<TuplePtrn>()) sub_ptrns = &tuple_ptrn->elems();
+    if (auto enum_ptrn  = ptrn->isa<EnumPtrn >()) sub_ptrns = &enum_ptrn->args();
+    if (auto or_ptrn    = ptrn->isa<OrPtrn   >()) sub_ptrns = &or_ptrn->alts();
+    if (sub_ptrns != nullptr) {
+        for (auto&& sub_ptrn : *sub_ptrns) {
+            if (auto id_ptrn = find_binding(sub_ptrn.get()))
+                return id_ptrn;
+        }
+    }
+    return nullptr;
+}
+
+void OrPtrn::check(TypeSema& sema) const {
+    for (auto&& alt : alts()) {
+        sema.check(alt.get());
+        sema.expect_type(type(), alt.get(), "alternative of or-pattern");
+        if (auto id_ptrn = find_binding(alt.get()))
+            error(id_ptrn, "variable '{}' must not be bound in an alternative of an or-pattern", id_ptrn->local()->symbol());
+    }
+}
+
 //------------------------------------------------------------------------------
 
 /*
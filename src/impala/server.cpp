@@ -0,0 +1,254 @@
+#include "impala/server.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMPALA_HAS_UNIX_SOCKETS
+#include <csignal>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+std::ostream& DiskFiles::open(const std::string& name) {
+    if (name == "-")
+        return std::cout;
+
+    files_.emplace_back(std::make_unique<std::ofstream>(name));
+    if (!*files_.back())
+        throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
+    return *files_.back();
+}
+
+std::ostream& MemoryFiles::open(const std::string& name) {
+    if (name == "-")
+        return std::cout;
+
+    files_.emplace_back(name, std::make_unique<std::ostringstream>());
+    return *files_.back().second;
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef IMPALA_HAS_UNIX_SOCKETS
+
+/*
+ * protocol: every number is sent as 8 bytes in little endian, every string as its size followed by its characters
+ *
+ * request: number of arguments, arguments, working directory of the client
+ * reply:   exit code, stdout, stderr, number of files, (file name, file contents)*
+ */
+
+class Socket {
+public:
+    Socket(int fd)
+        : fd_(fd)
+    {
+        if (fd_ < 0)
+            throw std::runtime_error(std::string("cannot create socket: ") + strerror(errno));
+    }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    ~Socket() { ::close(fd_); }
+
+    int fd() const { return fd_; }
+
+    void write(const char* data, size_t size) {
+        while (size != 0) {
+            auto n = ::write(fd_, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("cannot write to socket: ") + strerror(errno));
+            }
+            data += n;
+            size -= size_t(n);
+        }
+    }
+
+    void read(char* data, size_t size) {
+        while (size != 0) {
+            auto n = ::read(fd_, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("cannot read from socket: ") + strerror(errno));
+            }
+            if (n == 0)
+                throw std::runtime_error("connection closed unexpectedly");
+            data += n;
+            size -= size_t(n);
+        }
+    }
+
+    void write_num(uint64_t num) {
+        char buf[8];
+        for (size_t i = 0; i != 8; ++i)
+            buf[i] = char(num >> (8 * i));
+        write(buf, 8);
+    }
+
+    uint64_t read_num() {
+        char buf[8];
+        read(buf, 8);
+        uint64_t num = 0;
+        for (size_t i = 0; i != 8; ++i)
+            num |= uint64_t(uint8_t(buf[i])) << (8 * i);
+        return num;
+    }
+
+    void write_str(const std::string& str) {
+        write_num(str.size());
+        write(str.data(), str.size());
+    }
+
+    std::string read_str() {
+        std::string str(read_num(), '\0');
+        read(&str[0], str.size());
+        return str;
+    }
+
+private:
+    int fd_;
+};
+
+static sockaddr_un address(const std::string& socket_path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("invalid socket path '" + socket_path + "'");
+    std::strcpy(addr.sun_path, socket_path.c_str());
+    return addr;
+}
+
+static std::string current_dir() {
+    char buf[PATH_MAX];
+    if (getcwd(buf, sizeof(buf)) == nullptr)
+        throw std::runtime_error(std::string("cannot get working directory: ") + strerror(errno));
+    return buf;
+}
+
+/// Redirects @p stream to @p buf for the lifetime of this object.
+class Redirect {
+public:
+    Redirect(std::ostream& stream, std::streambuf* buf)
+        : stream_(stream)
+        , old_(stream.rdbuf(buf))
+    {}
+    ~Redirect() { stream_.flush(); stream_.rdbuf(old_); }
+
+private:
+    std::ostream& stream_;
+    std::streambuf* old_;
+};
+
+static void serve_client(Socket& client, const Driver& driver) {
+    std::vector<std::string> args(client.read_num());
+    for (auto& arg : args)
+        arg = client.read_str();
+    auto cwd = client.read_str();
+
+    std::ostringstream out, err;
+    MemoryFiles files;
+    int exit_code = EXIT_FAILURE;
+    {
+        Redirect redirect_out(std::cout, out.rdbuf()), redirect_err(std::cerr, err.rdbuf());
+        auto server_cwd = current_dir();
+        if (chdir(cwd.c_str()) != 0) {
+            std::cerr << "cannot change to directory '" << cwd << "': " << strerror(errno) << std::endl;
+        } else {
+            try {
+                exit_code = driver(args, files);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            if (chdir(server_cwd.c_str()) != 0)
+                throw std::runtime_error("cannot change back to directory '" + server_cwd + "': " + strerror(errno));
+        }
+    }
+
+    client.write_num(uint32_t(exit_code));
+    client.write_str(out.str());
+    client.write_str(err.str());
+    client.write_num(files.files().size());
+    for (const auto& file : files.files()) {
+        client.write_str(file.first);
+        client.write_str(file.second->str());
+    }
+}
+
+void serve(const std::string& socket_path, const Driver& driver) {
+    auto addr = address(socket_path);
+    Socket server(::socket(AF_UNIX, SOCK_STREAM, 0));
+    ::unlink(socket_path.c_str()); // remove the socket of a previous server
+    if (::bind(server.fd(), (const sockaddr*) &addr, sizeof(addr)) != 0 || ::listen(server.fd(), SOMAXCONN) != 0)
+        throw std::runtime_error("cannot listen on '" + socket_path + "': " + strerror(errno));
+
+    // a client that hangs up early must not take the server down
+    std::signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        int fd = ::accept(server.fd(), nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("cannot accept connection: ") + strerror(errno));
+        }
+
+        Socket client(fd);
+        try {
+            serve_client(client, driver);
+        } catch (const std::exception& e) {
+            std::cerr << "compile server: " << e.what() << std::endl;
+        }
+    }
+}
+
+int connect(const std::string& socket_path, const std::vector<std::string>& args) {
+    auto addr = address(socket_path);
+    Socket server(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (::connect(server.fd(), (const sockaddr*) &addr, sizeof(addr)) != 0)
+        throw std::runtime_error("cannot connect to '" + socket_path + "': " + strerror(errno));
+
+    server.write_num(args.size());
+    for (const auto& arg : args)
+        server.write_str(arg);
+    server.write_str(current_dir());
+
+    auto exit_code = int(uint32_t(server.read_num()));
+    std::cout << server.read_str() << std::flush;
+    std::cerr << server.read_str() << std::flush;
+    for (auto i = server.read_num(); i != 0; --i) {
+        auto name = server.read_str();
+        auto data = server.read_str();
+        std::ofstream file(name, std::ios::binary);
+        if (!file.write(data.data(), data.size()))
+            throw std::runtime_error("cannot write '" + name + "'");
+    }
+
+    return exit_code;
+}
+
+#else
+
+void serve(const std::string&, const Driver&) {
+    throw std::runtime_error("the compile server requires UNIX domain sockets");
+}
+
+int connect(const std::string&, const std::vector<std::string>&) {
+    throw std::runtime_error("the compile server requires UNIX domain sockets");
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,60 @@
+#ifndef IMPALA_SERVER_H
+#define IMPALA_SERVER_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace impala {
+
+/// The files written by a single run of the driver.
+class OutputFiles {
+public:
+    virtual ~OutputFiles() {}
+
+    /// Opens @p name for writing; the stream is valid as long as this object.
+    virtual std::ostream& open(const std::string& name) = 0;
+};
+
+/// Writes the files straight to disk.
+class DiskFiles : public OutputFiles {
+public:
+    std::ostream& open(const std::string& name) override;
+
+private:
+    std::vector<std::unique_ptr<std::ostream>> files_;
+};
+
+/// Keeps the files in memory; used by the compile server to send them to its client.
+class MemoryFiles : public OutputFiles {
+public:
+    std::ostream& open(const std::string& name) override;
+
+    const std::vector<std::pair<std::string, std::unique_ptr<std::ostringstream>>>& files() const { return files_; }
+
+private:
+    std::vector<std::pair<std::string, std::unique_ptr<std::ostringstream>>> files_;
+};
+
+/// Runs the driver with the command line @p args - including the program name - and writes its files to @p files.
+typedef std::function<int(const std::vector<std::string>& args, OutputFiles& files)> Driver;
+
+/**
+ * Compile-server mode: listens on the UNIX socket @p socket_path and runs @p driver for each request.
+ * A request carries the command line and the working directory of the client.
+ * The reply carries the exit code, everything the @p driver printed to @c std::cout and @c std::cerr and all its files.
+ * Requests are served one after another as the front end is not thread-safe.
+ * Never returns; throws if the socket cannot be set up.
+ */
+[[noreturn]] void serve(const std::string& socket_path, const Driver& driver);
+
+/// Sends @p args to the server at @p socket_path, prints its output, writes its files and returns its exit code.
+int connect(const std::string& socket_path, const std::vector<std::string>& args);
+
+}
+
+#endif
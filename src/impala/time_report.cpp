@@ -0,0 +1,110 @@
+#include "impala/time_report.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMPALA_HAS_RUSAGE
+#include <sys/resource.h>
+#endif
+
+namespace impala {
+
+static thread_local TimeReport* active_report = nullptr;
+
+static size_t peak_rss() {
+#ifdef IMPALA_HAS_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss);        // bytes
+#else
+    return size_t(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+TimeReport::TimeReport()
+    : old_(active_report)
+{
+    active_report = this;
+}
+
+TimeReport::~TimeReport() { active_report = old_; }
+
+TimeReport* TimeReport::active() { return active_report; }
+
+TimeReport::Phase::Phase(std::string name)
+    : report_(active_report)
+    , name_(std::move(name))
+{
+    if (report_ != nullptr) {
+        wall_ = std::chrono::steady_clock::now();
+        cpu_ = std::clock();
+    }
+}
+
+TimeReport::Phase::~Phase() {
+    if (report_ != nullptr) {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_;
+        double cpu = double(std::clock() - cpu_) / CLOCKS_PER_SEC;
+        report_->phases_.push_back({std::move(name_), wall.count(), cpu, peak_rss()});
+    }
+}
+
+void TimeReport::count(const char* name, size_t num) {
+    auto i = std::find_if(counters_.begin(), counters_.end(), [&] (const auto& counter) { return std::string(counter.first) == name; });
+    if (i != counters_.end())
+        i->second += num;
+    else
+        counters_.emplace_back(name, num);
+}
+
+void TimeReport::print(std::ostream& os) const {
+    double wall = 0.0, cpu = 0.0;
+    os << std::left << std::setw(24) << "phase" << std::right
+       << std::setw(12) << "wall [s]" << std::setw(12) << "cpu [s]" << std::setw(16) << "peak RSS [KiB]" << std::endl;
+    os << std::fixed << std::setprecision(4);
+    for (const auto& phase : phases_) {
+        os << std::left << std::setw(24) << phase.name << std::right
+           << std::setw(12) << phase.wall << std::setw(12) << phase.cpu << std::setw(16) << phase.peak_rss / 1024 << std::endl;
+        wall += phase.wall;
+        cpu += phase.cpu;
+    }
+    os << std::left << std::setw(24) << "total" << std::right << std::setw(12) << wall << std::setw(12) << cpu << std::endl;
+    os.unsetf(std::ios::floatfield);
+
+    for (const auto& counter : counters_)
+        os << std::left << std::setw(24) << counter.first << std::right << std::setw(12) << counter.second << std::endl;
+}
+
+static void print_json_string(std::ostream& os, const std::string& str) {
+    os << '"';
+    for (auto c : str) {
+        if (c == '"' || c == '\\') os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+void TimeReport::print_json(std::ostream& os) const {
+    os << "{\n  \"phases\": [";
+    for (size_t i = 0, e = phases_.size(); i != e; ++i) {
+        const auto& phase = phases_[i];
+        os << (i == 0 ? "\n" : ",\n") << "    { \"name\": ";
+        print_json_string(os, phase.name);
+        os << ", \"wall\": " << phase.wall << ", \"cpu\": " << phase.cpu << ", \"peak_rss\": " << phase.peak_rss << " }";
+    }
+    os << "\n  ],\n  \"counters\": {";
+    for (size_t i = 0, e = counters_.size(); i != e; ++i) {
+        os << (i == 0 ? "\n" : ",\n") << "    ";
+        print_json_string(os, counters_[i].first);
+        os << ": " << counters_[i].second;
+    }
+    os << "\n  }\n}" << std::endl;
+}
+
+}
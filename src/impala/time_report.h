@@ -0,0 +1,64 @@
+#ifndef IMPALA_TIME_REPORT_H
+#define IMPALA_TIME_REPORT_H
+
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace impala {
+
+/**
+ * Wall time, CPU time and peak resident set size of each phase of a compilation along with some counters.
+ * While alive, a @p TimeReport is @p active for the constructing thread and collects all @p Phase%s and counters.
+ */
+class TimeReport {
+public:
+    struct Entry {
+        std::string name;
+        double wall;     ///< Elapsed real time in seconds.
+        double cpu;      ///< CPU time of the whole process in seconds, including helper threads.
+        size_t peak_rss; ///< Peak resident set size of the process at the end of this phase in bytes.
+    };
+
+    TimeReport();
+    TimeReport(const TimeReport&) = delete;
+    TimeReport& operator=(const TimeReport&) = delete;
+    ~TimeReport();
+
+    static TimeReport* active(); ///< The @p TimeReport of this thread or @c nullptr.
+
+    /// Records the lifetime of this object as phase @p name of the @p active @p TimeReport; does nothing if there is none.
+    class Phase {
+    public:
+        Phase(std::string name);
+        ~Phase();
+
+    private:
+        TimeReport* report_;
+        std::string name_;
+        std::chrono::steady_clock::time_point wall_;
+        std::clock_t cpu_;
+    };
+
+    /// Adds @p num to the counter @p name.
+    void count(const char* name, size_t num);
+    /// Adds @p phases recorded by the @p TimeReport of another thread.
+    void append(const std::vector<Entry>& phases) { phases_.insert(phases_.end(), phases.begin(), phases.end()); }
+
+    const std::vector<Entry>& phases() const { return phases_; }
+    const std::vector<std::pair<const char*, size_t>>& counters() const { return counters_; }
+
+    void print(std::ostream&) const;      ///< Human-readable table.
+    void print_json(std::ostream&) const; ///< Same data as a JSON object with a @c phases array and a @c counters object.
+
+private:
+    std::vector<Entry> phases_;
+    std::vector<std::pair<const char*, size_t>> counters_;
+    TimeReport* old_;
+};
+
+}
+
+#endif
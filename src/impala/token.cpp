@@ -4,6 +4,8 @@
 #include <cerrno>
 #include <cstdlib>
 #include <limits>
+#include <mutex>
+#include <unordered_set>
 
 #include "thorin/util/cast.h"
 
@@ -13,22 +15,26 @@ using namespace thorin;
 
 namespace impala {
 
-Token::Token(Loc loc, Tag tok)
+const std::string* SrcLoc::intern(const std::string& file) {
+    static std::mutex mutex;
+    static std::unordered_set<std::string> files; // never shrinks, so the addresses of its elements stay valid
+    std::lock_guard<std::mutex> lock(mutex);
+    return &*files.emplace(file).first;
+}
+
+//------------------------------------------------------------------------------
+
+Token::Token(SrcLoc loc, Tag tok)
     : loc_(loc)
-    , symbol_(tok2sym_[tok])
     , tag_(tok)
 {}
 
-Token::Token(Loc loc, const std::string& str)
+Token::Token(SrcLoc loc, std::string_view str)
     : loc_(loc)
-    , symbol_(str)
+    , str_(str)
+    , tag_(keyword(str))
 {
     assert(!str.empty());
-    auto i = keywords_.find(str);
-    if (i == keywords_.end())
-        tag_ = Token::ID;
-    else
-        tag_ = i->second;
 }
 
 template<class T, class V>
@@ -36,9 +42,9 @@ static bool inrange(V val) {
     return std::numeric_limits<T>::lowest() <= val && val <= std::numeric_limits<T>::max();
 }
 
-Token::Token(Loc loc, Tag tag, const std::string& str)
+Token::Token(SrcLoc loc, Tag tag, std::string_view str)
     : loc_(loc)
-    , symbol_(str)
+    , str_(str)
     , tag_(tag)
 {
     using namespace std;
@@ -67,8 +73,11 @@ Token::Token(Loc loc, Tag tag, const std::string& str)
         }
     }
 
-    // remove underscores and '0b'/'0o'/'0x' prefix if applicable
-    std::copy_if(begin, str.end(), std::back_inserter(literal), [](char c) { return c != '_'; });
+    // remove underscores and '0b'/'0o'/'0x' prefix if applicable; floats are parsed from the verbatim text
+    if (tag_ == LIT_f16 || tag_ == LIT_f32 || tag_ == LIT_f64)
+        literal.assign(str.begin(), str.end());
+    else
+        std::copy_if(begin, str.end(), std::back_inserter(literal), [](char c) { return c != '_'; });
     auto nptr = &literal.front();
 
     bool err = 0;
@@ -80,9 +89,9 @@ Token::Token(Loc loc, Tag tag, const std::string& str)
                       ival = strtoll (nptr, 0, base);  err = errno; break;
         case LIT_u8: case LIT_u16: case LIT_u32: case LIT_u64:
                       uval = strtoull(nptr, 0, base);  err = errno; break;
-        case LIT_f16: hval = strtof(symbol_.c_str(), 0); err = errno; break; // TODO: errno for half not correctly set
-        case LIT_f32: fval = strtof(symbol_.c_str(), 0); err = errno; break;
-        case LIT_f64: dval = strtod(symbol_.c_str(), 0); err = errno; break;
+        case LIT_f16: hval = strtof(nptr, 0); err = errno; break; // TODO: errno for half not correctly set
+        case LIT_f32: fval = strtof(nptr, 0); err = errno; break;
+        case LIT_f64: dval = strtod(nptr, 0); err = errno; break;
         default: THORIN_UNREACHABLE;
     }
 
@@ -167,25 +176,111 @@ int Token::to_binop(Tag tag) {
 int Token::tok2op_[Num];
 Token::Tag2Str Token::tok2str_;
 Token::Tag2Sym Token::tok2sym_;
-Token::Sym2Tag Token::keywords_;
-Token::Sym2Tag Token::sym2lit_;
-Token::Sym2Tag Token::sym2flit_;
+
+/*
+ * keyword and literal suffix tables
+ *
+ * Keywords are looked up in a perfect hash table which is computed at compile time from impala/tokenlist.h.
+ * Duplicate keywords make the search for a collision-free seed fail and, hence, the build.
+ */
+
+namespace {
+
+struct TableEntry {
+    std::string_view str;
+    TokenTag tag;
+};
+
+constexpr TableEntry keyword_list[] = {
+#define IMPALA_KEY(tok, str)      { str, Token::tok },
+#define IMPALA_TYPE(itype, atype) { #itype, Token::TYPE_##itype },
+#include "impala/tokenlist.h"
+    // type aliases
+    { "int",    Token::TYPE_i32 },
+    { "uint",   Token::TYPE_u32 },
+    { "half",   Token::TYPE_f16 },
+    { "float",  Token::TYPE_f32 },
+    { "double", Token::TYPE_f64 },
+    // special tokens
+    { "as",     Token::AS },
+    { "mut",    Token::MUT },
+};
+
+constexpr size_t num_keyword_slots = 256;
+
+constexpr uint32_t keyword_hash(std::string_view str, uint32_t seed) {
+    uint32_t h = seed;
+    for (size_t i = 0, e = str.size(); i != e; ++i)
+        h = (h ^ uint8_t(str[i])) * 16777619u;
+    return (h ^ (h >> 16)) & (num_keyword_slots - 1);
+}
+
+constexpr bool is_perfect(uint32_t seed) {
+    bool used[num_keyword_slots] = {};
+    for (const auto& entry : keyword_list) {
+        auto i = keyword_hash(entry.str, seed);
+        if (used[i]) return false;
+        used[i] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_keyword_seed() {
+    uint32_t seed = 2166136261u;
+    while (!is_perfect(seed))
+        ++seed;
+    return seed;
+}
+
+struct KeywordTable {
+    std::string_view str[num_keyword_slots] = {};
+    TokenTag tag[num_keyword_slots] = {};
+};
+
+constexpr uint32_t keyword_seed = find_keyword_seed();
+
+constexpr KeywordTable make_keyword_table() {
+    KeywordTable table;
+    for (const auto& entry : keyword_list) {
+        auto i = keyword_hash(entry.str, keyword_seed);
+        table.str[i] = entry.str;
+        table.tag[i] = entry.tag;
+    }
+    return table;
+}
+
+constexpr KeywordTable keyword_table = make_keyword_table();
+
+/// Table of \em all (including floating) suffixes for literals.
+constexpr TableEntry lit_suffixes[] = {
+    { "i",   Token::LIT_i32 }, { "u",   Token::LIT_u32 },
+    { "i8",  Token::LIT_i8  }, { "u8",  Token::LIT_u8  },
+    { "i16", Token::LIT_i16 }, { "u16", Token::LIT_u16 },
+    { "i32", Token::LIT_i32 }, { "u32", Token::LIT_u32 },
+    { "i64", Token::LIT_i64 }, { "u64", Token::LIT_u64 },
+    { "h",   Token::LIT_f16 }, { "f16", Token::LIT_f16 },
+    { "f",   Token::LIT_f32 }, { "f32", Token::LIT_f32 },
+    { "f64", Token::LIT_f64 },
+};
+
+}
 
 /*
  * static methods
  */
 
-TokenTag Token::sym2lit(Symbol sym) {
-    auto i = sym2lit_.find(sym);
-    if (i != sym2lit_.end())
-        return i->second;
-    return Error;
+TokenTag Token::keyword(std::string_view str) {
+    auto i = keyword_hash(str, keyword_seed);
+    return keyword_table.str[i] == str ? keyword_table.tag[i] : ID;
 }
 
-TokenTag Token::sym2flit(Symbol sym) {
-    auto i = sym2flit_.find(sym);
-    if (i != sym2flit_.end())
-        return i->second;
+TokenTag Token::lit_suffix(std::string_view str, bool floating) {
+    for (const auto& entry : lit_suffixes) {
+        if (entry.str == str) {
+            bool is_float = entry.tag == LIT_f16 || entry.tag == LIT_f32 || entry.tag == LIT_f64;
+            return !floating || is_float ? entry.tag : Error;
+        }
+    }
     return Error;
 }
 
@@ -217,19 +312,6 @@ void Token::init() {
     insert_key(TYPE_f32, "float");
     insert_key(TYPE_f64, "double");
 
-    // literals
-    sym2lit_["i"]   = LIT_i32; sym2lit_["u"]   = LIT_u32;
-    sym2lit_["i8"]  = LIT_i8;  sym2lit_["u8"]  = LIT_u8;
-    sym2lit_["i16"] = LIT_i16; sym2lit_["u16"] = LIT_u16;
-    sym2lit_["i32"] = LIT_i32; sym2lit_["u32"] = LIT_u32;
-    sym2lit_["i64"] = LIT_i64; sym2lit_["u64"] = LIT_u64;
-
-    sym2lit_["h"]   = LIT_f16; sym2flit_["h"]   = LIT_f16;
-    sym2lit_["f16"] = LIT_f16; sym2flit_["f16"] = LIT_f16;
-    sym2lit_["f"]   = LIT_f32; sym2flit_["f"]   = LIT_f32;
-    sym2lit_["f32"] = LIT_f32; sym2flit_["f32"] = LIT_f32;
-    sym2lit_["f64"] = LIT_f64; sym2flit_["f64"] = LIT_f64;
-
     // special tokens
     tok2str_[ID]         = Symbol("<identifier>").c_str();
     insert(Eof, "<end of file>");
@@ -238,10 +320,8 @@ void Token::init() {
 }
 
 void Token::insert_key(TokenTag tok, const char* str) {
-    Symbol s = str;
-    assert(keywords_.find(s) == keywords_.end() && "already inserted");
-    keywords_[s] = tok;
-    tok2str_ [tok] = s.c_str();
+    assert(keyword(str) == tok && "keyword missing in the perfect hash table");
+    tok2str_[tok] = Symbol(str).c_str();
 }
 
 Symbol Token::insert(TokenTag tok, const char* str) {
@@ -265,17 +345,15 @@ Symbol Token::insert(TokenTag tok, const char* str) {
 const char* Token::tok2str(TokenTag tag) {
     auto i = Token::tok2str_.find(tag);
     assert(i != Token::tok2str_.end() && "must be found");
-    return Symbol(i->second).c_str();
+    return i->second;
 }
 
 std::ostream& operator<<(std::ostream& os, const TokenTag& tag) { return os << Token::tok2str(tag); }
 
 std::ostream& operator<<(std::ostream& os, const Token& tok) {
-    const char* sym = tok.symbol().c_str();
-    if (std::strcmp(sym, "") == 0)
-        return os << Symbol(Token::tok2str_[tok.tag()]).c_str();
-    else
-        return os << sym;
+    if (!tok.str_.empty())
+        return os << tok.str_;
+    return os << Token::tok2str(tok.tag());
 }
 
 //------------------------------------------------------------------------------
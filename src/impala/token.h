@@ -3,6 +3,7 @@
 
 #include <ostream>
 #include <string>
+#include <string_view>
 
 #include "thorin/debug.h"
 #include "thorin/enums.h"
@@ -14,6 +15,34 @@ using thorin::Loc;
 using thorin::Pos;
 using thorin::Symbol;
 
+/**
+ * A source location like @p Loc which refers to its file name instead of holding a copy of it.
+ * File names are interned for the lifetime of the process, so copying a @p SrcLoc never allocates.
+ */
+struct SrcLoc {
+    SrcLoc() {}
+    SrcLoc(const std::string* file, Pos begin, Pos finis)
+        : file(file)
+        , begin(begin)
+        , finis(finis)
+    {}
+    /// Interns the file name of @p loc - prefer the constructor above in hot paths.
+    SrcLoc(const Loc& loc)
+        : SrcLoc(intern(loc.file), loc.begin, loc.finis)
+    {}
+
+    SrcLoc anew_begin() const { return {file, begin, begin}; }
+    SrcLoc anew_finis() const { return {file, finis, finis}; }
+    operator Loc() const { return {file != nullptr ? *file : std::string(), begin, finis}; }
+
+    /// The interned copy of @p file; thread-safe.
+    static const std::string* intern(const std::string& file);
+
+    const std::string* file = nullptr;
+    Pos begin;
+    Pos finis;
+};
+
 class Token {
 public:
     enum Tag {
@@ -43,14 +72,20 @@ public:
 
     Token() {}
     /// Create an operator token
-    Token(Loc loc, Tag tok);
-    /// Create an identifier or a keyword (depends on \p str)
-    Token(Loc loc, const std::string& str);
-    /// Create a literal
-    Token(Loc loc, Tag type, const std::string& str);
+    Token(SrcLoc loc, Tag tok);
+    /// Create an identifier or a keyword (depends on \p str); \p str must outlive the token.
+    Token(SrcLoc loc, std::string_view str);
+    /// Create a literal; \p str must outlive the token.
+    Token(SrcLoc loc, Tag type, std::string_view str);
 
+    /// Copies the file name; use @p src_loc where a @p Loc is not needed.
     Loc loc() const { return loc_; }
-    Symbol symbol() const { return symbol_; }
+    const SrcLoc& src_loc() const { return loc_; }
+    /// Interns the token's text; operators yield the empty @p Symbol.
+    Symbol symbol() const { return Symbol(std::string(str_)); }
+    /// The token's text, usually a slice of the source buffer; empty for operators.
+    /// Tokens never touch the (unsynchronized) symbol table until @p symbol is called, so lexing is thread-safe.
+    std::string_view str() const { return str_; }
     thorin::Box box() const { return box_; }
     Tag tag() const { return tag_; }
     operator Tag() const { return tag_; }
@@ -69,8 +104,8 @@ public:
     bool is_assign()    const { return is_assign(tag_); }
     bool is_op()        const { return is_op(tag_); }
 
-    static Tag sym2lit(Symbol sym);
-    static Tag sym2flit(Symbol sym);
+    static Tag keyword(std::string_view str);                ///< Keyword for @p str or @p ID.
+    static Tag lit_suffix(std::string_view str, bool floating); ///< Literal tag for suffix @p str or @p Error.
     static bool is_prefix(Tag tag)  { return (tok2op_[tag] &  Prefix) != 0; }
     static bool is_infix(Tag tag)   { return (tok2op_[tag] &   Infix) != 0; }
     static bool is_postfix(Tag tag) { return (tok2op_[tag] & Postfix) != 0; }
@@ -91,20 +126,16 @@ private:
     static Symbol insert(Tag tok, const char* str);
     static void insert_key(Tag tok, const char* str);
 
-    Loc loc_;
-    Symbol symbol_;
+    SrcLoc loc_;
+    std::string_view str_;
     Tag tag_;
     thorin::Box box_;
 
-    typedef thorin::HashMap<Symbol, Tag> Sym2Tag;
     typedef thorin::HashMap<Tag, const char*, TagHash> Tag2Str;
     typedef thorin::HashMap<Tag, Symbol, TagHash> Tag2Sym;
     static int tok2op_[Num];
     static Tag2Str tok2str_; // TODO do we need this thing?
     static Tag2Sym tok2sym_;
-    static Sym2Tag keywords_;
-    static Sym2Tag sym2lit_; ///< Table of \em all (including floating) suffixes for literals.
-    static Sym2Tag sym2flit_;///< Table of suffixes for \em floating point literals.
 
     friend void init();
     friend std::ostream& operator<<(std::ostream& os, const Token& tok);
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "impala/impala.h"
+#include "impala/lexer.h"
+
+namespace fs = std::filesystem;
+
+// Measures the throughput of impala::Lexer.
+// usage: lexbench [-n <repetitions>] <file or directory>...
+// Directories are searched recursively for *.impala files; each file is lexed from memory <repetitions> times.
+int main(int argc, char** argv) {
+    int reps = 20;
+    std::vector<std::string> file_names;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = std::atoi(argv[++i]);
+        } else if (fs::is_directory(argv[i])) {
+            for (auto&& entry : fs::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file() && entry.path().extension() == ".impala")
+                    file_names.emplace_back(entry.path().string());
+            }
+        } else {
+            file_names.emplace_back(argv[i]);
+        }
+    }
+
+    if (file_names.empty() || reps <= 0) {
+        std::cerr << "usage: " << argv[0] << " [-n <repetitions>] <file or directory>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    impala::init();
+
+    std::vector<std::unique_ptr<impala::SourceBuffer>> buffers;
+    size_t num_bytes = 0;
+    for (auto&& file_name : file_names) {
+        buffers.emplace_back(std::make_unique<impala::SourceBuffer>(file_name.c_str()));
+        num_bytes += buffers.back()->size();
+    }
+
+    size_t num_tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r != reps; ++r) {
+        for (size_t i = 0, e = buffers.size(); i != e; ++i) {
+            impala::Lexer lexer(buffers[i]->begin(), buffers[i]->end(), file_names[i].c_str());
+            while (lexer.lex() != impala::Token::Eof)
+                ++num_tokens;
+        }
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+    double mb = double(num_bytes) * reps / (1024.0 * 1024.0);
+    std::cout << file_names.size() << " files, " << num_bytes << " bytes, " << num_tokens / reps << " tokens, " << reps << " repetitions" << std::endl;
+    std::cout << "lexer throughput: " << mb / time.count() << " MB/s, " << num_tokens / time.count() / 1e6 << " Mtokens/s" << std::endl;
+
+    return impala::num_errors() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
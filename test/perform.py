@@ -67,7 +67,8 @@ class RunImpalaCompile(TestMethod):
         self.flags = add_flags
 
     def __call__(self, testfile, addflags):
-        super().__call__(["-emit-llvm", "-O2", "-o", testfile.intermediate(), testfile.filename()] + self.flags)
+        flags = self.flags + [flag for flag in addflags if flag.startswith('-f')]
+        super().__call__(["-emit-llvm", "-O2", "-o", testfile.intermediate(), testfile.filename()] + flags)
 
         self.dump_output(testfile.intermediate('.log'))
 
@@ -86,6 +87,70 @@ class RunImpalaCompile(TestMethod):
 
         return True
 
+class RunImpalaPreparsed(TestMethod):
+    def __init__(self, impala, add_flags=[], timeout=None):
+        super().__init__(impala, timeout=timeout)
+        self.flags = add_flags
+
+    def __call__(self, testfile, addflags):
+        # the source build of RunImpalaCompile has emitted the preparsed module next to its LLVM module
+        flags = self.flags + [flag for flag in addflags if flag.startswith('-f')]
+        super().__call__(["-emit-llvm", "-O2", "-o", testfile.intermediate('.impp'), testfile.intermediate('.impp')] + flags)
+
+        self.dump_output(testfile.intermediate('.impp.log'))
+
+        if self.wrong_returncode():
+            print("Impala returned wrong returncode for the preparsed module")
+            return False
+
+        # both builds must be identical but for the module names
+        def module(filename):
+            with open(filename, 'r') as file:
+                return [line for line in file if not line.startswith('; ModuleID') and not line.startswith('source_filename')]
+        if module(testfile.intermediate('.ll')) != module(testfile.intermediate('.impp.ll')):
+            print("Preparsed module", testfile.intermediate('.impp'), "yields different code than its sources")
+            return False
+
+        return True
+
+class RunImpalaOutput(TestMethod):
+    def __init__(self, impala, add_flags=[], timeout=None):
+        super().__init__(impala, timeout=timeout)
+        self.flags = add_flags
+
+    def __call__(self, testfile, addflags):
+        flags = self.flags + [flag for flag in addflags if flag.startswith('-')]
+        super().__call__(["-o", testfile.intermediate(), testfile.filename()] + flags)
+
+        self.dump_output(testfile.intermediate('.log'))
+
+        if self.wrong_returncode():
+            print("Impala returned wrong returncode")
+            return False
+
+        # each line of the expected log has to occur within a line of the output - in this order
+        logfilename = testfile.source('.log')
+        if logfilename is not None:
+            output = iter(str(self.stdout, 'utf-8', 'ignore').splitlines())
+            with open(logfilename, 'r') as logfile:
+                for expected in logfile.read().splitlines():
+                    if not any(expected in line for line in output):
+                        print("Impala did not print", repr(expected))
+                        return False
+
+        # the C interface has to match exactly
+        headerfilename = testfile.source('.h')
+        if headerfilename is not None:
+            if not os.path.isfile(testfile.intermediate('.h')):
+                print("Impala did not generate", testfile.intermediate('.h'))
+                return False
+            with open(headerfilename, 'r') as expected, open(testfile.intermediate('.h'), 'r') as generated:
+                if expected.read() != generated.read():
+                    print("Impala generated a C interface other than", headerfilename)
+                    return False
+
+        return True
+
 class LinkFakeRuntime(TestMethod):
     def __init__(self, clang, runtime, add_flags=[]):
         super().__init__(clang)
@@ -248,6 +313,13 @@ if __name__ == '__main__':
             RunImpalaCompile(args.impala, impala_flags, timeout=args.compile_timeout),
             LinkFakeRuntime(args.clang, args.rtmock, clang_flags),
             ExecuteTestOutput(timeout=args.run_timeout)
+        ),
+        'output' : RunImpalaOutput(args.impala, impala_flags, timeout=args.compile_timeout),
+        'preparsed' : MultiStepPipeline(
+            RunImpalaCompile(args.impala, impala_flags + ['-emit-preparsed'], timeout=args.compile_timeout),
+            RunImpalaPreparsed(args.impala, impala_flags, timeout=args.compile_timeout),
+            LinkFakeRuntime(args.clang, args.rtmock, clang_flags),
+            ExecuteTestOutput(timeout=args.run_timeout)
         )
     }
 
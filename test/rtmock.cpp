@@ -67,10 +67,21 @@ void anydsl_aligned_free(void* ptr) {
     free(((void**)ptr)[-1]);
 }
 #endif
+// number of anydsl_alloc calls without a matching anydsl_release
+static int32_t live_allocs = 0;
+
 void* anydsl_alloc(int32_t dev, int64_t size) {
     // TODO: check whether aligned memory is actually necessary
+    ++live_allocs;
     return anydsl_aligned_malloc(size, 64);
 }
+void anydsl_release(int32_t dev, void* ptr) {
+    --live_allocs;
+    anydsl_aligned_free(ptr);
+}
+int32_t num_live_allocs() {
+    return live_allocs;
+}
 
 // meteor printing
 void print_meteor_scnt(int cnt) {